@@ -0,0 +1,456 @@
+#include "ScreenCapture.h"
+#include "ScreenCapture_C_API.h"
+#include "ScreenCapture_Convert.h"
+#include "ScreenCapture_Encode.h"
+#include "internal/SCCommon.h" //DONT USE THIS HEADER IN PRODUCTION CODE!!!! ITS INTERNAL FOR A REASON IT WILL CHANGE!!! ITS HERE FOR BENCHMARKS ONLY!!!
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Benchmarks for the hot paths of the library. Results are written as JSON (to stdout or to the file given with --json) so that runs from
+// different releases can be compared by a script.
+//
+//  --json <file>      write the results to file instead of stdout
+//  --quick            only run 1080p and 4k
+//  --no-e2e           skip the end to end capture benchmark
+//  --e2e-seconds <n>  how long the end to end benchmark should capture for (default 5)
+//
+// The end to end benchmark needs a running X server, run it under Xvfb on headless machines, for example
+// xvfb-run -s "-screen 0 3840x2160x24" ./screen_capture_benchmark_shared
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using SL::Screen_Capture::ImageBGRA;
+using SL::Screen_Capture::ImageRect;
+
+struct Resolution {
+    const char *Name;
+    int Width;
+    int Height;
+};
+
+const Resolution Resolutions[] = {{"1080p", 1920, 1080}, {"1440p", 2560, 1440}, {"4k", 3840, 2160}, {"8k", 7680, 4320}};
+
+enum class ChangePattern { None, SingleTile, Sparse, Full };
+
+const char *Name(ChangePattern p)
+{
+    switch (p) {
+    case ChangePattern::None:
+        return "none";
+    case ChangePattern::SingleTile:
+        return "single_tile";
+    case ChangePattern::Sparse:
+        return "sparse";
+    case ChangePattern::Full:
+        return "full";
+    }
+    return "unknown";
+}
+
+const ChangePattern Patterns[] = {ChangePattern::None, ChangePattern::SingleTile, ChangePattern::Sparse, ChangePattern::Full};
+
+// row padding in pixels, 0 means tightly packed. 64 matches what most drivers hand back for odd sized surfaces
+const int Paddings[] = {0, 64};
+
+struct TestFrame {
+    int Width = 0;
+    int Height = 0;
+    int RowStrideInBytes = 0;
+    std::vector<unsigned char> Pixels;
+
+    TestFrame(int w, int h, int padding) : Width(w), Height(h), RowStrideInBytes((w + padding) * sizeof(ImageBGRA))
+    {
+        Pixels.resize(static_cast<size_t>(RowStrideInBytes) * h);
+        auto seed = 0x9E3779B9u;
+        for (auto &p : Pixels) {
+            seed = seed * 1664525u + 1013904223u;
+            p = static_cast<unsigned char>(seed >> 24);
+        }
+    }
+    ImageBGRA *Row(int y) { return reinterpret_cast<ImageBGRA *>(Pixels.data() + static_cast<size_t>(y) * RowStrideInBytes); }
+    SL::Screen_Capture::Image ToImage() const
+    {
+        return SL::Screen_Capture::CreateImage(ImageRect(0, 0, Width, Height), RowStrideInBytes,
+                                               reinterpret_cast<const ImageBGRA *>(Pixels.data()));
+    }
+};
+
+void ApplyPattern(TestFrame &frame, ChangePattern pattern)
+{
+    auto touch = [&](int x, int y) { frame.Row(y)[x].G ^= 0xFF; };
+    switch (pattern) {
+    case ChangePattern::None:
+        break;
+    case ChangePattern::SingleTile: // a single keystroke somewhere in the middle of the screen
+        touch(frame.Width / 2, frame.Height / 2);
+        break;
+    case ChangePattern::Sparse: // roughly one in ten tiles has a change
+        for (auto y = 0; y < frame.Height; y += 256) {
+            for (auto x = (y / 256) % 10 * 256; x < frame.Width; x += 256 * 10) {
+                touch(x, y);
+            }
+        }
+        break;
+    case ChangePattern::Full: // every tile changes in its last pixel, the worst case for the compare
+        for (auto y = 0; y < frame.Height; y += 256) {
+            for (auto x = 0; x < frame.Width; x += 256) {
+                touch(std::min(x + 255, frame.Width - 1), std::min(y + 255, frame.Height - 1));
+            }
+        }
+        break;
+    }
+}
+
+struct Result {
+    std::string Name;
+    std::string Resolution;
+    std::string Pattern;
+    int RowStrideInBytes = 0;
+    size_t Iterations = 0;
+    double MeanMicroseconds = 0;
+    double MinMicroseconds = 0;
+    double P50Microseconds = 0;
+    double P99Microseconds = 0;
+    double MegabytesPerSecond = 0;
+};
+
+double Percentile(std::vector<double> samples, double p)
+{
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto index = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+    return samples[std::min(index, samples.size() - 1)];
+}
+
+// runs f at least MinIterations times and for at least MinDuration, prepare is called before every iteration and is not timed
+Result Measure(const std::string &name, size_t bytesprocessed, const std::function<void()> &f, const std::function<void()> &prepare = {})
+{
+    constexpr size_t MinIterations = 10;
+    constexpr auto MinDuration = std::chrono::milliseconds(250);
+
+    std::vector<double> samples;
+    auto start = Clock::now();
+    while (samples.size() < MinIterations || Clock::now() - start < MinDuration) {
+        if (prepare) {
+            prepare();
+        }
+        auto begin = Clock::now();
+        f();
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+    }
+
+    Result r;
+    r.Name = name;
+    r.Iterations = samples.size();
+    r.MinMicroseconds = *std::min_element(samples.begin(), samples.end());
+    for (auto s : samples) {
+        r.MeanMicroseconds += s;
+    }
+    r.MeanMicroseconds /= samples.size();
+    r.P50Microseconds = Percentile(samples, 0.5);
+    r.P99Microseconds = Percentile(samples, 0.99);
+    r.MegabytesPerSecond = r.P50Microseconds > 0 ? (bytesprocessed / (1024.0 * 1024.0)) / (r.P50Microseconds / 1000000.0) : 0;
+    return r;
+}
+
+std::vector<ImageRect> TileRects(const TestFrame &frame, ChangePattern pattern)
+{
+    // the same layout GetDifs produces before merging, one rect per changed 256x256 tile in row major order
+    std::vector<ImageRect> rects;
+    for (auto y = 0; y < frame.Height; y += 256) {
+        for (auto x = 0; x < frame.Width; x += 256) {
+            auto dirty = pattern == ChangePattern::Full || (pattern == ChangePattern::Sparse && (x / 256) % 10 == (y / 256) % 10) ||
+                         (pattern == ChangePattern::SingleTile && x == frame.Width / 2 / 256 * 256 && y == frame.Height / 2 / 256 * 256);
+            if (dirty) {
+                rects.push_back(ImageRect(x, y, x + 256, y + 256));
+            }
+        }
+    }
+    return rects;
+}
+
+void RunMicroBenchmarks(const std::vector<Resolution> &resolutions, std::vector<Result> &results)
+{
+    for (auto &res : resolutions) {
+        for (auto padding : Paddings) {
+            TestFrame oldframe(res.Width, res.Height, padding);
+            const auto imagebytes = static_cast<size_t>(res.Width) * res.Height * sizeof(ImageBGRA);
+            auto record = [&](Result r, const char *pattern) {
+                r.Resolution = res.Name;
+                r.Pattern = pattern;
+                r.RowStrideInBytes = oldframe.RowStrideInBytes;
+                std::cerr << r.Name << " " << r.Resolution << " stride=" << r.RowStrideInBytes << " " << r.Pattern << " p50=" << r.P50Microseconds
+                          << "us" << std::endl;
+                results.push_back(r);
+            };
+
+            std::vector<unsigned char> dst(imagebytes);
+            auto oldimg = oldframe.ToImage();
+            record(Measure("Extract", imagebytes, [&] { SL::Screen_Capture::Extract(oldimg, dst.data(), dst.size()); }), "none");
+            record(Measure("SCL_Utility_CopyToContiguous", imagebytes, [&] { SCL_Utility_CopyToContiguous(dst.data(), &oldimg); }), "none");
+            record(Measure("ExtractAndConvertToRGBA", imagebytes,
+                           [&] { SL::Screen_Capture::ExtractAndConvertToRGBA(oldimg, dst.data(), dst.size()); }),
+                   "none");
+            record(Measure("ExtractAndConvertToRGB", imagebytes,
+                           [&] { SL::Screen_Capture::ExtractAndConvertToRGB(oldimg, dst.data(), dst.size()); }),
+                   "none");
+            record(Measure("ExtractAndConvertToGray", imagebytes,
+                           [&] { SL::Screen_Capture::ExtractAndConvertToGray(oldimg, dst.data(), dst.size()); }),
+                   "none");
+            // the chroma planes go into the second half of dst, which is big enough for either layout
+            auto chroma = dst.data() + dst.size() / 2;
+            const auto chromawidth = (res.Width + 1) / 2;
+            const auto chromaheight = (res.Height + 1) / 2;
+            record(Measure("ExtractAndConvertToNV12", imagebytes,
+                           [&] { SL::Screen_Capture::ExtractAndConvertToNV12(oldimg, dst.data(), res.Width, chroma, chromawidth * 2); }),
+                   "none");
+            record(Measure("ExtractAndConvertToI420", imagebytes,
+                           [&] {
+                               SL::Screen_Capture::ExtractAndConvertToI420(oldimg, dst.data(), res.Width, chroma, chromawidth,
+                                                                           chroma + chromawidth * chromaheight, chromawidth);
+                           }),
+                   "none");
+            for (auto divisor : {2, 4, 8}) {
+                for (auto filter : {SL::Screen_Capture::ScaleFilter::Box, SL::Screen_Capture::ScaleFilter::Bilinear}) {
+                    auto name = std::string("ExtractAndDownscale_") + std::to_string(divisor) +
+                                (filter == SL::Screen_Capture::ScaleFilter::Box ? "_box" : "_bilinear");
+                    record(Measure(name, imagebytes,
+                                   [&] { SL::Screen_Capture::ExtractAndDownscale(oldimg, dst.data(), dst.size(), divisor, filter); }),
+                           "none");
+                }
+            }
+
+            std::vector<unsigned char> encoded(SL::Screen_Capture::LosslessEncodeBound(res.Width, res.Height));
+            record(Measure("LosslessEncode", imagebytes,
+                           [&] { SL::Screen_Capture::LosslessEncode(oldimg, nullptr, encoded.data(), encoded.size()); }),
+                   "none");
+
+            for (auto pattern : Patterns) {
+                auto newframe = oldframe;
+                ApplyPattern(newframe, pattern);
+                auto newimg = newframe.ToImage();
+
+                // the whole frame against the previous one, the way a viewer would get a keyframe followed by deltas
+                size_t encodedsize = 0;
+                record(Measure("LosslessEncode_reference", imagebytes,
+                               [&] { encodedsize = SL::Screen_Capture::LosslessEncode(newimg, &oldimg, encoded.data(), encoded.size()); }),
+                       Name(pattern));
+                record(Measure("LosslessDecode_reference", imagebytes,
+                               [&] {
+                                   SL::Screen_Capture::LosslessDecode(encoded.data(), encodedsize, dst.data(), res.Width * sizeof(ImageBGRA),
+                                                                      oldframe.Pixels.data(), oldframe.RowStrideInBytes);
+                               }),
+                       Name(pattern));
+
+                record(Measure("GetDifs", imagebytes * 2, [&] { SL::Screen_Capture::GetDifs(oldimg, newimg); }), Name(pattern));
+
+                auto tiles = TileRects(oldframe, pattern);
+                std::vector<ImageRect> rects;
+                record(Measure(
+                           "merge", tiles.size() * sizeof(ImageRect), [&] { SL::Screen_Capture::merge(rects); }, [&] { rects = tiles; }),
+                       Name(pattern));
+
+                // ProcessCapture with both callbacks registered, each tick the library alternates between the two frames
+                SL::Screen_Capture::CaptureData<SL::Screen_Capture::ScreenCaptureCallback, SL::Screen_Capture::MouseCallback,
+                                                SL::Screen_Capture::MonitorCallback>
+                    data;
+                std::atomic<size_t> changed{0};
+                data.OnNewFrame = [](const SL::Screen_Capture::Image &, const SL::Screen_Capture::Monitor &) {};
+                data.OnFrameChanged = [&](const SL::Screen_Capture::Image &, const SL::Screen_Capture::Monitor &) { changed += 1; };
+                SL::Screen_Capture::BaseFrameProcessor base;
+                base.ImageBufferSize = static_cast<int>(imagebytes);
+                base.ImageBuffer = std::make_unique<unsigned char[]>(imagebytes);
+                auto monitor = SL::Screen_Capture::CreateMonitor(0, 0, res.Height, res.Width, 0, 0, "Benchmark", 1.0f);
+                SL::Screen_Capture::ProcessCapture(data, base, monitor, oldframe.Pixels.data(), oldframe.RowStrideInBytes);
+                auto flip = false;
+                record(Measure("ProcessCapture", imagebytes * 3,
+                               [&] {
+                                   auto &frame = flip ? oldframe : newframe;
+                                   SL::Screen_Capture::ProcessCapture(data, base, monitor, frame.Pixels.data(), frame.RowStrideInBytes);
+                                   flip = !flip;
+                               }),
+                       Name(pattern));
+            }
+        }
+    }
+}
+
+struct EndToEndResult {
+    bool Ran = false;
+    std::string Reason;
+    int Monitors = 0;
+    double Seconds = 0;
+    size_t Frames = 0;
+    size_t ChangedRects = 0;
+    double FramesPerSecond = 0;
+    double MegabytesPerSecond = 0;
+    // time between two frames of the same monitor
+    double MeanFrameIntervalMicroseconds = 0;
+    double P50FrameIntervalMicroseconds = 0;
+    double P99FrameIntervalMicroseconds = 0;
+    // from the grab of a frame to its onNewFrame callback
+    double MeanLatencyMicroseconds = 0;
+    double P50LatencyMicroseconds = 0;
+    double P99LatencyMicroseconds = 0;
+};
+
+EndToEndResult RunEndToEnd(int seconds)
+{
+    EndToEndResult ret;
+    auto monitors = SL::Screen_Capture::GetMonitors();
+    if (monitors.empty()) {
+        ret.Reason = "no monitors found, is an X server (Xvfb) running?";
+        return ret;
+    }
+    ret.Monitors = static_cast<int>(monitors.size());
+
+    std::mutex lock;
+    std::vector<double> intervals, latencies;
+    std::vector<Clock::time_point> lastframe(monitors.size());
+    std::atomic<size_t> frames{0}, bytes{0}, rects{0};
+
+    auto framegrabber =
+        SL::Screen_Capture::CreateCaptureConfiguration([&]() { return monitors; })
+            ->onNewFrame([&](const SL::Screen_Capture::Image &img, const SL::Screen_Capture::Monitor &monitor) {
+                auto now = Clock::now();
+                auto latency = (SL::Screen_Capture::MonotonicTime() - SL::Screen_Capture::Timestamp(img)) / 1000.0;
+                frames += 1;
+                bytes += static_cast<size_t>(Width(img)) * Height(img) * sizeof(ImageBGRA);
+                std::lock_guard<std::mutex> guard(lock);
+                latencies.push_back(latency);
+                auto &last = lastframe[Index(monitor) % lastframe.size()];
+                if (last != Clock::time_point()) {
+                    intervals.push_back(std::chrono::duration<double, std::micro>(now - last).count());
+                }
+                last = now;
+            })
+            ->onFrameChanged([&](const SL::Screen_Capture::Image &, const SL::Screen_Capture::Monitor &) { rects += 1; })
+            ->start_capturing();
+    // as fast as possible, the frame interval is the cost of a single capture
+    framegrabber->setFrameChangeInterval(std::chrono::milliseconds(0));
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    framegrabber = nullptr;
+    ret.Seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    ret.Ran = true;
+    ret.Frames = frames;
+    ret.ChangedRects = rects;
+    ret.FramesPerSecond = ret.Frames / ret.Seconds;
+    ret.MegabytesPerSecond = (bytes / (1024.0 * 1024.0)) / ret.Seconds;
+    auto mean = [](const std::vector<double> &samples) {
+        double sum = 0;
+        for (auto f : samples) {
+            sum += f;
+        }
+        return samples.empty() ? 0.0 : sum / samples.size();
+    };
+    ret.MeanFrameIntervalMicroseconds = mean(intervals);
+    ret.P50FrameIntervalMicroseconds = Percentile(intervals, 0.5);
+    ret.P99FrameIntervalMicroseconds = Percentile(intervals, 0.99);
+    ret.MeanLatencyMicroseconds = mean(latencies);
+    ret.P50LatencyMicroseconds = Percentile(latencies, 0.5);
+    ret.P99LatencyMicroseconds = Percentile(latencies, 0.99);
+    return ret;
+}
+
+std::string ToJson(const std::vector<Result> &results, const EndToEndResult *e2e)
+{
+    std::ostringstream os;
+    os << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        auto &r = results[i];
+        os << "    {\"name\": \"" << r.Name << "\", \"resolution\": \"" << r.Resolution << "\", \"row_stride_bytes\": " << r.RowStrideInBytes
+           << ", \"pattern\": \"" << r.Pattern << "\", \"iterations\": " << r.Iterations << ", \"mean_us\": " << r.MeanMicroseconds
+           << ", \"min_us\": " << r.MinMicroseconds << ", \"p50_us\": " << r.P50Microseconds << ", \"p99_us\": " << r.P99Microseconds
+           << ", \"mb_per_s\": " << r.MegabytesPerSecond << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]";
+    if (e2e) {
+        os << ",\n  \"end_to_end\": {\"ran\": " << (e2e->Ran ? "true" : "false");
+        if (e2e->Ran) {
+            os << ", \"monitors\": " << e2e->Monitors << ", \"seconds\": " << e2e->Seconds << ", \"frames\": " << e2e->Frames
+               << ", \"changed_rects\": " << e2e->ChangedRects << ", \"fps\": " << e2e->FramesPerSecond
+               << ", \"mb_per_s\": " << e2e->MegabytesPerSecond << ", \"frame_interval_mean_us\": " << e2e->MeanFrameIntervalMicroseconds
+               << ", \"frame_interval_p50_us\": " << e2e->P50FrameIntervalMicroseconds
+               << ", \"frame_interval_p99_us\": " << e2e->P99FrameIntervalMicroseconds << ", \"latency_mean_us\": " << e2e->MeanLatencyMicroseconds
+               << ", \"latency_p50_us\": " << e2e->P50LatencyMicroseconds << ", \"latency_p99_us\": " << e2e->P99LatencyMicroseconds;
+        }
+        else {
+            os << ", \"reason\": \"" << e2e->Reason << "\"";
+        }
+        os << "}";
+    }
+    os << "\n}\n";
+    return os.str();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string jsonpath;
+    auto quick = false;
+    auto e2e = true;
+    auto e2eseconds = 5;
+    for (auto i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            jsonpath = argv[++i];
+        }
+        else if (arg == "--quick") {
+            quick = true;
+        }
+        else if (arg == "--no-e2e") {
+            e2e = false;
+        }
+        else if (arg == "--e2e-seconds" && i + 1 < argc) {
+            e2eseconds = std::max(1, std::atoi(argv[++i]));
+        }
+        else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Resolution> resolutions;
+    for (auto &r : Resolutions) {
+        if (!quick || r.Width == 1920 || r.Width == 3840) {
+            resolutions.push_back(r);
+        }
+    }
+
+    std::vector<Result> results;
+    RunMicroBenchmarks(resolutions, results);
+
+    EndToEndResult e2eresult;
+    if (e2e) {
+        std::cerr << "Running end to end capture for " << e2eseconds << " seconds" << std::endl;
+        e2eresult = RunEndToEnd(e2eseconds);
+    }
+
+    auto json = ToJson(results, e2e ? &e2eresult : nullptr);
+    if (jsonpath.empty()) {
+        std::cout << json;
+    }
+    else {
+        std::ofstream out(jsonpath);
+        out << json;
+    }
+    return 0;
+}
@@ -1,14 +1,22 @@
 #include "ScreenCapture.h"
 #include "ScreenCapture_C_API.h"
+#include "ScreenCapture_Convert.h"
+#include "ScreenCapture_Encode.h"
+#include "ScreenCapture_Recording.h"
+#include "ScreenCapture_SharedFrames.h"
 #include "internal/SCCommon.h" //DONT USE THIS HEADER IN PRODUCTION CODE!!!! ITS INTERNAL FOR A REASON IT WILL CHANGE!!! ITS HERE FOR TESTS ONLY!!!
 #include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <climits>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <locale>
+#include <new>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 // THESE LIBRARIES ARE HERE FOR CONVINIENCE!! They are SLOW and ONLY USED FOR
@@ -20,6 +28,30 @@
 #include "lodepng.h"
 /////////////////////////////////////////////////////////////////////////
 
+// counts the allocations of the whole program while TestNoAllocations looks
+std::atomic<bool> countallocations(false);
+std::atomic<int> allocations(0);
+void *operator new(std::size_t size)
+{
+    if (countallocations)
+        allocations++;
+    if (auto p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    if (countallocations)
+        allocations++;
+    return std::malloc(size ? size : 1);
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return operator new(size, std::nothrow); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
 void TestCopyContiguous()
 {
 
@@ -102,21 +134,858 @@ void TestCopyNonContiguous()
     }
 }
 
-void ExtractAndConvertToRGBA(const SL::Screen_Capture::Image &img, unsigned char *dst, size_t dst_size)
+void TestConvert()
+{
+    constexpr unsigned WIDTH(33), HEIGHT(5), PADDING(7), STRIDE_IN_BYTES((WIDTH + PADDING) * sizeof(SL::Screen_Capture::ImageBGRA));
+
+    // odd sizes and padded rows so both the vectorized loops and the tails are used
+    std::vector<SL::Screen_Capture::ImageBGRA> strided;
+    for (unsigned row(0); row < HEIGHT; ++row) {
+        for (unsigned col(0); col < WIDTH + PADDING; ++col) {
+            strided.push_back(col < WIDTH ? SL::Screen_Capture::ImageBGRA{10, 20, 30, 0} : SL::Screen_Capture::ImageBGRA{0xFE, 0xFE, 0xFE, 0xFE});
+        }
+    }
+    auto image = SL::Screen_Capture::Image{{0, 0, WIDTH, HEIGHT}, STRIDE_IN_BYTES, false, strided.data()};
+
+    std::vector<unsigned char> rgba(WIDTH * HEIGHT * 4);
+    SL::Screen_Capture::ExtractAndConvertToRGBA(image, rgba.data(), rgba.size());
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        if (rgba[i] != 30 || rgba[i + 1] != 20 || rgba[i + 2] != 10 || rgba[i + 3] != 255)
+            std::abort();
+    }
+
+    std::vector<unsigned char> rgb(WIDTH * HEIGHT * 3);
+    SL::Screen_Capture::ExtractAndConvertToRGB(image, rgb.data(), rgb.size());
+    for (size_t i = 0; i < rgb.size(); i += 3) {
+        if (rgb[i] != 30 || rgb[i + 1] != 20 || rgb[i + 2] != 10)
+            std::abort();
+    }
+
+    // BT.601 limited range of R=30 G=20 B=10 is Y=35 U=122 V=133
+    constexpr unsigned CHROMA_WIDTH((WIDTH + 1) / 2), CHROMA_HEIGHT((HEIGHT + 1) / 2);
+    std::vector<unsigned char> y(WIDTH * HEIGHT), u(CHROMA_WIDTH * CHROMA_HEIGHT), v(CHROMA_WIDTH * CHROMA_HEIGHT);
+    SL::Screen_Capture::ExtractAndConvertToI420(image, y.data(), WIDTH, u.data(), CHROMA_WIDTH, v.data(), CHROMA_WIDTH);
+    for (auto luma : y) {
+        if (luma != 35)
+            std::abort();
+    }
+    for (size_t i = 0; i < u.size(); ++i) {
+        if (u[i] != 122 || v[i] != 133)
+            std::abort();
+    }
+
+    // pure red, where the matrices and ranges are furthest apart: Y, U, V and gray for BT.601 and BT.709, limited and full range
+    struct Expected {
+        SL::Screen_Capture::ColorMatrix Matrix;
+        SL::Screen_Capture::ColorRange Range;
+        unsigned char Y, U, V, Gray;
+    };
+    const Expected expected[] = {{SL::Screen_Capture::ColorMatrix::BT601, SL::Screen_Capture::ColorRange::Limited, 81, 90, 240, 76},
+                                 {SL::Screen_Capture::ColorMatrix::BT601, SL::Screen_Capture::ColorRange::Full, 76, 85, 255, 76},
+                                 {SL::Screen_Capture::ColorMatrix::BT709, SL::Screen_Capture::ColorRange::Limited, 63, 102, 240, 54},
+                                 {SL::Screen_Capture::ColorMatrix::BT709, SL::Screen_Capture::ColorRange::Full, 54, 99, 255, 54}};
+    for (unsigned row(0); row < HEIGHT; ++row) {
+        for (unsigned col(0); col < WIDTH; ++col) {
+            strided[row * (WIDTH + PADDING) + col] = SL::Screen_Capture::ImageBGRA{0, 0, 255, 0};
+        }
+    }
+    // padded planes, the padding must stay as it is
+    constexpr unsigned Y_STRIDE(WIDTH + 3), UV_STRIDE(CHROMA_WIDTH * 2 + 5);
+    for (auto &e : expected) {
+        std::vector<unsigned char> nv12y(Y_STRIDE * HEIGHT, 0xFE), nv12uv(UV_STRIDE * CHROMA_HEIGHT, 0xFE);
+        SL::Screen_Capture::ExtractAndConvertToNV12(image, nv12y.data(), Y_STRIDE, nv12uv.data(), UV_STRIDE, e.Matrix, e.Range);
+        for (unsigned row(0); row < HEIGHT; ++row) {
+            for (unsigned col(0); col < Y_STRIDE; ++col) {
+                if (nv12y[row * Y_STRIDE + col] != (col < WIDTH ? e.Y : 0xFE))
+                    std::abort();
+            }
+        }
+        for (unsigned row(0); row < CHROMA_HEIGHT; ++row) {
+            for (unsigned col(0); col < UV_STRIDE; ++col) {
+                auto sample = nv12uv[row * UV_STRIDE + col];
+                if (sample != (col >= CHROMA_WIDTH * 2 ? 0xFE : col % 2 ? e.V : e.U))
+                    std::abort();
+            }
+        }
+        std::vector<unsigned char> gray(WIDTH * HEIGHT);
+        SL::Screen_Capture::ExtractAndConvertToGray(image, gray.data(), gray.size(), e.Matrix);
+        for (auto luma : gray) {
+            if (luma != e.Gray)
+                std::abort();
+        }
+    }
+
+    // every 2x2 block averages to 70, so whole blocks come out as 70 at any divisor and with either filter
+    for (unsigned row(0); row < HEIGHT; ++row) {
+        for (unsigned col(0); col < WIDTH; ++col) {
+            auto c = static_cast<unsigned char>(col % 2 * 100 + row % 2 * 40);
+            strided[row * (WIDTH + PADDING) + col] = SL::Screen_Capture::ImageBGRA{c, c, c, 0};
+        }
+    }
+    for (auto filter : {SL::Screen_Capture::ScaleFilter::Box, SL::Screen_Capture::ScaleFilter::Bilinear}) {
+        for (auto divisor : {2, 4}) {
+            auto scaled = SL::Screen_Capture::DownscaledRect(SL::Screen_Capture::Rect(image), divisor);
+            std::vector<SL::Screen_Capture::ImageBGRA> small(Width(scaled) * Height(scaled));
+            SL::Screen_Capture::ExtractAndDownscale(image, reinterpret_cast<unsigned char *>(small.data()),
+                                                    small.size() * sizeof(SL::Screen_Capture::ImageBGRA), divisor, filter);
+            for (unsigned row(0); row < HEIGHT / divisor; ++row) {
+                for (unsigned col(0); col < WIDTH / divisor; ++col) {
+                    auto &p = small[row * Width(scaled) + col];
+                    if (p.B != 70 || p.G != 70 || p.R != 70)
+                        std::abort();
+                }
+            }
+        }
+    }
+}
+
+// the frames of the encoder, recording and shared memory tests: 33x5 pixels with 7 pixels of padding after each row, the second frame
+// only differs from the first in row 2
+namespace PaddedFrames {
+    constexpr unsigned WIDTH(33), HEIGHT(5), PADDING(7), STRIDE_IN_BYTES((WIDTH + PADDING) * sizeof(SL::Screen_Capture::ImageBGRA));
+
+    std::pair<std::vector<SL::Screen_Capture::ImageBGRA>, std::vector<SL::Screen_Capture::ImageBGRA>> Create()
+    {
+        std::pair<std::vector<SL::Screen_Capture::ImageBGRA>, std::vector<SL::Screen_Capture::ImageBGRA>> frames;
+        for (unsigned row(0); row < HEIGHT; ++row) {
+            for (unsigned col(0); col < WIDTH + PADDING; ++col) {
+                auto c = static_cast<unsigned char>((row * 7 + col) % 5 * 40);
+                frames.first.push_back(SL::Screen_Capture::ImageBGRA{c, 20, 30, 0});
+                frames.second.push_back(SL::Screen_Capture::ImageBGRA{c, static_cast<unsigned char>(row == 2 ? 99 : 20), 30, 0});
+            }
+        }
+        return frames;
+    }
+} // namespace PaddedFrames
+
+void TestLossless()
+{
+    using namespace PaddedFrames;
+    auto [previous, current] = PaddedFrames::Create();
+    auto reference = SL::Screen_Capture::Image{{0, 0, WIDTH, HEIGHT}, STRIDE_IN_BYTES, false, previous.data()};
+    auto image = SL::Screen_Capture::Image{{0, 0, WIDTH, HEIGHT}, STRIDE_IN_BYTES, false, current.data()};
+
+    std::vector<unsigned char> encoded(SL::Screen_Capture::LosslessEncodeBound(WIDTH, HEIGHT));
+    auto size = SL::Screen_Capture::LosslessEncode(image, &reference, encoded.data(), encoded.size());
+    // decode on top of the previous frame, only the changed row is touched
+    if (size == 0 || !SL::Screen_Capture::LosslessDecode(encoded.data(), size, reinterpret_cast<unsigned char *>(previous.data()), STRIDE_IN_BYTES,
+                                                         reinterpret_cast<unsigned char *>(previous.data()), STRIDE_IN_BYTES))
+        std::abort();
+    for (unsigned row(0); row < HEIGHT; ++row) {
+        for (unsigned col(0); col < WIDTH; ++col) {
+            auto &a = previous[row * (WIDTH + PADDING) + col];
+            auto &b = current[row * (WIDTH + PADDING) + col];
+            if (a.B != b.B || a.G != b.G || a.R != b.R)
+                std::abort();
+        }
+    }
+}
+
+void TestRecording()
+{
+    using namespace PaddedFrames;
+    auto [first, second] = PaddedFrames::Create();
+    const auto path = "screen_capture_lite_test.sclr";
+    const auto keyframes = "screen_capture_lite_test_keyframes.sclr";
+    const auto crashed = "screen_capture_lite_test_crashed.sclr";
+    // changed outside of the row the caller reports, which must not make it into the recording
+    auto unreported = second;
+    unreported[0].R = 77;
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT), changed(0, 2, WIDTH, 3);
+    // published back to back, the frames still get a timestamp each
+    for (auto interval : {10, 0}) {
+        auto recorder = SL::Screen_Capture::CreateFrameRecorder(interval ? path : keyframes, std::chrono::seconds(interval));
+        if (!recorder)
+            std::abort();
+        recorder->publish(SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, false, first.data()}, &whole, 1, 1, "test");
+        // only the changed row is stored, unless every change is a keyframe
+        recorder->publish(SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, false, (interval ? unreported : second).data()}, &changed, 1, 1, "test");
+        // with the whole frame as the dirty rect the recorder finds the changes itself, so the idle tick after it is not written
+        recorder->publish(SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, false, first.data()}, &whole, 1, 1, "test");
+        recorder->publish(SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, false, first.data()}, &whole, 1, 1, "test");
+    }
+    // as if the recorder died before its index was written, the index is rebuilt from the records
+    std::vector<char> bytes;
+    if (auto file = std::fopen(path, "rb")) {
+        char buffer[4096];
+        for (size_t size; (size = std::fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+            bytes.insert(bytes.end(), buffer, buffer + size);
+        }
+        std::fclose(file);
+    }
+    auto file = std::fopen(crashed, "wb");
+    if (bytes.empty() || !file || std::fwrite(bytes.data(), 1, bytes.size() - 1, file) != bytes.size() - 1)
+        std::abort();
+    std::fclose(file);
+
+    const std::vector<SL::Screen_Capture::ImageBGRA> *frames[] = {&first, &second, &first};
+    for (auto recording : {path, keyframes, crashed}) {
+        auto reader = SL::Screen_Capture::OpenRecording(recording);
+        if (!reader || reader->sources() != std::vector<long long>{1})
+            std::abort();
+        std::chrono::microseconds timestamps[3], after(-1);
+        for (auto &t : timestamps) {
+            if (!reader->nextFrame(1, after, t))
+                std::abort();
+            after = t;
+        }
+        if (reader->nextFrame(1, after, after) || reader->duration() != timestamps[2])
+            std::abort();
+        // forward, back to the first frame, forward past the second and back to it
+        for (auto i : {0, 1, 2, 0, 2, 1}) {
+            SL::Screen_Capture::Image image;
+            if (!reader->frameAt(1, timestamps[i], image) || SL::Screen_Capture::Width(image) != static_cast<int>(WIDTH) ||
+                SL::Screen_Capture::Height(image) != static_cast<int>(HEIGHT))
+                std::abort();
+            for (unsigned row(0); row < HEIGHT; ++row) {
+                auto src = reinterpret_cast<const SL::Screen_Capture::ImageBGRA *>(
+                    reinterpret_cast<const unsigned char *>(SL::Screen_Capture::StartSrc(image)) + row * image.RowStrideInBytes);
+                for (unsigned col(0); col < WIDTH; ++col) {
+                    auto &b = (*frames[i])[row * (WIDTH + PADDING) + col];
+                    if (src[col].B != b.B || src[col].G != b.G || src[col].R != b.R)
+                        std::abort();
+                }
+            }
+        }
+    }
+    std::remove(path);
+    std::remove(keyframes);
+    std::remove(crashed);
+}
+
+void TestReplay()
+{
+    using namespace PaddedFrames;
+    auto [first, second] = PaddedFrames::Create();
+    const auto path = "screen_capture_lite_test_replay.sclr";
+    const std::vector<SL::Screen_Capture::ImageBGRA> *frames[] = {&first, &second, &first};
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT);
+    {
+        auto recorder = SL::Screen_Capture::CreateFrameRecorder(path);
+        if (!recorder)
+            std::abort();
+        for (auto frame : frames) {
+            recorder->publish(SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, false, frame->data()}, &whole, 1, 1, "test");
+        }
+    }
+    // the difs are put together the way a consumer would, the new frames are compared as they are
+    std::vector<SL::Screen_Capture::ImageBGRA> mirror(WIDTH * HEIGHT);
+    const auto same = [&](const unsigned char *src, int rowstride, const std::vector<SL::Screen_Capture::ImageBGRA> &frame) {
+        for (unsigned row(0); row < HEIGHT; ++row) {
+            auto pixels = reinterpret_cast<const SL::Screen_Capture::ImageBGRA *>(src + row * rowstride);
+            for (unsigned col(0); col < WIDTH; ++col) {
+                auto &b = frame[row * (WIDTH + PADDING) + col];
+                if (pixels[col].B != b.B || pixels[col].G != b.G || pixels[col].R != b.R)
+                    return false;
+            }
+        }
+        return true;
+    };
+    // the callbacks all come from the thread of the one recorded source
+    std::atomic<int> newframes(0);
+    unsigned long long sequence(0);
+    auto framegrabber =
+        SL::Screen_Capture::CreateReplayConfiguration(path, 0)
+            ->onNewFrame([&](const SL::Screen_Capture::Image &img, const SL::Screen_Capture::Monitor &monitor) {
+                // onFrameChanged comes after this, the mirror still holds the frame before
+                auto n = newframes.load();
+                if (n >= 3 || SL::Screen_Capture::Id(monitor) != 1 || SL::Screen_Capture::Width(img) != static_cast<int>(WIDTH) ||
+                    SL::Screen_Capture::Height(img) != static_cast<int>(HEIGHT) || img.Sequence <= sequence ||
+                    !same(reinterpret_cast<const unsigned char *>(SL::Screen_Capture::StartSrc(img)), img.RowStrideInBytes, *frames[n]) ||
+                    (n > 0 && !same(reinterpret_cast<const unsigned char *>(mirror.data()), WIDTH * sizeof(SL::Screen_Capture::ImageBGRA),
+                                    *frames[n - 1])))
+                    std::abort();
+                sequence = img.Sequence;
+                newframes = n + 1;
+            })
+            ->onFrameChanged([&](const SL::Screen_Capture::Image &img, const SL::Screen_Capture::Monitor &) {
+                if (img.Sequence != sequence || img.Bounds.left < 0 || img.Bounds.top < 0 || img.Bounds.right > static_cast<int>(WIDTH) ||
+                    img.Bounds.bottom > static_cast<int>(HEIGHT))
+                    std::abort();
+                for (auto row = img.Bounds.top; row < img.Bounds.bottom; ++row) {
+                    memcpy(&mirror[row * WIDTH + img.Bounds.left],
+                           reinterpret_cast<const unsigned char *>(SL::Screen_Capture::StartSrc(img)) + (row - img.Bounds.top) * img.RowStrideInBytes,
+                           SL::Screen_Capture::Width(img) * sizeof(SL::Screen_Capture::ImageBGRA));
+                }
+            })
+            ->start_capturing();
+    // played as fast as the callbacks take the frames, the source stops at the end of the recording
+    for (int i(0); i < 500 && newframes < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    framegrabber.reset();
+    if (newframes != 3 || !same(reinterpret_cast<const unsigned char *>(mirror.data()), WIDTH * sizeof(SL::Screen_Capture::ImageBGRA), first))
+        std::abort();
+    std::remove(path);
+}
+
+void TestSharedFrames()
+{
+#if defined(__linux__)
+    using namespace PaddedFrames;
+    auto [first, second] = PaddedFrames::Create();
+    const auto path = "screen_capture_lite_test.sock";
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT), changed(0, 2, WIDTH, 3);
+    constexpr int SLOTS(4);
+    auto publisher = SL::Screen_Capture::CreateFramePublisher(path, 64, 64, SLOTS);
+    if (!publisher)
+        std::abort();
+    // the consumer gets its own, read only mapping of the segment
+    auto consumer = SCL_OpenSharedFrames(path);
+    if (!consumer || SCL_WaitForSharedFrame(consumer, 0, 0) != 0)
+        std::abort();
+    publisher->publish(SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, false, first.data()}, &whole, 1, 7, "test");
+    publisher->publish(SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, false, second.data()}, &changed, 1, 7, "test");
+
+    SCL_SharedFrame frame;
+    if (SCL_WaitForSharedFrame(consumer, 1, 0) != 1 || SCL_AcquireSharedFrame(consumer, &frame) != 1)
+        std::abort();
+    if (frame.Sequence != 2 || frame.PreviousSequence != 1 || frame.Source != 7 || std::string(frame.Name) != "test" || frame.Width != WIDTH ||
+        frame.Height != HEIGHT || frame.DirtyRectCount != 1 || frame.DirtyRects[0].top != 2 || frame.DirtyRects[0].bottom != 3)
+        std::abort();
+    for (unsigned row(0); row < HEIGHT; ++row) {
+        auto src = reinterpret_cast<const SL::Screen_Capture::ImageBGRA *>(frame.Data + row * frame.RowStrideInBytes);
+        for (unsigned col(0); col < WIDTH; ++col) {
+            auto &b = second[row * (WIDTH + PADDING) + col];
+            if (src[col].B != b.B || src[col].G != b.G || src[col].R != b.R)
+                std::abort();
+        }
+    }
+    if (SCL_IsSharedFrameValid(consumer, &frame) != 1)
+        std::abort();
+    // once the publisher went around the ring the slot is someone else's
+    for (int i(0); i < SLOTS; ++i) {
+        publisher->publish(SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, false, first.data()}, &whole, 1, 7, "test");
+    }
+    if (SCL_IsSharedFrameValid(consumer, &frame) != 0)
+        std::abort();
+    SCL_CloseSharedFrames(consumer);
+#endif
+}
+
+void TestClusterRegions()
+{
+    auto region = [](int left, int top, int right, int bottom) {
+        SL::Screen_Capture::Region r;
+        r.Rect = SL::Screen_Capture::ImageRect(left, top, right, bottom);
+        return r;
+    };
+    // 0 and 1 overlap, 2 only touches the edge of 1 and 3 is on its own
+    auto clusters = SL::Screen_Capture::ClusterRegions({region(0, 0, 100, 100), region(50, 50, 150, 150), region(150, 0, 200, 50),
+                                                        region(300, 300, 400, 400)});
+    if (clusters.size() != 3)
+        std::abort();
+    for (auto &c : clusters) {
+        std::sort(c.Regions.begin(), c.Regions.end());
+    }
+    std::sort(clusters.begin(), clusters.end(), [](const SL::Screen_Capture::RegionCluster &a, const SL::Screen_Capture::RegionCluster &b) {
+        return a.Regions.front() < b.Regions.front();
+    });
+    if (!(clusters[0].Bounds == SL::Screen_Capture::ImageRect(0, 0, 150, 150)) || clusters[0].Regions != std::vector<size_t>{0, 1})
+        std::abort();
+    if (!(clusters[1].Bounds == SL::Screen_Capture::ImageRect(150, 0, 200, 50)) || clusters[1].Regions != std::vector<size_t>{2})
+        std::abort();
+    if (!(clusters[2].Bounds == SL::Screen_Capture::ImageRect(300, 300, 400, 400)) || clusters[2].Regions != std::vector<size_t>{3})
+        std::abort();
+
+    // a region over the gap joins the clusters on both sides into one
+    clusters = SL::Screen_Capture::ClusterRegions({region(0, 0, 10, 10), region(20, 0, 30, 10), region(5, 5, 25, 6)});
+    if (clusters.size() != 1 || !(clusters[0].Bounds == SL::Screen_Capture::ImageRect(0, 0, 30, 10)) || clusters[0].Regions.size() != 3)
+        std::abort();
+}
+
+void TestMoveDetection()
+{
+    constexpr int WIDTH(200), HEIGHT(120), ROWS(13);
+    constexpr int STRIDE_IN_BYTES(WIDTH * sizeof(SL::Screen_Capture::ImageBGRA));
+
+    // noise, so no two rows look alike
+    unsigned seed(1);
+    auto noise = [&] {
+        seed = seed * 1664525u + 1013904223u;
+        return SL::Screen_Capture::ImageBGRA{static_cast<unsigned char>(seed >> 8), static_cast<unsigned char>(seed >> 16),
+                                             static_cast<unsigned char>(seed >> 24), 0};
+    };
+    std::vector<SL::Screen_Capture::ImageBGRA> previous(WIDTH * HEIGHT), current(WIDTH * HEIGHT);
+    for (auto &p : previous) {
+        p = noise();
+    }
+    // scrolled up by ROWS, the rows that came into view are new
+    for (int row(0); row < HEIGHT; ++row) {
+        for (int col(0); col < WIDTH; ++col) {
+            current[row * WIDTH + col] = row < HEIGHT - ROWS ? previous[(row + ROWS) * WIDTH + col] : noise();
+        }
+    }
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT);
+    auto reference = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, previous.data()};
+    auto image = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, current.data()};
+
+    SL::Screen_Capture::ImageMove move;
+    if (!SL::Screen_Capture::DetectMove(reference, image, SL::Screen_Capture::GetDifs(reference, image), move))
+        std::abort();
+    if (!(move.Source == SL::Screen_Capture::ImageRect(0, ROWS, WIDTH, HEIGHT)) || move.Destination.x != 0 || move.Destination.y != 0)
+        std::abort();
+
+    // the moved frame only differs from the new one where the new rows came in
+    auto moved = previous;
+    SL::Screen_Capture::ApplyMove(reinterpret_cast<unsigned char *>(moved.data()), STRIDE_IN_BYTES, move);
+    auto movedimage = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, moved.data()};
+    if (memcmp(moved.data(), current.data(), (HEIGHT - ROWS) * STRIDE_IN_BYTES))
+        std::abort();
+    std::copy(current.begin() + (HEIGHT - ROWS) * WIDTH, current.end(), moved.begin() + (HEIGHT - ROWS) * WIDTH);
+    if (!SL::Screen_Capture::GetDifs(movedimage, image).empty())
+        std::abort();
+
+    // content that has nothing to do with the last frame is no move
+    for (auto &p : current) {
+        p = noise();
+    }
+    if (SL::Screen_Capture::DetectMove(reference, image, SL::Screen_Capture::GetDifs(reference, image), move))
+        std::abort();
+}
+
+// by pixel, whether one of rects covers it
+std::vector<bool> Covered(const std::vector<SL::Screen_Capture::ImageRect> &rects, int width, int height)
+{
+    std::vector<bool> covered(width * height);
+    for (const auto &r : rects) {
+        if (r.left < 0 || r.top < 0 || r.right > width || r.bottom > height)
+            std::abort();
+        for (int row(r.top); row < r.bottom; ++row) {
+            for (int col(r.left); col < r.right; ++col) {
+                covered[row * width + col] = true;
+            }
+        }
+    }
+    return covered;
+}
+
+void TestIgnoreRects()
+{
+    constexpr int WIDTH(64), HEIGHT(48), BLOCKSIZE(8);
+    constexpr int STRIDE_IN_BYTES(WIDTH * sizeof(SL::Screen_Capture::ImageBGRA));
+
+    std::vector<SL::Screen_Capture::ImageBGRA> previous(WIDTH * HEIGHT, SL::Screen_Capture::ImageBGRA{10, 20, 30, 0}), current(previous);
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT);
+    auto reference = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, previous.data()};
+    auto image = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, current.data()};
+
+    // a clock ticking inside the ignored rect
+    current[10 * WIDTH + 10].R = 200;
+    const std::vector<SL::Screen_Capture::ImageRect> ignore{SL::Screen_Capture::ImageRect(5, 5, 20, 12)};
+    if (SL::Screen_Capture::GetDifs(reference, image).empty())
+        std::abort();
+    if (!SL::Screen_Capture::GetDifs(reference, image, ignore, {}, BLOCKSIZE).empty())
+        std::abort();
+
+    // a change next to it in the same block still shows up
+    current[12 * WIDTH + 10].R = 200;
+    auto difs = SL::Screen_Capture::GetDifs(reference, image, ignore, {}, BLOCKSIZE);
+    auto covered = Covered(difs, WIDTH, HEIGHT);
+    if (!covered[12 * WIDTH + 10] || std::count(covered.begin(), covered.end(), true) != BLOCKSIZE * BLOCKSIZE)
+        std::abort();
+}
+
+void TestDiffTolerance()
+{
+    constexpr int WIDTH(64), HEIGHT(48), BLOCKSIZE(8);
+    constexpr int STRIDE_IN_BYTES(WIDTH * sizeof(SL::Screen_Capture::ImageBGRA));
+
+    std::vector<SL::Screen_Capture::ImageBGRA> previous(WIDTH * HEIGHT, SL::Screen_Capture::ImageBGRA{100, 100, 100, 255}), current(previous);
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT);
+    auto reference = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, previous.data()};
+    auto image = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, current.data()};
+    SL::Screen_Capture::DiffTolerance tolerance;
+    tolerance.B = 4;
+
+    // flicker in the lowest bits, in both directions
+    current[3 * WIDTH + 3].B = 104;
+    current[40 * WIDTH + 60].B = 96;
+    if (SL::Screen_Capture::GetDifs(reference, image).empty())
+        std::abort();
+    if (!SL::Screen_Capture::GetDifs(reference, image, {}, tolerance, BLOCKSIZE).empty())
+        std::abort();
+    current[40 * WIDTH + 60].B = 95;
+    auto covered = Covered(SL::Screen_Capture::GetDifs(reference, image, {}, tolerance, BLOCKSIZE), WIDTH, HEIGHT);
+    if (!covered[40 * WIDTH + 60] || covered[3 * WIDTH + 3])
+        std::abort();
+
+    // alpha is only left out when asked to
+    current = previous;
+    current[20 * WIDTH + 20].A = 0;
+    if (SL::Screen_Capture::GetDifs(reference, image, {}, tolerance, BLOCKSIZE).empty())
+        std::abort();
+    tolerance.IgnoreAlpha = true;
+    if (!SL::Screen_Capture::GetDifs(reference, image, {}, tolerance, BLOCKSIZE).empty())
+        std::abort();
+
+    // too few changed pixels are noise
+    tolerance.MinChangedPixels = 3;
+    current[20 * WIDTH + 20].R = 0;
+    current[21 * WIDTH + 21].R = 0;
+    if (!SL::Screen_Capture::GetDifs(reference, image, {}, tolerance, BLOCKSIZE).empty())
+        std::abort();
+    current[22 * WIDTH + 22].R = 0;
+    if (SL::Screen_Capture::GetDifs(reference, image, {}, tolerance, BLOCKSIZE).empty())
+        std::abort();
+}
+
+void TestDiffBlockSize()
+{
+    // not a multiple of the tile or block size either way
+    constexpr int WIDTH(300), HEIGHT(70), BLOCKSIZE(16);
+    constexpr int STRIDE_IN_BYTES(WIDTH * sizeof(SL::Screen_Capture::ImageBGRA));
+
+    std::vector<SL::Screen_Capture::ImageBGRA> previous(WIDTH * HEIGHT, SL::Screen_Capture::ImageBGRA{1, 2, 3, 0}), current(previous);
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT);
+    auto reference = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, previous.data()};
+    auto image = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, current.data()};
+
+    const std::vector<std::pair<int, int>> changes{{5, 5}, {140, 40}, {260, 3}, {299, 69}};
+    for (auto &c : changes) {
+        current[c.second * WIDTH + c.first].G = 9;
+    }
+    auto difs = SL::Screen_Capture::GetDifs(reference, image, {}, {}, BLOCKSIZE);
+    for (auto &r : difs) {
+        if (r.left % BLOCKSIZE || r.top % BLOCKSIZE || (r.right % BLOCKSIZE && r.right != WIDTH) || (r.bottom % BLOCKSIZE && r.bottom != HEIGHT))
+            std::abort();
+    }
+    // only the blocks with a change in them, the one in the corner is cut off by the edges
+    auto covered = Covered(difs, WIDTH, HEIGHT);
+    for (auto &c : changes) {
+        if (!covered[c.second * WIDTH + c.first])
+            std::abort();
+    }
+    if (std::count(covered.begin(), covered.end(), true) != 3 * BLOCKSIZE * BLOCKSIZE + (WIDTH - 288) * (HEIGHT - 64))
+        std::abort();
+
+    // whole tiles without the refinement
+    covered = Covered(SL::Screen_Capture::GetDifs(reference, image), WIDTH, HEIGHT);
+    if (std::count(covered.begin(), covered.end(), true) != WIDTH * HEIGHT)
+        std::abort();
+}
+
+void TestChangeHistory()
+{
+    constexpr int WIDTH(100), HEIGHT(70), BLOCKSIZE(32);
+    SL::Screen_Capture::ImageRect frame(0, 0, WIDTH, HEIGHT);
+    SL::Screen_Capture::ChangeHistory history;
+    std::vector<SL::Screen_Capture::ImageRect> rects;
+    if (SL::Screen_Capture::ChangesSince(history, 0, rects))
+        std::abort();
+    // how many pixels the rects changed since sequence cover, they are not always merged into one
+    auto changed = [&](unsigned long long sequence, int width, int height) {
+        if (!SL::Screen_Capture::ChangesSince(history, sequence, rects))
+            std::abort();
+        auto covered = Covered(rects, width, height);
+        return std::count(covered.begin(), covered.end(), true);
+    };
+
+    // everything changed in the first frame, frame 2 and 3 change one block each
+    SL::Screen_Capture::RecordChanges(history, 1, frame, BLOCKSIZE, {});
+    SL::Screen_Capture::RecordChanges(history, 2, frame, BLOCKSIZE, {SL::Screen_Capture::ImageRect(40, 10, 50, 20)});
+    SL::Screen_Capture::RecordChanges(history, 3, frame, BLOCKSIZE, {SL::Screen_Capture::ImageRect(97, 65, 100, 70)});
+    if (changed(0, WIDTH, HEIGHT) != WIDTH * HEIGHT)
+        std::abort();
+    if (changed(1, WIDTH, HEIGHT) != BLOCKSIZE * BLOCKSIZE + (WIDTH - 96) * (HEIGHT - 64) || !Covered(rects, WIDTH, HEIGHT)[10 * WIDTH + 40])
+        std::abort();
+    if (changed(2, WIDTH, HEIGHT) != (WIDTH - 96) * (HEIGHT - 64) || !(rects[0] == SL::Screen_Capture::ImageRect(96, 64, 100, 70)))
+        std::abort();
+    if (changed(3, WIDTH, HEIGHT) != 0)
+        std::abort();
+
+    // a resize forgets the old versions, whoever is behind it gets the whole frame
+    SL::Screen_Capture::RecordChanges(history, 4, SL::Screen_Capture::ImageRect(0, 0, 50, 40), BLOCKSIZE, {});
+    if (changed(1, 50, 40) != 50 * 40 || changed(3, 50, 40) != 50 * 40 || changed(4, 50, 40) != 0)
+        std::abort();
+}
+
+void TestTileCache()
 {
-    assert(dst_size >= static_cast<size_t>(SL::Screen_Capture::Width(img) * SL::Screen_Capture::Height(img) * sizeof(SL::Screen_Capture::ImageBGRA)));
-    auto imgsrc = StartSrc(img);
-    auto imgdist = dst;
-    for (auto h = 0; h < Height(img); h++) {
-        auto startimgsrc = imgsrc;
-        for (auto w = 0; w < Width(img); w++) {
-            *imgdist++ = imgsrc->R;
-            *imgdist++ = imgsrc->G;
-            *imgdist++ = imgsrc->B;
-            *imgdist++ = 0; // alpha should be zero
-            imgsrc++;
+    // 16 slots, so hashes ending in 0xF all want the last one and their probes wrap around to the first
+    SL::Screen_Capture::TileCache cache;
+    cache.setCapacity(4);
+    for (uint64_t hash : {0x0F, 0x1F, 0x2F, 0x05}) {
+        if (cache.use(hash, 1))
+            std::abort();
+    }
+    // added by this frame, its pixels are not out yet
+    if (cache.use(0x0F, 1))
+        std::abort();
+    if (!cache.use(0x1F, 2) || !cache.use(0x2F, 2) || !cache.use(0x05, 2))
+        std::abort();
+
+    // 0x0F is the oldest and goes, the blocks behind it in the wrapped probe chain still have to be found
+    if (cache.use(0x06, 3))
+        std::abort();
+    if (!cache.use(0x1F, 4) || !cache.use(0x2F, 4) || !cache.use(0x05, 4) || !cache.use(0x06, 4))
+        std::abort();
+    if (cache.use(0x0F, 5))
+        std::abort();
+    // which pushed out 0x1F, the least recently used
+    if (cache.use(0x1F, 6) || !cache.use(0x0F, 6))
+        std::abort();
+
+    // the blocks of a frame through the cache, the two that look the same are no hit in the frame they appear in
+    constexpr int WIDTH(64), HEIGHT(64), BLOCKSIZE(32);
+    constexpr int STRIDE_IN_BYTES(WIDTH * sizeof(SL::Screen_Capture::ImageBGRA));
+    std::vector<SL::Screen_Capture::ImageBGRA> pixels(WIDTH * HEIGHT);
+    for (int row(0); row < HEIGHT; ++row) {
+        for (int col(0); col < WIDTH; ++col) {
+            pixels[row * WIDTH + col] = SL::Screen_Capture::ImageBGRA{static_cast<unsigned char>(row < BLOCKSIZE ? 1 : col), 2, 3, 0};
+        }
+    }
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT);
+    auto image = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, pixels.data()};
+    SL::Screen_Capture::TileCache tiles;
+    tiles.setCapacity(16);
+    SL::Screen_Capture::DiffScratch scratch;
+    if (SL::Screen_Capture::LookupTiles(tiles, image, {whole}, BLOCKSIZE, 1, true, scratch) != 0 || scratch.CachedTiles.size() != 4)
+        std::abort();
+    if (scratch.CachedTiles[0].Hash != scratch.CachedTiles[1].Hash || scratch.CachedTiles[2].Hash == scratch.CachedTiles[3].Hash)
+        std::abort();
+    auto covered = Covered(scratch.Uncached, WIDTH, HEIGHT);
+    if (std::count(covered.begin(), covered.end(), true) != WIDTH * HEIGHT)
+        std::abort();
+    if (SL::Screen_Capture::LookupTiles(tiles, image, {whole}, BLOCKSIZE, 2, true, scratch) != 4 || !scratch.Uncached.empty())
+        std::abort();
+}
+
+void TestHashDifs()
+{
+    constexpr int WIDTH(300), HEIGHT(70), BLOCKSIZE(16);
+    constexpr int STRIDE_IN_BYTES(WIDTH * sizeof(SL::Screen_Capture::ImageBGRA));
+
+    unsigned seed(7);
+    auto noise = [&] {
+        seed = seed * 1664525u + 1013904223u;
+        return SL::Screen_Capture::ImageBGRA{static_cast<unsigned char>(seed >> 8), static_cast<unsigned char>(seed >> 16),
+                                             static_cast<unsigned char>(seed >> 24), 0};
+    };
+    std::vector<SL::Screen_Capture::ImageBGRA> previous(WIDTH * HEIGHT);
+    for (auto &p : previous) {
+        p = noise();
+    }
+    auto current = previous;
+    for (auto i(0); i < 12; ++i) {
+        current[(seed >> 8) % (WIDTH * HEIGHT)].G ^= 1;
+        noise();
+    }
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT);
+    auto reference = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, previous.data()};
+    auto image = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, current.data()};
+
+    SL::Screen_Capture::DiffScratch scratch;
+    std::vector<uint64_t> hashes;
+    std::vector<SL::Screen_Capture::ImageRect> rects;
+    for (const auto &ignore : {std::vector<SL::Screen_Capture::ImageRect>{}, {SL::Screen_Capture::ImageRect(20, 10, 150, 50)}}) {
+        // without hashes of the last frame everything changed
+        hashes.clear();
+        SL::Screen_Capture::GetHashDifs(reference, ignore, BLOCKSIZE, hashes, scratch, rects);
+        auto covered = Covered(rects, WIDTH, HEIGHT);
+        if (std::count(covered.begin(), covered.end(), true) != WIDTH * HEIGHT)
+            std::abort();
+        SL::Screen_Capture::GetHashDifs(image, ignore, BLOCKSIZE, hashes, scratch, rects);
+        auto difs = SL::Screen_Capture::GetDifs(reference, image, ignore, {}, BLOCKSIZE);
+        if (difs.empty() || Covered(rects, WIDTH, HEIGHT) != Covered(difs, WIDTH, HEIGHT))
+            std::abort();
+        // the hashes are those of the new frame now
+        SL::Screen_Capture::GetHashDifs(image, ignore, BLOCKSIZE, hashes, scratch, rects);
+        if (!rects.empty())
+            std::abort();
+    }
+}
+
+void TestNoAllocations()
+{
+    constexpr int WIDTH(640), HEIGHT(360), BLOCKSIZE(32);
+    constexpr int STRIDE_IN_BYTES(WIDTH * sizeof(SL::Screen_Capture::ImageBGRA));
+
+    // a capture thread without the platform, the frames go straight to ProcessCapture
+    auto data = std::make_shared<SL::Screen_Capture::Thread_Data>();
+    auto &capture = data->ScreenCaptureData;
+    int changed(0);
+    capture.OnNewFrame = [](const SL::Screen_Capture::Image &, const SL::Screen_Capture::Monitor &) {};
+    capture.OnFrameChanged = [&](const SL::Screen_Capture::Image &, const SL::Screen_Capture::Monitor &) { changed++; };
+    capture.DiffBlockSize = BLOCKSIZE;
+    capture.TileCacheCapacity = 64;
+    auto monitor = SL::Screen_Capture::CreateMonitor(0, 7, HEIGHT, WIDTH, 0, 0, "test", 1.0f);
+    auto ignore = std::make_shared<SL::Screen_Capture::IgnoreRectMap>();
+    (*ignore)[SL::Screen_Capture::SourceId(monitor)] = {SL::Screen_Capture::ImageRect(600, 0, 640, 20)};
+    capture.IgnoreRects = ignore;
+    SL::Screen_Capture::BaseFrameProcessor base;
+    base.ImageBufferSize = HEIGHT * STRIDE_IN_BYTES;
+    base.ImageBuffer = std::make_unique<unsigned char[]>(base.ImageBufferSize);
+
+    std::vector<SL::Screen_Capture::ImageBGRA> pixels(WIDTH * HEIGHT, SL::Screen_Capture::ImageBGRA{40, 40, 40, 0});
+    for (int frame(0); frame < 100; ++frame) {
+        // typing: the same number of blocks changes every frame, somewhere else each time. The clock in the corner is ignored
+        for (int block(0); block < 3; ++block) {
+            auto left = (frame * 3 + block) * BLOCKSIZE % WIDTH;
+            auto top = (frame + block * 4) % (HEIGHT / BLOCKSIZE) * BLOCKSIZE;
+            for (int row(top); row < top + BLOCKSIZE; ++row) {
+                pixels[row * WIDTH + left + frame % BLOCKSIZE].G++;
+            }
+        }
+        pixels[5 * WIDTH + 620].R++;
+        // the first frame goes out whole and the second one is the first diffed, they set up the memory every later frame runs on
+        countallocations = frame > 1;
+        allocations = 0;
+        SL::Screen_Capture::ProcessCapture(capture, base, monitor, reinterpret_cast<const unsigned char *>(pixels.data()), STRIDE_IN_BYTES);
+        countallocations = false;
+        if (allocations)
+            std::abort();
+    }
+    if (changed < 99 * 3 || capture.Statistics.FramesWithAllocations > 2)
+        std::abort();
+}
+
+void TestCursor()
+{
+    constexpr int WIDTH(40), HEIGHT(20), PADDING(3), GUARD_ROWS(2), CURSOR_WIDTH(11), CURSOR_HEIGHT(7);
+    constexpr int STRIDE_IN_BYTES((WIDTH + PADDING) * sizeof(SL::Screen_Capture::ImageBGRA));
+
+    // odd width, so a row is blended 4 pixels at a time and the rest one by one. Premultiplied, from transparent to opaque
+    std::vector<uint32_t> argb(CURSOR_WIDTH * CURSOR_HEIGHT);
+    for (int row(0); row < CURSOR_HEIGHT; ++row) {
+        for (int col(0); col < CURSOR_WIDTH; ++col) {
+            const uint32_t alpha[] = {0, 64, 128, 200, 255};
+            auto a = alpha[(col * 3 + row) % 5];
+            argb[row * CURSOR_WIDTH + col] = a << 24 | (a * col / CURSOR_WIDTH) << 16 | (a / 2) << 8 | (a * row / CURSOR_HEIGHT);
+        }
+    }
+    SL::Screen_Capture::CursorSprite cursor;
+    SL::Screen_Capture::SetCursorImage(cursor, CURSOR_WIDTH, CURSOR_HEIGHT, argb.data());
+    cursor.Visible = true;
+
+    // rows past the frame and the padding of every row must not be touched
+    std::vector<unsigned char> frame((HEIGHT + GUARD_ROWS) * STRIDE_IN_BYTES);
+    for (size_t i(0); i < frame.size(); ++i) {
+        frame[i] = static_cast<unsigned char>(i * 7);
+    }
+    const auto original = frame;
+    // inside the frame at every offset to the 4 pixel groups, then hanging over each edge
+    const std::vector<SL::Screen_Capture::Point> positions{{0, 2}, {1, 2}, {2, 3}, {3, 4}, {WIDTH - 4, HEIGHT - 3}, {-5, -2}};
+    for (const auto &position : positions) {
+        cursor.Position = position;
+        SL::Screen_Capture::DrawCursor(frame.data(), STRIDE_IN_BYTES, WIDTH, HEIGHT, cursor);
+        auto &drawn = cursor.Drawn;
+        if (drawn.left < 0 || drawn.top < 0 || drawn.right > WIDTH || drawn.bottom > HEIGHT || !cursor.Changed)
+            std::abort();
+        for (int row(0); row < HEIGHT + GUARD_ROWS; ++row) {
+            for (int col(0); col < WIDTH + PADDING; ++col) {
+                auto x = col - position.x, y = row - position.y;
+                auto inside = col < WIDTH && row < HEIGHT && x >= 0 && x < CURSOR_WIDTH && y >= 0 && y < CURSOR_HEIGHT;
+                for (int channel(0); channel < 4; ++channel) {
+                    auto offset = row * STRIDE_IN_BYTES + col * 4 + channel;
+                    int expected = original[offset];
+                    if (inside) {
+                        // the scalar blend, premultiplied over
+                        int source = argb[y * CURSOR_WIDTH + x] >> (channel * 8) & 0xFF, alpha = argb[y * CURSOR_WIDTH + x] >> 24;
+                        auto t = expected * (255 - alpha) + 128;
+                        expected = std::min(255, source + ((t + (t >> 8)) >> 8));
+                    }
+                    if (frame[offset] != expected)
+                        std::abort();
+                }
+            }
+        }
+        // what was under it comes back
+        SL::Screen_Capture::EraseCursor(frame.data(), STRIDE_IN_BYTES, cursor);
+        if (frame != original)
+            std::abort();
+    }
+
+    // the blocks the cursor left and the ones it went to are added to the difs
+    constexpr int BLOCKSIZE(16);
+    SL::Screen_Capture::ImageRect bounds(0, 0, 64, 48);
+    std::vector<SL::Screen_Capture::ImageRect> rects{SL::Screen_Capture::ImageRect(0, 0, BLOCKSIZE, BLOCKSIZE)};
+    SL::Screen_Capture::DiffScratch scratch;
+    SL::Screen_Capture::AddDirtyBlocks(rects, {SL::Screen_Capture::ImageRect(20, 20, 31, 27), SL::Screen_Capture::ImageRect(40, 30, 51, 37)},
+                                       bounds, BLOCKSIZE, scratch);
+    auto covered = Covered(rects, 64, 48);
+    if (std::count(covered.begin(), covered.end(), true) != 6 * BLOCKSIZE * BLOCKSIZE)
+        std::abort();
+    for (auto pixel : {0, 20 * 64 + 20, 26 * 64 + 30, 30 * 64 + 40, 36 * 64 + 50, 47 * 64 + 63}) {
+        if (!covered[pixel])
+            std::abort();
+    }
+}
+
+void TestMoveAcrossIgnoreRects()
+{
+    constexpr int WIDTH(200), HEIGHT(120), ROWS(13);
+    constexpr int STRIDE_IN_BYTES(WIDTH * sizeof(SL::Screen_Capture::ImageBGRA));
+    const SL::Screen_Capture::ImageRect clock(50, 60, 90, 70);
+
+    unsigned seed(3);
+    auto noise = [&] {
+        seed = seed * 1664525u + 1013904223u;
+        return SL::Screen_Capture::ImageBGRA{static_cast<unsigned char>(seed >> 8), static_cast<unsigned char>(seed >> 16),
+                                             static_cast<unsigned char>(seed >> 24), 0};
+    };
+    std::vector<SL::Screen_Capture::ImageBGRA> pixels(WIDTH * HEIGHT);
+    for (auto &p : pixels) {
+        p = noise();
+    }
+
+    // what a consumer rebuilds from the moves and difs
+    std::vector<SL::Screen_Capture::ImageBGRA> mirror(WIDTH * HEIGHT);
+    auto data = std::make_shared<SL::Screen_Capture::Thread_Data>();
+    auto &capture = data->ScreenCaptureData;
+    capture.OnFrameChanged = [&](const SL::Screen_Capture::Image &img, const SL::Screen_Capture::Monitor &) {
+        auto &r = img.Bounds;
+        auto row = reinterpret_cast<const unsigned char *>(SL::Screen_Capture::StartSrc(img));
+        for (int y(r.top); y < r.bottom; ++y, row += img.RowStrideInBytes) {
+            memcpy(&mirror[y * WIDTH + r.left], row, SL::Screen_Capture::Width(r) * sizeof(SL::Screen_Capture::ImageBGRA));
+        }
+    };
+    capture.OnFrameMoved = [&](const SL::Screen_Capture::ImageMove &move, const SL::Screen_Capture::Monitor &) {
+        SL::Screen_Capture::ApplyMove(reinterpret_cast<unsigned char *>(mirror.data()), STRIDE_IN_BYTES, move);
+    };
+    capture.DiffBlockSize = 8;
+    auto monitor = SL::Screen_Capture::CreateMonitor(0, 7, HEIGHT, WIDTH, 0, 0, "test", 1.0f);
+    auto ignore = std::make_shared<SL::Screen_Capture::IgnoreRectMap>();
+    (*ignore)[SL::Screen_Capture::SourceId(monitor)] = {clock};
+    capture.IgnoreRects = ignore;
+    SL::Screen_Capture::BaseFrameProcessor base;
+    base.ImageBufferSize = HEIGHT * STRIDE_IN_BYTES;
+    base.ImageBuffer = std::make_unique<unsigned char[]>(base.ImageBufferSize);
+    auto deliver = [&] {
+        SL::Screen_Capture::ProcessCapture(capture, base, monitor, reinterpret_cast<const unsigned char *>(pixels.data()), STRIDE_IN_BYTES);
+    };
+    deliver();
+
+    // the clock ticks without anyone being told, then the panel it sits in scrolls up
+    for (int y(clock.top); y < clock.bottom; ++y) {
+        for (int x(clock.left); x < clock.right; ++x) {
+            pixels[y * WIDTH + x] = noise();
+        }
+    }
+    deliver();
+    std::copy(pixels.begin() + ROWS * WIDTH, pixels.end(), pixels.begin());
+    for (auto p = pixels.end() - ROWS * WIDTH; p != pixels.end(); ++p) {
+        *p = noise();
+    }
+    SL::Screen_Capture::ImageRect whole(0, 0, WIDTH, HEIGHT);
+    auto last = reinterpret_cast<const SL::Screen_Capture::ImageBGRA *>(base.ImageBuffer.get());
+    auto reference = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, last};
+    auto image = SL::Screen_Capture::Image{whole, STRIDE_IN_BYTES, true, pixels.data()};
+    SL::Screen_Capture::ImageMove move;
+    SL::Screen_Capture::DiffScratch scratch;
+    auto difs = SL::Screen_Capture::GetDifs(reference, image);
+    if (!SL::Screen_Capture::DetectMove(reference, image, difs, {}, move, scratch) ||
+        SL::Screen_Capture::DetectMove(reference, image, difs, {clock}, move, scratch))
+        std::abort();
+    deliver();
+
+    // the stale clock must not have been moved into sight
+    for (int y(0); y < HEIGHT; ++y) {
+        for (int x(0); x < WIDTH; ++x) {
+            auto ignored = x >= clock.left && x < clock.right && y >= clock.top && y < clock.bottom;
+            if (!ignored && memcmp(&mirror[y * WIDTH + x], &pixels[y * WIDTH + x], sizeof(SL::Screen_Capture::ImageBGRA)))
+                std::abort();
         }
-        imgsrc = SL::Screen_Capture::GotoNextRow(img, startimgsrc);
     }
 }
 
@@ -369,6 +1238,22 @@ int main()
 
     TestCopyContiguous();
     TestCopyNonContiguous();
+    TestConvert();
+    TestLossless();
+    TestRecording();
+    TestReplay();
+    TestSharedFrames();
+    TestClusterRegions();
+    TestMoveDetection();
+    TestIgnoreRects();
+    TestDiffTolerance();
+    TestDiffBlockSize();
+    TestChangeHistory();
+    TestTileCache();
+    TestHashDifs();
+    TestNoAllocations();
+    TestCursor();
+    TestMoveAcrossIgnoreRects();
 
     std::cout << "Checking for Permission to capture the screen" << std::endl;
     if (SL::Screen_Capture::IsScreenCaptureEnabled()) {
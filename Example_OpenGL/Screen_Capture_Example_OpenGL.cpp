@@ -1,6 +1,7 @@
 #include <glad/gl.h>
 #define GLFW_INCLUDE_NONE
 #include "ScreenCapture.h"
+#include "ScreenCapture_Convert.h"
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <atomic>
@@ -49,33 +50,10 @@ in vec2 TexCoord;
 uniform sampler2D ourTexture;
 void main() {
     vec4 diffColor = texture(ourTexture, TexCoord);
-    FragColor = vec4(diffColor.bgr, diffColor.a);
+    FragColor = diffColor;
 }
 )GLSL";
 
-void ExtractAndConvertToRGBA(const SL::Screen_Capture::Image &img, unsigned char *dst, size_t dst_size)
-{
-    assert(dst_size >= static_cast<size_t>(SL::Screen_Capture::Width(img) * SL::Screen_Capture::Height(img) * sizeof(SL::Screen_Capture::ImageBGRA)));
-    auto imgsrc = StartSrc(img);
-    auto imgdist = dst;
-    if (img.isContiguous) {
-        memcpy(imgdist, imgsrc, dst_size);
-    }
-    else {
-        for (auto h = 0; h < Height(img); h++) {
-            auto startimgsrc = imgsrc;
-            for (auto w = 0; w < Width(img); w++) {
-                *imgdist++ = imgsrc->R;
-                *imgdist++ = imgsrc->G;
-                *imgdist++ = imgsrc->B;
-                *imgdist++ = 0; // alpha should be zero
-                imgsrc++;
-            }
-            imgsrc = SL::Screen_Capture::GotoNextRow(img, startimgsrc);
-        }
-    }
-}
-
 int main(int, char **)
 {
     glfwSetErrorCallback([](int, const char *desc) {
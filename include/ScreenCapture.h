@@ -61,6 +61,8 @@ namespace Screen_Capture {
         int OriginalOffsetY = 0;
         char Name[128] = {0};
         float Scaling = 1.0f;
+        // of the mode the monitor runs at, in Hz. 0 if the platform does not tell
+        float RefreshRate = 0.0f;
     };
     struct SC_LITE_EXTERN ImageRect {
         ImageRect() : ImageRect(0, 0, 0, 0) {}
@@ -72,14 +74,60 @@ namespace Screen_Capture {
         int bottom;
         bool Contains(const ImageRect &a) const { return left <= a.left && right >= a.right && top <= a.top && bottom >= a.bottom; }
     }; 
+    // An arbitrary rect of the desktop that is captured on its own. Rect is in the same coordinates as the monitor offsets (points on
+    // MAC) and may span monitors. Name is only used to tell regions apart in the callbacks.
+    struct SC_LITE_EXTERN Region {
+        ImageRect Rect;
+        char Name[128] = {0};
+    };
+    // A block of the previous frame that shows up at another position in the new frame, e.g. when scrolling. Source is in the coordinates of
+    // the previous frame and Destination is where the top left corner of Source is in the new frame.
+    struct SC_LITE_EXTERN ImageMove {
+        ImageRect Source;
+        Point Destination;
+    };
+    // a block of the changes of a frame looked up in the tile cache, see ICaptureConfiguration::onCachedTiles
+    struct SC_LITE_EXTERN CachedTile {
+        ImageRect Rect;
+        // the pixels of the block without alpha, blocks with the same hash look the same
+        unsigned long long Hash = 0;
+        // the block was in the cache before this frame and is not passed to onFrameChanged
+        bool Hit = false;
+    };
+    // how frames are downscaled when an output scale or a thumbnail is requested. Box averages every pixel of the block that is reduced to
+    // one pixel, Bilinear only samples the 2x2 pixels at the center of the block and is cheaper at 1/4 and 1/8 scale
+    enum class ScaleFilter { Box, Bilinear };
+    // how different the frames have to be for onFrameChanged, see ICaptureConfiguration::setDiffTolerance. The default reports every change
+    struct SC_LITE_EXTERN DiffTolerance {
+        // a pixel changed if the absolute difference of one of its channels is above the threshold of that channel
+        unsigned char B = 0, G = 0, R = 0, A = 0;
+        // alpha is not compared at all, it is garbage on most platforms
+        bool IgnoreAlpha = false;
+        // a tile is only reported once at least this many of its pixels changed
+        int MinChangedPixels = 1;
+    };
+    // what the difs of onFrameChanged are found against, see ICaptureConfiguration::setDiffReference
+    enum class DiffReference { Frame, Hashes };
     struct SC_LITE_EXTERN ImageBGRA {
         unsigned char B, G, R, A;
     };
+    // the memory a frame was captured into, see RetainFrame
+    struct FrameBuffer;
     struct SC_LITE_EXTERN Image {
         ImageRect Bounds;
         int RowStrideInBytes = 0;
         bool isContiguous = false;
         const ImageBGRA *Data = nullptr;
+        // only set on the difs handed to onFrameChanged, the same rect of the previous frame. Lets encoders send what changed per pixel
+        const Image *Reference = nullptr;
+        // set when Data points into a capture buffer that can be kept with RetainFrame
+        FrameBuffer *Owner = nullptr;
+        // the number of the frame, counting the frames of its monitor, window or region from 1. 0 for mouse images
+        unsigned long long Sequence = 0;
+        // when the frame was grabbed, in nanoseconds of MonotonicTime(). 0 for mouse images
+        long long Timestamp = 0;
+        // the frame change interval the frame was grabbed in, in nanoseconds. Timestamps further apart than that mean frames were skipped
+        long long Interval = 0;
     };
 
     inline bool operator==(const ImageRect &a, const ImageRect &b)
@@ -106,6 +154,7 @@ namespace Screen_Capture {
     SC_LITE_EXTERN int OffsetX(const Image &img);
     SC_LITE_EXTERN int OffsetY(const Image &img);
     SC_LITE_EXTERN const char *Name(const Monitor &mointor);
+    SC_LITE_EXTERN float RefreshRate(const Monitor &mointor);
     SC_LITE_EXTERN const char *Name(const Window &mointor);
     SC_LITE_EXTERN int Height(const Monitor &mointor);
     SC_LITE_EXTERN int Width(const Monitor &mointor);
@@ -117,13 +166,29 @@ namespace Screen_Capture {
     SC_LITE_EXTERN void Width(Window &mointor, int w);
     SC_LITE_EXTERN int Height(const Image &img);
     SC_LITE_EXTERN int Width(const Image &img);
+    SC_LITE_EXTERN int Height(const Region &region);
+    SC_LITE_EXTERN int Width(const Region &region);
+    SC_LITE_EXTERN const char *Name(const Region &region);
+    SC_LITE_EXTERN const ImageRect &Rect(const Region &region);
     SC_LITE_EXTERN int X(const Point &p);
     SC_LITE_EXTERN int Y(const Point &p);
+    SC_LITE_EXTERN const ImageRect &Source(const ImageMove &move);
+    SC_LITE_EXTERN const Point &Destination(const ImageMove &move);
 
     // the start of the image data, this is not guarenteed to be contiguous.
     SC_LITE_EXTERN const ImageBGRA *StartSrc(const Image &img);
     SC_LITE_EXTERN const ImageBGRA *GotoNextRow(const Image &img, const ImageBGRA *current);
     SC_LITE_EXTERN bool isDataContiguous(const Image &img);
+    SC_LITE_EXTERN const Image *Reference(const Image &img);
+    SC_LITE_EXTERN unsigned long long Sequence(const Image &img);
+    SC_LITE_EXTERN long long Timestamp(const Image &img);
+    SC_LITE_EXTERN long long Interval(const Image &img);
+    // the clock of Timestamp(const Image &) in nanoseconds, CLOCK_MONOTONIC on linux. Compare it to a timestamp to see how old a frame is
+    SC_LITE_EXTERN long long MonotonicTime();
+    // Keeps the pixels of img valid after the callback returned, so a frame can go to another thread without a copy. Call it inside the
+    // callback, the result describes the same pixels as img. The buffer goes back to the capture thread once the last copy of the result is
+    // gone. Returns null if img can not be held (scaled frames, a frame buffer count of 1, platforms without buffer rotation), copy it then
+    SC_LITE_EXTERN std::shared_ptr<const Image> RetainFrame(const Image &img);
     /*
         this is the ONLY funcion for pulling data out of the Image object and is layed out here in the header so that
         users can see how to extra data and convert it to their own needed format. Initially, I included custom extract functions
@@ -188,8 +253,54 @@ namespace Screen_Capture {
     typedef std::function<void(const SL::Screen_Capture::Image &img, const Window &window)> WindowCaptureCallback;
     typedef std::function<void(const SL::Screen_Capture::Image &img, const Monitor &monitor)> ScreenCaptureCallback;
     typedef std::function<void(const SL::Screen_Capture::Image *img, const MousePoint &mousepoint)> MouseCallback;
+    typedef std::function<void(const ImageMove &move, const Window &window)> WindowMoveCallback;
+    typedef std::function<void(const ImageMove &move, const Monitor &monitor)> ScreenMoveCallback;
+    typedef std::function<void(const SL::Screen_Capture::Image &img, const Region &region)> RegionCaptureCallback;
+    typedef std::function<void(const ImageMove &move, const Region &region)> RegionMoveCallback;
+    typedef std::function<void(const std::vector<CachedTile> &tiles, const Window &window)> WindowTileCallback;
+    typedef std::function<void(const std::vector<CachedTile> &tiles, const Monitor &monitor)> ScreenTileCallback;
+    typedef std::function<void(const std::vector<CachedTile> &tiles, const Region &region)> RegionTileCallback;
     typedef std::function<std::vector<Monitor>()> MonitorCallback;
     typedef std::function<std::vector<Window>()> WindowCallback;
+    typedef std::function<std::vector<Region>()> RegionCallback;
+
+    // maps the frame callback of a capture configuration to the other callback types of the same kind of capture
+    template <typename CAPTURECALLBACK> struct CaptureCallbackTraits;
+    template <> struct CaptureCallbackTraits<ScreenCaptureCallback> {
+        typedef ScreenMoveCallback MoveCallback;
+        typedef ScreenTileCallback TileCallback;
+    };
+    template <> struct CaptureCallbackTraits<WindowCaptureCallback> {
+        typedef WindowMoveCallback MoveCallback;
+        typedef WindowTileCallback TileCallback;
+    };
+    template <> struct CaptureCallbackTraits<RegionCaptureCallback> {
+        typedef RegionMoveCallback MoveCallback;
+        typedef RegionTileCallback TileCallback;
+    };
+
+    // Receives every captured frame with the rects that changed since the last frame of the same source. Implemented by the shared memory
+    // publisher (ScreenCapture_SharedFrames.h) and the recorder (ScreenCapture_Recording.h)
+    class SC_LITE_EXTERN IFramePublisher {
+      public:
+        virtual ~IFramePublisher() {}
+        // source is the monitor id or window handle and name its name. dirtyrects are relative to the last frame published for the same
+        // source. Returns false if the frame could not be published
+        virtual bool publish(const Image &frame, const ImageRect *dirtyrects, size_t dirtycount, long long source, const char *name) = 0;
+        // where the frames go, the socket of the shared memory publisher or the file of the recorder
+        virtual const std::string &path() const = 0;
+    };
+
+    // counters of all sources of a capture since it started, see IScreenCaptureManager::getStatistics
+    struct SC_LITE_EXTERN CaptureStatistics {
+        unsigned long long Frames = 0;
+        // frames the diffing had to allocate memory for. Only the first frames and frames after a change of size, ignore rects or a lot
+        // more changes than before should, a capture running steadily does not allocate
+        unsigned long long FramesWithAllocations = 0;
+        // changed blocks looked up in the tile cache and how many of them were found, see ICaptureConfiguration::onCachedTiles
+        unsigned long long TileLookups = 0;
+        unsigned long long TileHits = 0;
+    };
 
     class SC_LITE_EXTERN IScreenCaptureManager {
       public:
@@ -208,6 +319,27 @@ namespace Screen_Capture {
 
         virtual void setFrameChangeInterval(const std::shared_ptr<Timer> &timer) = 0;
         virtual void setMouseChangeInterval(const std::shared_ptr<Timer> &timer) = 0;
+        // Paces monitors on every divisor-th refresh instead of the frame change interval, so frames are evenly spaced and do not beat
+        // against the refresh rate. At 60 Hz 1 gives 60 frames a second, 2 gives 30. Monitors without a RefreshRate, windows and regions
+        // keep the interval, 0 turns it off. Can be called while capturing
+        virtual void setFrameRefreshDivisor(int divisor) = 0;
+
+        // Changes inside rects are not looked for, so a clock or a blinking caret there never causes onFrameChanged calls. The rects are
+        // relative to the top left of the frames of the monitor, window or region, at full resolution. Replaces the rects set before for it,
+        // an empty list removes them. Can be called while capturing
+        virtual void setIgnoreRects(const Monitor &monitor, const std::vector<ImageRect> &rects) = 0;
+        virtual void setIgnoreRects(const Window &window, const std::vector<ImageRect> &rects) = 0;
+        virtual void setIgnoreRects(const Region &region, const std::vector<ImageRect> &rects) = 0;
+
+        // The rects of the frames of monitor, window or region that changed after frame sequence (see Sequence(const Image &)), what a viewer
+        // showing that frame needs from the latest one to catch up. Returns false if it is not known because the source is not captured with
+        // onFrameChanged or no frame was captured yet, the viewer needs the whole frame then. Can be called from any thread
+        virtual bool getChangesSince(const Monitor &monitor, unsigned long long sequence, std::vector<ImageRect> &rects) const = 0;
+        virtual bool getChangesSince(const Window &window, unsigned long long sequence, std::vector<ImageRect> &rects) const = 0;
+        virtual bool getChangesSince(const Region &region, unsigned long long sequence, std::vector<ImageRect> &rects) const = 0;
+
+        // Can be called while capturing
+        virtual CaptureStatistics getStatistics() const = 0;
 
         // Will pause all capturing
         virtual void pause() = 0;
@@ -226,6 +358,43 @@ namespace Screen_Capture {
         virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> onFrameChanged(const CAPTURECALLBACK &cb) = 0;
         // When a mouse image changes or the mouse changes position, the callback is invoked.
         virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> onMouseChanged(const MouseCallback &cb) = 0;
+        // When a block of the last frame moved (scrolling, dragging), the callback is invoked with the move before the remaining changes are
+        // sent to onFrameChanged. Apply the move to your copy of the last frame, then the onFrameChanged rects. Requires onFrameChanged.
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>>
+        onFrameMoved(const typename CaptureCallbackTraits<CAPTURECALLBACK>::MoveCallback &cb) = 0;
+        // Frames are downscaled by divisor (1, 2, 4 or 8) in the capture thread before they are handed to onNewFrame, onFrameChanged and
+        // onFrameMoved, so all images and rects are in the scaled coordinates. 1, the default, delivers full resolution frames.
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> setOutputScale(int divisor, ScaleFilter filter) = 0;
+        // Every frame is also delivered downscaled by divisor (2, 4 or 8) to this callback, independent of setOutputScale. Use it for
+        // previews next to a full resolution onNewFrame/onFrameChanged.
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> onNewThumbnail(const CAPTURECALLBACK &cb, int divisor,
+                                                                                         ScaleFilter filter) = 0;
+        // Every frame is also published with its dirty rects to publisher. Can be called more than once to publish to several publishers
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> publishFrames(const std::shared_ptr<IFramePublisher> &publisher) = 0;
+        // Captures into count buffers in turn, so frames kept with RetainFrame stay valid while the next ones are captured. Frames are skipped
+        // while consumers hold every buffer. 1, the default, reuses the buffer right away. Only the X11 and xcb monitor and window capture rotate buffers
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> setFrameBufferCount(int count) = 0;
+        // Sources that flicker the low bits of pixels (VNC, dithering) would report changes forever. With a tolerance small differences are
+        // not reported, but they still add up: frames are compared against what onFrameChanged last reported and not the last frame
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> setDiffTolerance(const DiffTolerance &tolerance) = 0;
+        // Changed 256x256 tiles are narrowed down to the blocks of size x size pixels inside them that changed before onFrameChanged is called,
+        // so a keystroke is not sent as a whole tile. size is 8, 16, 32 (the default), 64, 128 or 256, which reports the tiles as they are
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> setDiffBlockSize(int size) = 0;
+        // Frame, the default, keeps a copy of the last frame of every source to find the difs. Hashes only keeps a 64 bit hash of every block
+        // (see setDiffBlockSize), 8 bytes instead of 4 KB per block at the default size, and hashes each new frame. Alpha is not compared,
+        // Image::Reference is not set on the difs and it can not be combined with onFrameMoved or setDiffTolerance
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> setDiffReference(DiffReference reference) = 0;
+        // Blends the cursor into the frames before the callbacks get them. The capture thread reads it right after the frame, so the two
+        // always match. The blocks the cursor left and entered go to onFrameChanged even if only the pointer moved. Only X11 and xcb monitor
+        // and window captures draw the cursor so far
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>> setCompositeCursor(bool composite) = 0;
+        // Changed blocks (see setDiffBlockSize) are looked up by their content in a cache of the capacity blocks of each source used last, so
+        // switching back to a tab or app does not send its pixels again. Before the onFrameChanged calls of a frame the callback gets its
+        // blocks in order: the hits, which are left out of onFrameChanged, and the others, which are not. To resolve hits keep the pixels by
+        // hash, count every block of the list as a use and drop the least recently used past capacity. Blocks cut off by the right or bottom
+        // edge are not cached. Requires onFrameChanged.
+        virtual std::shared_ptr<ICaptureConfiguration<CAPTURECALLBACK>>
+        onCachedTiles(const typename CaptureCallbackTraits<CAPTURECALLBACK>::TileCallback &cb, int capacity) = 0;
         // start capturing
         virtual std::shared_ptr<IScreenCaptureManager> start_capturing() = 0;
     };
@@ -238,5 +407,9 @@ namespace Screen_Capture {
     // be captured
     SC_LITE_EXTERN std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> CreateCaptureConfiguration(const WindowCallback &windowstocapture);
 
+    // the callback of regionstocapture represents the list of regions which should be captured. Overlapping regions are grabbed together, but each
+    // region gets its own difs
+    SC_LITE_EXTERN std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> CreateCaptureConfiguration(const RegionCallback &regionstocapture);
+
 } // namespace Screen_Capture
 } // namespace SL
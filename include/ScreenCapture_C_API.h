@@ -25,6 +25,7 @@ namespace SL::Screen_Capture
 {
 
 struct Image;
+struct ImageMove;
 struct Monitor;
 struct Window;
 struct MousePoint;
@@ -41,11 +42,13 @@ struct ICaptureConfigurationWindowCaptureCallbackWrapper;
 }
 
 typedef SL::Screen_Capture::Image* SCL_ImageRef;
+typedef SL::Screen_Capture::ImageMove* SCL_ImageMoveRef;
 typedef SL::Screen_Capture::Window* SCL_WindowRef;
 typedef SL::Screen_Capture::Monitor* SCL_MonitorRef;
 typedef SL::Screen_Capture::MousePoint* SCL_MousePointRef;
 
 typedef SL::Screen_Capture::Image const* SCL_ImageRefConst;
+typedef SL::Screen_Capture::ImageMove const* SCL_ImageMoveRefConst;
 typedef SL::Screen_Capture::Window const* SCL_WindowRefConst;
 typedef SL::Screen_Capture::Monitor const* SCL_MonitorRefConst;
 typedef SL::Screen_Capture::MousePoint const* SCL_MousePointRefConst;
@@ -57,11 +60,13 @@ typedef SL::Screen_Capture::C_API::ICaptureConfigurationWindowCaptureCallbackWra
 #else
 
 typedef void* SCL_ImageRef;
+typedef void* SCL_ImageMoveRef;
 typedef void* SCL_WindowRef;
 typedef void* SCL_MonitorRef;
 typedef void* SCL_MousePointRef;
 
 typedef void const* SCL_ImageRefConst;
+typedef void const* SCL_ImageMoveRefConst;
 typedef void const* SCL_WindowRefConst;
 typedef void const* SCL_MonitorRefConst;
 typedef void const* SCL_MousePointRefConst;
@@ -81,12 +86,72 @@ typedef int (*SCL_MouseCaptureCallbackWithContext)(SCL_ImageRefConst img, SCL_Mo
 typedef int (*SCL_WindowCaptureCallback)(SCL_ImageRefConst img, SCL_WindowRefConst monitor);
 typedef int (*SCL_WindowCaptureCallbackWithContext)(SCL_ImageRefConst img, SCL_WindowRefConst monitor, void *context);
 
+typedef int (*SCL_ScreenMoveCallback)(SCL_ImageMoveRefConst move, SCL_MonitorRefConst monitor);
+typedef int (*SCL_ScreenMoveCallbackWithContext)(SCL_ImageMoveRefConst move, SCL_MonitorRefConst monitor, void *context);
+
+typedef int (*SCL_WindowMoveCallback)(SCL_ImageMoveRefConst move, SCL_WindowRefConst window);
+typedef int (*SCL_WindowMoveCallbackWithContext)(SCL_ImageMoveRefConst move, SCL_WindowRefConst window, void *context);
+
 typedef int (*SCL_WindowCallback)(SCL_WindowRef buffer, int buffersize);
 typedef int (*SCL_MonitorCallback)(SCL_MonitorRef buffer, int buffersize);
 
 typedef int (*SCL_WindowCallbackWithContext)(SCL_WindowRef buffer, int buffersize, void *context);
 typedef int (*SCL_MonitorCallbackWithContext)(SCL_MonitorRef buffer, int buffersize, void *context);
 
+// frames published to shared memory, see ScreenCapture_SharedFrames.h
+struct SCL_SharedFrameConsumer;
+typedef struct SCL_SharedFrameConsumer* SCL_SharedFrameConsumerRef;
+
+typedef struct SCL_SharedRect {
+    int left, top, right, bottom;
+} SCL_SharedRect;
+
+typedef struct SCL_SharedFrame {
+    unsigned long long Sequence;
+    // DirtyRects are relative to this frame of the same Source, if you did not see it use the whole frame
+    unsigned long long PreviousSequence;
+    long long Source; // the monitor id or window handle
+    const char* Name;
+    int Width;
+    int Height;
+    int RowStrideInBytes;
+    const unsigned char* Data; // BGRA, points straight into the shared memory
+    int DirtyRectCount;
+    const SCL_SharedRect* DirtyRects;
+    unsigned long long Lock; // used by SCL_IsSharedFrameValid
+} SCL_SharedFrame;
+
+// a frame held past the callback that delivered it, see SCL_AcquireFrame
+typedef struct SCL_Frame {
+    unsigned long long Sequence; // counts the frames of one monitor or window, starting at 1
+    long long Timestamp; // see SCL_ImageTimestamp
+    SCL_SharedRect Bounds;
+    int RowStrideInBytes;
+    const unsigned char* Data; // BGRA, points straight into the capture buffer
+    void* Handle; // used by SCL_ReleaseFrame
+} SCL_Frame;
+
+// see IScreenCaptureManager::getStatistics
+typedef struct SCL_CaptureStatistics {
+    unsigned long long Frames;
+    unsigned long long FramesWithAllocations;
+    unsigned long long TileLookups;
+    unsigned long long TileHits;
+} SCL_CaptureStatistics;
+
+// see ICaptureConfiguration::onCachedTiles
+typedef struct SCL_CachedTile {
+    SCL_SharedRect Rect;
+    unsigned long long Hash;
+    unsigned char Hit; // 1 if the block is not passed to the frame changed callback
+} SCL_CachedTile;
+
+typedef int (*SCL_ScreenTileCallback)(const SCL_CachedTile* tiles, int count, SCL_MonitorRefConst monitor);
+typedef int (*SCL_ScreenTileCallbackWithContext)(const SCL_CachedTile* tiles, int count, SCL_MonitorRefConst monitor, void *context);
+
+typedef int (*SCL_WindowTileCallback)(const SCL_CachedTile* tiles, int count, SCL_WindowRefConst window);
+typedef int (*SCL_WindowTileCallbackWithContext)(const SCL_CachedTile* tiles, int count, SCL_WindowRefConst window, void *context);
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -103,6 +168,10 @@ int SCL_GetMonitors(SCL_MonitorRef monitors, int monitors_size);
 SC_LITE_C_EXTERN
 int SCL_IsMonitorInsideBounds(SCL_MonitorRef monitors, int monitorsize, SCL_MonitorRef monitor);
 
+// in Hz, 0 if the platform does not tell
+SC_LITE_C_EXTERN
+float SCL_MonitorRefreshRate(SCL_MonitorRefConst monitor);
+
 SC_LITE_C_EXTERN
 void SCL_MonitorOnNewFrame(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenCaptureCallback cb);
 
@@ -121,6 +190,23 @@ void SCL_MonitorOnMouseChanged(SCL_ICaptureConfigurationScreenCaptureCallbackWra
 SC_LITE_C_EXTERN
 void SCL_MonitorOnMouseChangedWithContext(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_MouseCaptureCallbackWithContext cb);
 
+SC_LITE_C_EXTERN
+void SCL_MonitorOnFrameMoved(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenMoveCallback cb);
+
+SC_LITE_C_EXTERN
+void SCL_MonitorOnFrameMovedWithContext(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenMoveCallbackWithContext cb);
+
+// divisor is 1, 2, 4 or 8, filter is 0 for box and 1 for bilinear filtering
+SC_LITE_C_EXTERN
+void SCL_MonitorSetOutputScale(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int divisor, int filter);
+
+SC_LITE_C_EXTERN
+void SCL_MonitorOnNewThumbnail(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenCaptureCallback cb, int divisor, int filter);
+
+SC_LITE_C_EXTERN
+void SCL_MonitorOnNewThumbnailWithContext(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenCaptureCallbackWithContext cb,
+                                          int divisor, int filter);
+
 SC_LITE_C_EXTERN
 SCL_IScreenCaptureManagerWrapperRef SCL_MonitorStartCapturing(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr);
 
@@ -133,6 +219,11 @@ void SCL_SetFrameChangeInterval(SCL_IScreenCaptureManagerWrapperRef ptr, int mil
 SC_LITE_C_EXTERN
 void SCL_SetMouseChangeInterval(SCL_IScreenCaptureManagerWrapperRef ptr, int milliseconds);
 
+// captures monitors on every divisor-th refresh instead of the frame change interval, 0 turns it off. See
+// IScreenCaptureManager::setFrameRefreshDivisor
+SC_LITE_C_EXTERN
+void SCL_SetFrameRefreshDivisor(SCL_IScreenCaptureManagerWrapperRef ptr, int divisor);
+
 SC_LITE_C_EXTERN
 void SCL_PauseCapturing(SCL_IScreenCaptureManagerWrapperRef ptr);
 
@@ -142,6 +233,27 @@ int SCL_IsPaused(SCL_IScreenCaptureManagerWrapperRef ptr);
 SC_LITE_C_EXTERN
 void SCL_Resume(SCL_IScreenCaptureManagerWrapperRef ptr);
 
+SC_LITE_C_EXTERN
+void SCL_GetCaptureStatistics(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_CaptureStatistics* statistics);
+
+// Changes inside the count rects are not looked for, relative to the top left of the frames of monitor or window. Replaces the rects
+// set before, a count of 0 removes them. Can be called while capturing
+SC_LITE_C_EXTERN
+void SCL_MonitorSetIgnoreRects(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_MonitorRefConst monitor, const SCL_SharedRect* rects, int count);
+
+SC_LITE_C_EXTERN
+void SCL_WindowSetIgnoreRects(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_WindowRefConst window, const SCL_SharedRect* rects, int count);
+
+// The rects of monitor or window that changed after frame sequence, see IScreenCaptureManager::getChangesSince. Like SCL_GetMonitors rects
+// is filled up to rects_size and the number of rects there are is returned, -1 if they are not known and the whole frame is needed
+SC_LITE_C_EXTERN
+int SCL_MonitorGetChangesSince(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_MonitorRefConst monitor, unsigned long long sequence,
+                               SCL_SharedRect* rects, int rects_size);
+
+SC_LITE_C_EXTERN
+int SCL_WindowGetChangesSince(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_WindowRefConst window, unsigned long long sequence,
+                              SCL_SharedRect* rects, int rects_size);
+
 SC_LITE_C_EXTERN
 void SCL_WindowOnNewFrame(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowCaptureCallback cb);
 
@@ -160,9 +272,107 @@ void SCL_WindowOnMouseChanged(SCL_ICaptureConfigurationWindowCaptureCallbackWrap
 SC_LITE_C_EXTERN
 void SCL_WindowOnMouseChangedWithContext(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_MouseCaptureCallbackWithContext cb);
 
+SC_LITE_C_EXTERN
+void SCL_WindowOnFrameMoved(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowMoveCallback cb);
+
+SC_LITE_C_EXTERN
+void SCL_WindowOnFrameMovedWithContext(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowMoveCallbackWithContext cb);
+
+// divisor is 1, 2, 4 or 8, filter is 0 for box and 1 for bilinear filtering
+SC_LITE_C_EXTERN
+void SCL_WindowSetOutputScale(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int divisor, int filter);
+
+SC_LITE_C_EXTERN
+void SCL_WindowOnNewThumbnail(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowCaptureCallback cb, int divisor, int filter);
+
+SC_LITE_C_EXTERN
+void SCL_WindowOnNewThumbnailWithContext(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowCaptureCallbackWithContext cb,
+                                         int divisor, int filter);
+
 SC_LITE_C_EXTERN
 SCL_IScreenCaptureManagerWrapperRef SCL_WindowStartCapturing(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr);
 
+// the number of buffers frames are captured into, frames can only be acquired if it is above 1. Captures skip frames while every
+// buffer is acquired
+SC_LITE_C_EXTERN
+void SCL_MonitorSetFrameBufferCount(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int count);
+
+SC_LITE_C_EXTERN
+void SCL_WindowSetFrameBufferCount(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int count);
+
+// Small differences are not reported, see ICaptureConfiguration::setDiffTolerance. A pixel changed if one of its channels differs by more
+// than the threshold of that channel (0 - 255), alpha is not compared if ignorealpha is 1. A tile is reported once minchangedpixels of its
+// pixels changed
+SC_LITE_C_EXTERN
+void SCL_MonitorSetDiffTolerance(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int b, int g, int r, int a, int ignorealpha,
+                                 int minchangedpixels);
+
+SC_LITE_C_EXTERN
+void SCL_WindowSetDiffTolerance(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int b, int g, int r, int a, int ignorealpha,
+                                int minchangedpixels);
+
+// Changed tiles are narrowed down to blocks of size x size pixels (8 - 256, a power of two) before they are reported, the default is 32
+SC_LITE_C_EXTERN
+void SCL_MonitorSetDiffBlockSize(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int size);
+
+SC_LITE_C_EXTERN
+void SCL_WindowSetDiffBlockSize(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int size);
+
+// 0 keeps a copy of the last frame for the difs, 1 only a hash of every block. See ICaptureConfiguration::setDiffReference
+SC_LITE_C_EXTERN
+void SCL_MonitorSetDiffReference(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int reference);
+
+SC_LITE_C_EXTERN
+void SCL_WindowSetDiffReference(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int reference);
+
+// non zero blends the cursor into the frames. See ICaptureConfiguration::setCompositeCursor
+SC_LITE_C_EXTERN
+void SCL_MonitorSetCompositeCursor(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int composite);
+
+SC_LITE_C_EXTERN
+void SCL_WindowSetCompositeCursor(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int composite);
+
+// Changed blocks are looked up in a cache of the capacity blocks used last, the hits are reported to cb instead of the frame changed
+// callback. See ICaptureConfiguration::onCachedTiles for how to resolve them
+SC_LITE_C_EXTERN
+void SCL_MonitorOnCachedTiles(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenTileCallback cb, int capacity);
+
+SC_LITE_C_EXTERN
+void SCL_MonitorOnCachedTilesWithContext(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenTileCallbackWithContext cb,
+                                         int capacity);
+
+SC_LITE_C_EXTERN
+void SCL_WindowOnCachedTiles(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowTileCallback cb, int capacity);
+
+SC_LITE_C_EXTERN
+void SCL_WindowOnCachedTilesWithContext(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowTileCallbackWithContext cb,
+                                        int capacity);
+
+// Call from inside a frame callback to keep image without copying it. Returns 0 if the platform can not hand out its buffer, the frame
+// was scaled or only one buffer is used, copy it with SCL_Utility_CopyToContiguous then
+SC_LITE_C_EXTERN
+int SCL_AcquireFrame(SCL_ImageRefConst image, SCL_Frame* frame);
+
+// the number of the frame image belongs to, what SCL_MonitorGetChangesSince and SCL_WindowGetChangesSince count from
+SC_LITE_C_EXTERN
+unsigned long long SCL_ImageSequence(SCL_ImageRefConst image);
+
+// when the frame of image was grabbed, in nanoseconds of SCL_MonotonicTime
+SC_LITE_C_EXTERN
+long long SCL_ImageTimestamp(SCL_ImageRefConst image);
+
+// the frame change interval image was grabbed in, in nanoseconds
+SC_LITE_C_EXTERN
+long long SCL_ImageInterval(SCL_ImageRefConst image);
+
+// nanoseconds of the clock image timestamps are taken from, CLOCK_MONOTONIC on linux
+SC_LITE_C_EXTERN
+long long SCL_MonotonicTime();
+
+// Gives the buffer of an acquired frame back to the capture. Can be called from any thread, also after the capture stopped
+SC_LITE_C_EXTERN
+void SCL_ReleaseFrame(SCL_Frame* frame);
+
 SC_LITE_C_EXTERN
 unsigned char* SCL_Utility_CopyToContiguous(unsigned char* destination, SCL_ImageRefConst image);
 
@@ -207,6 +417,36 @@ SC_LITE_C_EXTERN
 void SCL_FreeWindowCaptureConfiguration(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr);
 
 
+// Publishes every captured frame to shared memory, consumers connect with SCL_OpenSharedFrames(socketpath). Frames larger than
+// maxwidth x maxheight are not published. Returns 0 if publishing is not supported on this platform or could not be set up
+SC_LITE_C_EXTERN
+int SCL_MonitorPublishFrames(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, const char* socketpath, int maxwidth, int maxheight,
+                             int slots);
+
+SC_LITE_C_EXTERN
+int SCL_WindowPublishFrames(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, const char* socketpath, int maxwidth, int maxheight,
+                            int slots);
+
+// The consumer side of the shared frames. SCL_OpenSharedFrames returns null if nothing publishes at socketpath
+SC_LITE_C_EXTERN
+SCL_SharedFrameConsumerRef SCL_OpenSharedFrames(const char* socketpath);
+
+SC_LITE_C_EXTERN
+void SCL_CloseSharedFrames(SCL_SharedFrameConsumerRef consumer);
+
+// Blocks until a frame newer than lastsequence is published or timeoutms passed (-1 waits forever). Returns 1 if there is a newer frame
+SC_LITE_C_EXTERN
+int SCL_WaitForSharedFrame(SCL_SharedFrameConsumerRef consumer, unsigned long long lastsequence, int timeoutms);
+
+// Fills frame with the newest frame without copying any pixels, returns 0 if nothing was published yet
+SC_LITE_C_EXTERN
+int SCL_AcquireSharedFrame(SCL_SharedFrameConsumerRef consumer, SCL_SharedFrame* frame);
+
+// The slot of a frame is reused once the publisher went around the ring. Call this after reading a frame, if it returns 0 the data
+// was overwritten while it was read and has to be dropped
+SC_LITE_C_EXTERN
+int SCL_IsSharedFrameValid(SCL_SharedFrameConsumerRef consumer, const SCL_SharedFrame* frame);
+
 SC_LITE_C_EXTERN int SCL_IsScreenCaptureEnabled();
 SC_LITE_C_EXTERN void SCL_RequestScreenCapture();
 
@@ -0,0 +1,41 @@
+#pragma once
+#include "ScreenCapture.h"
+
+#include <cstddef>
+
+// Optional helpers that convert the BGRA frames handed out by the library into the formats GPUs and video encoders usually want.
+// All functions read straight from the Image, so sub rects and padded rows are handled without an extra copy.
+namespace SL {
+namespace Screen_Capture {
+
+    // the YUV matrix of the color space the consumer expects. BT601 is what most SD content and jpeg use, BT709 is the HD standard
+    enum class ColorMatrix { BT601, BT709 };
+    // Limited (16-235 luma, 16-240 chroma) is what video encoders expect by default. Full uses the whole 0-255 range
+    enum class ColorRange { Limited, Full };
+
+    // 4 bytes per pixel R,G,B,A, alpha is always set to 255 because the captured alpha channel is undefined on most platforms.
+    // dst must hold at least Width(img) * Height(img) * 4 bytes
+    SC_LITE_EXTERN void ExtractAndConvertToRGBA(const Image &img, unsigned char *dst, size_t dst_size);
+    // 3 bytes per pixel R,G,B. dst must hold at least Width(img) * Height(img) * 3 bytes
+    SC_LITE_EXTERN void ExtractAndConvertToRGB(const Image &img, unsigned char *dst, size_t dst_size);
+    // 1 byte per pixel, full range luma. dst must hold at least Width(img) * Height(img) bytes
+    SC_LITE_EXTERN void ExtractAndConvertToGray(const Image &img, unsigned char *dst, size_t dst_size, ColorMatrix matrix = ColorMatrix::BT601);
+
+    // 4:2:0 formats, the chroma planes are (Width(img) + 1) / 2 by (Height(img) + 1) / 2 samples. The strides are in bytes, which lets
+    // the output go straight into the (usually padded) surfaces of an encoder
+    // NV12 is a luma plane followed by a plane of interleaved U,V samples
+    SC_LITE_EXTERN void ExtractAndConvertToNV12(const Image &img, unsigned char *y, int ystride, unsigned char *uv, int uvstride,
+                                                ColorMatrix matrix = ColorMatrix::BT601, ColorRange range = ColorRange::Limited);
+    // I420 is a luma plane followed by separate U and V planes
+    SC_LITE_EXTERN void ExtractAndConvertToI420(const Image &img, unsigned char *y, int ystride, unsigned char *u, int ustride, unsigned char *v,
+                                                int vstride, ColorMatrix matrix = ColorMatrix::BT601, ColorRange range = ColorRange::Limited);
+
+    // the size of rect after it is downscaled by divisor, never smaller than 1x1. The result always starts at 0,0
+    SC_LITE_EXTERN ImageRect DownscaledRect(const ImageRect &rect, int divisor);
+    // Downscales img by divisor (1, 2, 4 or 8) into dst as BGRA, the same layout Extract uses.
+    // dst must hold at least Width(DownscaledRect(Rect(img), divisor)) * Height(DownscaledRect(Rect(img), divisor)) * 4 bytes
+    SC_LITE_EXTERN void ExtractAndDownscale(const Image &img, unsigned char *dst, size_t dst_size, int divisor,
+                                            ScaleFilter filter = ScaleFilter::Box);
+
+} // namespace Screen_Capture
+} // namespace SL
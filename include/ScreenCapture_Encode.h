@@ -0,0 +1,25 @@
+#pragma once
+#include "ScreenCapture.h"
+
+#include <cstddef>
+
+// Optional lossless codec tuned for screen content: flat areas become runs, repeated colors hit a small color cache and, when the previous
+// frame is available, unchanged pixels cost next to nothing. The difs handed to onFrameChanged carry the previous frame in Reference(img).
+// Alpha is not stored, decoded pixels always have alpha set to 255.
+namespace SL {
+namespace Screen_Capture {
+
+    // the largest number of bytes LosslessEncode can produce for a width x height image
+    SC_LITE_EXTERN size_t LosslessEncodeBound(int width, int height);
+    // Encodes img into dst and returns the number of bytes written, or 0 if dst is too small.
+    // reference, when not null, must be the same size as img and the decoder must be given the same pixels
+    SC_LITE_EXTERN size_t LosslessEncode(const Image &img, const Image *reference, unsigned char *dst, size_t dst_size);
+    // reads the size of the image stored in an encoded buffer, returns false if src is not an encoded buffer
+    SC_LITE_EXTERN bool LosslessDecodeSize(const unsigned char *src, size_t src_size, int &width, int &height);
+    // Decodes src into dst as BGRA with dstrowstride bytes between rows, returns false if src is corrupt.
+    // reference has to be given when the encoder had one. It may point at dst itself, which updates an existing frame in place
+    SC_LITE_EXTERN bool LosslessDecode(const unsigned char *src, size_t src_size, unsigned char *dst, int dstrowstride,
+                                       const unsigned char *reference = nullptr, int referencerowstride = 0);
+
+} // namespace Screen_Capture
+} // namespace SL
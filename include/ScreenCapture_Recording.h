@@ -0,0 +1,48 @@
+#pragma once
+#include "ScreenCapture.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Records captured frames to a file and plays them back. The file holds a keyframe per source now and then and otherwise only the rects
+// that changed, losslessly coded against the previous frame (see ScreenCapture_Encode.h), so the size grows with the activity on screen and
+// not with the time recorded. Ticks without changes are not written at all.
+namespace SL {
+namespace Screen_Capture {
+
+    // Writes every published frame to path, attach it with publishFrames. A keyframe is written for a source when the first change after
+    // keyframeinterval arrives and whenever its size changes. The timestamps of a source are strictly increasing. The seek index is written
+    // when the recorder is destroyed, files of a crashed recorder can still be read. Returns null if the file could not be created
+    SC_LITE_EXTERN std::shared_ptr<IFramePublisher> CreateFrameRecorder(const std::string &path,
+                                                                        std::chrono::seconds keyframeinterval = std::chrono::seconds(10));
+
+    class SC_LITE_EXTERN IRecordingReader {
+      public:
+        virtual ~IRecordingReader() {}
+        // the monitor ids or window handles of the recorded sources
+        virtual std::vector<long long> sources() const = 0;
+        // the time of the last frame, relative to the start of the recording
+        virtual std::chrono::microseconds duration() const = 0;
+        // Rebuilds the frame of source as it was at timestamp from the keyframe before it and the changes since. Reading forward only applies
+        // the changes since the last call. img stays valid until the next call, returns false if source has no frame at timestamp
+        virtual bool frameAt(long long source, std::chrono::microseconds timestamp, Image &img) = 0;
+        // the time of the first frame of source after the one at after, pass -1 for the first frame. Returns false at the end of the recording
+        virtual bool nextFrame(long long source, std::chrono::microseconds after, std::chrono::microseconds &timestamp) = 0;
+    };
+
+    // maps the recording at path, returns null if it is not a recording
+    SC_LITE_EXTERN std::shared_ptr<IRecordingReader> OpenRecording(const std::string &path);
+
+    // one monitor per source of the recording at path, with the size of its first frame and the source as the Id
+    SC_LITE_EXTERN std::vector<Monitor> GetRecordedMonitors(const std::string &path);
+    // Plays the recording at path through the capture pipeline as if its sources were live monitors, so frame callbacks, difs, moves, scaling
+    // and publishers all see what they would have seen during the recording. No screen or display server is needed.
+    // speed 1 plays at the original pace, 2 twice as fast and 0 as fast as the callbacks take the frames. The frame interval of the
+    // manager is not used and nothing is reported for the mouse. Each source stops at the end of the recording
+    SC_LITE_EXTERN std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> CreateReplayConfiguration(const std::string &path,
+                                                                                                           double speed = 1.0);
+
+} // namespace Screen_Capture
+} // namespace SL
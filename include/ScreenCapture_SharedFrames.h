@@ -0,0 +1,20 @@
+#pragma once
+#include "ScreenCapture.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Publishes captured frames to other processes on the same machine. Frames and their dirty rects are written into a ring of slots in a
+// shared memory segment which consumers map read only, so any number of them can read frames without copies or per frame syscalls.
+// Consumers connect with SCL_OpenSharedFrames from the C API. Only Linux is supported right now.
+namespace SL {
+namespace Screen_Capture {
+
+    // Consumers connect through a unix socket at socketpath to get the shared memory. Every published frame is copied into the next slot,
+    // each holds a frame of up to maxwidth x maxheight, larger frames are dropped. Consumers have slots - 1 frame intervals to read a frame
+    // before it is overwritten. Returns null if publishing is not supported.
+    SC_LITE_EXTERN std::shared_ptr<IFramePublisher> CreateFramePublisher(const std::string &socketpath, int maxwidth, int maxheight, int slots = 4);
+
+} // namespace Screen_Capture
+} // namespace SL
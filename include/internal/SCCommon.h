@@ -1,19 +1,83 @@
 #pragma once
 #include "ScreenCapture.h"
+#include "ScreenCapture_Convert.h"
+#include <algorithm>
 #include <assert.h>
 #include <atomic>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 // this is INTERNAL DO NOT USE!
 namespace SL {
 namespace Screen_Capture {
+    // by SourceId, the rects of a source GetDifs does not look at
+    typedef std::unordered_map<long long, std::vector<ImageRect>> IgnoreRectMap;
+
+    // when the blocks of the frames of a source last changed, by frame number. Written by the capture thread of the source and read by
+    // IScreenCaptureManager::getChangesSince
+    struct ChangeHistory {
+        // the number of the last frame of the source, carries on when its capture thread is restarted
+        std::atomic<unsigned long long> Frames{0};
+        std::mutex Mutex;
+        int Width = 0;
+        int Height = 0;
+        int BlockSize = 0;
+        // by block, row by row, the frame it last changed in. Empty until a frame was diffed
+        std::vector<unsigned long long> Versions;
+    };
+    // the ChangeHistory of every source by SourceId. The capture threads only get the CaptureData as const
+    class ChangeHistoryMap {
+        mutable std::mutex Mutex;
+        mutable std::unordered_map<long long, std::shared_ptr<ChangeHistory>> Histories;
+
+      public:
+        // creates it the first time
+        std::shared_ptr<ChangeHistory> get(long long source) const;
+        // empty if source was not captured yet
+        std::shared_ptr<ChangeHistory> find(long long source) const;
+    };
+
+    // what IScreenCaptureManager::getStatistics adds up. Counted by the capture threads, which only get the CaptureData as const
+    struct CaptureStatisticsData {
+        mutable std::atomic<unsigned long long> Frames{0};
+        mutable std::atomic<unsigned long long> FramesWithAllocations{0};
+        mutable std::atomic<unsigned long long> TileLookups{0};
+        mutable std::atomic<unsigned long long> TileHits{0};
+    };
+
     template <typename F, typename M, typename W> struct CaptureData {
 #if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
         std::atomic<std::shared_ptr<Timer> > FrameTimer;
 #else
         std::shared_ptr<Timer> FrameTimer;
 #endif
+        // above 0 monitors are captured on every RefreshDivisor-th refresh instead of by FrameTimer
+        std::atomic<int> RefreshDivisor{0};
         F OnNewFrame;
         F OnFrameChanged;
+        typename CaptureCallbackTraits<F>::MoveCallback OnFrameMoved;
+        typename CaptureCallbackTraits<F>::TileCallback OnCachedTiles;
+        int TileCacheCapacity = 0;
+        F OnNewThumbnail;
+        int OutputScale = 1;
+        ScaleFilter OutputFilter = ScaleFilter::Box;
+        int ThumbnailScale = 1;
+        ScaleFilter ThumbnailFilter = ScaleFilter::Box;
+        std::vector<std::shared_ptr<IFramePublisher>> Publishers;
+        int FrameBufferCount = 1;
+        DiffTolerance Tolerance;
+        int DiffBlockSize = 32;
+        DiffReference Reference = DiffReference::Frame;
+        bool CompositeCursor = false;
+        CaptureStatisticsData Statistics;
+        ChangeHistoryMap Histories;
+        // replaced as a whole by IScreenCaptureManager::setIgnoreRects while capturing
+#if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
+        std::atomic<std::shared_ptr<const IgnoreRectMap> > IgnoreRects;
+#else
+        std::shared_ptr<const IgnoreRectMap> IgnoreRects;
+#endif
 #if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
         std::atomic<std::shared_ptr<Timer> > MouseTimer;
 #else
@@ -33,11 +97,130 @@ namespace Screen_Capture {
         std::atomic<bool> Paused;
     };
 
+    struct ReplayData {
+        // when set the monitors are played from this recording instead of being captured
+        std::string Path;
+        double Speed = 1.0;
+    };
+
     struct Thread_Data {
 
         CaptureData<ScreenCaptureCallback, MouseCallback, MonitorCallback> ScreenCaptureData;
         CaptureData<WindowCaptureCallback, MouseCallback, WindowCallback> WindowCaptureData;
+        CaptureData<RegionCaptureCallback, MouseCallback, RegionCallback> RegionCaptureData;
         CommonData CommonData_;
+        ReplayData Replay;
+    };
+
+    // memory a platform captures into. Holds counts the RetainFrame results that still point into it, the platform only captures into a
+    // buffer again once it is 0. Platforms free their resources in the destructor, which runs after the last hold is released
+    struct FrameBuffer : public std::enable_shared_from_this<FrameBuffer> {
+        std::atomic<int> Holds{0};
+        // the number of the frame last captured into it
+        unsigned long long Sequence = 0;
+        virtual ~FrameBuffer() {}
+        bool isHeld() const { return Holds.load(std::memory_order_acquire) != 0; }
+    };
+
+    // the rows of a band share the same spans, the parts of a row outside of the ignore rects. They are DiffScratch::Spans[FirstSpan, EndSpan)
+    struct RowBand {
+        int Bottom;
+        size_t FirstSpan;
+        size_t EndSpan;
+    };
+
+    // memory the diffing of a frame needs, kept from frame to frame so capturing at a steady size does not allocate. Only grows, when
+    // the frame size, the ignore rects or the number of changes do
+    struct DiffScratch {
+        // GetDifs
+        std::vector<uint64_t> Tiles;
+        std::vector<uint64_t> Blocks;
+        std::vector<int> ChangedPixels;
+        std::vector<int> FirstChangedRow;
+        std::vector<int> Edges;
+        std::vector<std::pair<int, int>> Covered;
+        std::vector<RowBand> Bands;
+        std::vector<std::pair<int, int>> Spans;
+        std::vector<ImageRect> Merged;
+        // DetectMove
+        std::vector<uint64_t> OldHashes;
+        std::vector<uint64_t> NewHashes;
+        std::vector<std::pair<uint64_t, int>> SortedHashes;
+        std::vector<int> Votes;
+        // LookupTiles
+        std::vector<CachedTile> CachedTiles;
+        std::vector<ImageRect> Uncached;
+        // GetHashDifs
+        std::vector<uint64_t> HashLanes;
+        std::vector<ImageRect> BandIgnore;
+        std::vector<unsigned char> MaskedRow;
+        // AddDirtyBlocks
+        std::vector<unsigned char> DirtyBlocks;
+        // DeliverFrame
+        std::vector<ImageRect> CursorRects;
+        std::vector<ImageRect> IgnoreRects;
+        std::vector<ImageRect> Difs;
+        std::vector<ImageRect> Published;
+
+        // changes whenever one of the vectors allocated
+        size_t capacity() const
+        {
+            return Tiles.capacity() + Blocks.capacity() + ChangedPixels.capacity() + FirstChangedRow.capacity() + Edges.capacity() +
+                   Covered.capacity() + Bands.capacity() + Spans.capacity() + Merged.capacity() + OldHashes.capacity() + NewHashes.capacity() +
+                   SortedHashes.capacity() + Votes.capacity() + CachedTiles.capacity() + Uncached.capacity() + HashLanes.capacity() +
+                   BandIgnore.capacity() + MaskedRow.capacity() + DirtyBlocks.capacity() + CursorRects.capacity() + IgnoreRects.capacity() +
+                   Difs.capacity() + Published.capacity();
+        }
+    };
+
+    // the cursor as the platform last read it, drawn into the frames with ICaptureConfiguration::setCompositeCursor
+    struct CursorSprite {
+        // premultiplied, Width * Height of them
+        std::vector<ImageBGRA> Pixels;
+        int Width = 0;
+        int Height = 0;
+        Point HotSpot = {0, 0};
+        // the platform's number of the image, it is only taken over again when that changes
+        unsigned long Serial = 0;
+        bool NewImage = false;
+        bool Visible = false;
+        // of the hot spot, relative to the top left of the frame
+        Point Position = {0, 0};
+        // where it was drawn into this frame and the last one, and what it covers now
+        ImageRect Drawn;
+        ImageRect LastDrawn;
+        std::vector<ImageBGRA> Under;
+        // it looks different or is somewhere else than in the last frame
+        bool Changed = false;
+    };
+
+    // the hashes of the blocks of a source used last, see ICaptureConfiguration::onCachedTiles. Allocates when the capacity is set only
+    class TileCache {
+        struct Entry {
+            uint64_t Hash;
+            // the frame that added it
+            unsigned long long Added;
+            uint32_t Older;
+            uint32_t Newer;
+        };
+        std::vector<Entry> Entries;
+        // open addressing by hash, the index of the entry + 1 or 0 if empty
+        std::vector<uint32_t> Slots;
+        uint32_t Newest = 0;
+        uint32_t Oldest = 0;
+        size_t Capacity = 0;
+
+        size_t find(uint64_t hash) const;
+        void erase(size_t slot);
+        void unlink(uint32_t entry);
+        void pushNewest(uint32_t entry);
+
+      public:
+        // forgets every block if capacity changed
+        void setCapacity(size_t capacity);
+        size_t capacity() const { return Capacity; }
+        // true if hash was added before frame sequence. Either way it is the block used last afterwards
+        bool use(uint64_t hash, unsigned long long sequence);
     };
 
     class BaseFrameProcessor {
@@ -46,6 +229,25 @@ namespace Screen_Capture {
         std::unique_ptr<unsigned char[]> ImageBuffer;
         int ImageBufferSize = 0;
         bool FirstRun = true;
+        // downscaled copies of the current frame, only used when an output scale or thumbnails are requested
+        std::vector<unsigned char> ScaledImageBuffer;
+        std::vector<unsigned char> ThumbnailBuffer;
+        // the buffer the current frame was captured into, if the platform rotates buffers
+        FrameBuffer *CurrentBuffer = nullptr;
+        // frames captured so far, the first one is 1
+        unsigned long long FrameCount = 0;
+        // of the source captured, set by the first frame
+        std::shared_ptr<ChangeHistory> History;
+        DiffScratch Scratch;
+        TileCache Tiles;
+        // by block, row by row, the hashes of the last frame. Used instead of ImageBuffer with DiffReference::Hashes
+        std::vector<uint64_t> BlockHashes;
+        // MonotonicTime() right after the platform grabbed the current frame, ProcessCapture takes the time itself if it is 0
+        long long CaptureTime = 0;
+        // the frame change interval of the current frame, in nanoseconds
+        long long FrameInterval = 0;
+        // set by platforms that read the cursor, see CaptureData::CompositeCursor
+        CursorSprite Cursor;
     };
 
     class BaseMouseProcessor : public BaseFrameProcessor {
@@ -60,58 +262,377 @@ namespace Screen_Capture {
     Monitor CreateMonitor(int index, int id, int h, int w, int ox, int oy, const std::string &n, float scale);
     Monitor CreateMonitor(int index, int id, int adapter, int h, int w, int ox, int oy, const std::string &n, float scale);
     SC_LITE_EXTERN Image CreateImage(const ImageRect &imgrect, int rowStrideInBytes, const ImageBGRA *data);
+    // GetMonitors into monitors, which keeps its memory. Used by WatchMonitors to check the monitors while capturing
+    void GetMonitors(std::vector<Monitor> &monitors);
+
+    // regions whose rects overlap, they are grabbed once as Bounds and each region is cut out of that
+    struct RegionCluster {
+        ImageRect Bounds;
+        std::vector<size_t> Regions;
+    };
+    SC_LITE_EXTERN std::vector<RegionCluster> ClusterRegions(const std::vector<Region> &regions);
+    // whether region is a non empty rect inside the area covered by monitors
+    SC_LITE_EXTERN bool isRegionInsideBounds(const std::vector<Monitor> &monitors, const Region &region);
+
+    // whether tolerance reports every change, which is compared with memcmp
+    inline bool isExact(const DiffTolerance &tolerance)
+    {
+        return !tolerance.B && !tolerance.G && !tolerance.R && !tolerance.A && !tolerance.IgnoreAlpha && tolerance.MinChangedPixels <= 1;
+    }
+    // the copy of the last frame in ImageBuffer is only needed for difs that are not found by hashes
+    template <class F> bool KeepsLastFrame(const F &data) { return data.OnFrameChanged && data.Reference == DiffReference::Frame; }
+    // the blocks that differ between the images, pixels inside the ignore rects (relative to the top left of the images) are not compared.
+    // The image is compared in 256x256 tiles, the changed ones are narrowed down to blocks of blocksize (8 - 256, dividing 256)
+    SC_LITE_EXTERN std::vector<ImageRect> GetDifs(const Image &oldimg, const Image &newimg, const std::vector<ImageRect> &ignore = {},
+                                                  const DiffTolerance &tolerance = DiffTolerance(), int blocksize = 256);
+    // GetDifs into rects, with the memory it needs taken from scratch
+    SC_LITE_EXTERN void GetDifs(const Image &oldimg, const Image &newimg, const std::vector<ImageRect> &ignore, const DiffTolerance &tolerance,
+                                int blocksize, DiffScratch &scratch, std::vector<ImageRect> &rects);
+    // joins neighbouring rects in rects (as produced by GetDifs) into larger ones, the second one builds the result in scratch first
+    SC_LITE_EXTERN void merge(std::vector<ImageRect> &rects);
+    SC_LITE_EXTERN void merge(std::vector<ImageRect> &rects, std::vector<ImageRect> &scratch);
+    // looks for a block that moved between the two images inside the changed area difs, returns false if there is none. Moves from or
+    // onto the ignore rects are not reported, the pixels there were never handed out
+    SC_LITE_EXTERN bool DetectMove(const Image &oldimg, const Image &newimg, const std::vector<ImageRect> &difs, ImageMove &move);
+    SC_LITE_EXTERN bool DetectMove(const Image &oldimg, const Image &newimg, const std::vector<ImageRect> &difs,
+                                   const std::vector<ImageRect> &ignore, ImageMove &move, DiffScratch &scratch);
+    // the blocks of size blocksize inside rects (on the blocksize grid of img) that are not cut off, through cache in order into
+    // scratch.CachedTiles. With hits the rects without the hits go to scratch.Uncached, without the blocks are only added. Returns the hits
+    SC_LITE_EXTERN size_t LookupTiles(TileCache &cache, const Image &img, const std::vector<ImageRect> &rects, int blocksize,
+                                      unsigned long long sequence, bool hits, DiffScratch &scratch);
+    // the hash of the pixels of block in img without alpha
+    SC_LITE_EXTERN uint64_t HashBlock(const Image &img, const ImageRect &block);
+    // GetDifs against the hashes of the blocks of the last frame, which are replaced by those of img. Pixels inside ignore hash as black
+    SC_LITE_EXTERN void GetHashDifs(const Image &img, const std::vector<ImageRect> &ignore, int blocksize, std::vector<uint64_t> &hashes,
+                                    DiffScratch &scratch, std::vector<ImageRect> &rects);
+    // takes over a cursor image of 0xAARRGGBB pixels with premultiplied alpha, what XFixes hands out
+    SC_LITE_EXTERN void SetCursorImage(CursorSprite &cursor, int width, int height, const uint32_t *argb);
+    SC_LITE_EXTERN void SetCursorImage(CursorSprite &cursor, int width, int height, const unsigned long *argb);
+    // blends cursor over the frame at startsrc, which is width x height, and keeps what it covered. Only keeps track of where it was if it
+    // is not Visible
+    SC_LITE_EXTERN void DrawCursor(unsigned char *startsrc, int srcrowstride, int width, int height, CursorSprite &cursor);
+    // puts back what DrawCursor covered, for platforms that hand out the same image again without reading it
+    SC_LITE_EXTERN void EraseCursor(unsigned char *startsrc, int srcrowstride, const CursorSprite &cursor);
+    // adds the blocks of size blocksize that dirty touches to rects (blocks of the frame bounds big, as produced by GetDifs)
+    SC_LITE_EXTERN void AddDirtyBlocks(std::vector<ImageRect> &rects, const std::vector<ImageRect> &dirty, const ImageRect &bounds, int blocksize,
+                                       DiffScratch &scratch);
+    // applies move to the image at img, used to turn the last frame into the starting point for the remaining difs
+    SC_LITE_EXTERN void ApplyMove(unsigned char *img, int rowstride, const ImageMove &move);
+    // marks the blocks of history that rects (relative to the top left of the frame) cover as changed in frame sequence. A frame of another
+    // size or block size starts the history over with every block changed
+    SC_LITE_EXTERN void RecordChanges(ChangeHistory &history, unsigned long long sequence, const ImageRect &frame, int blocksize,
+                                      const std::vector<ImageRect> &rects);
+    // the blocks of history that changed after frame sequence, joined into rects. false if nothing was recorded yet
+    SC_LITE_EXTERN bool ChangesSince(ChangeHistory &history, unsigned long long sequence, std::vector<ImageRect> &rects);
+    // downscales img into buffer, which only allocates the first time, and returns the contiguous result
+    SC_LITE_EXTERN Image Downscale(std::vector<unsigned char> &buffer, const Image &img, int divisor, ScaleFilter filter);
+
+    // identifies the frames of a monitor, window or region to shared frame consumers
+    inline long long SourceId(const Monitor &monitor) { return Id(monitor); }
+    // what frames of a source can be paced on, only monitors have a refresh rate
+    inline float SourceRefreshRate(const Monitor &monitor) { return RefreshRate(monitor); }
+    inline float SourceRefreshRate(const Window &) { return 0.0f; }
+    inline float SourceRefreshRate(const Region &) { return 0.0f; }
+    inline long long SourceId(const Window &window) { return static_cast<long long>(window.Handle); }
+    inline long long SourceId(const Region &region)
+    {
+        auto &r = Rect(region);
+        return static_cast<long long>(static_cast<uint16_t>(r.left)) << 48 | static_cast<long long>(static_cast<uint16_t>(r.top)) << 32 |
+               static_cast<long long>(static_cast<uint16_t>(r.right)) << 16 | static_cast<uint16_t>(r.bottom);
+    }
+
+    // the ignore rects of source in the coordinates of the frames handed out, which are downscaled by OutputScale, into ret
+    template <class F, class C> void GetIgnoreRects(const F &data, const C &source, std::vector<ImageRect> &ret)
+    {
+#if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
+        auto ignorerects = data.IgnoreRects.load();
+#else
+        auto ignorerects = std::atomic_load(&data.IgnoreRects);
+#endif
+        ret.clear();
+        if (!ignorerects) {
+            return;
+        }
+        auto found = ignorerects->find(SourceId(source));
+        if (found == ignorerects->end()) {
+            return;
+        }
+        ret.assign(found->second.begin(), found->second.end());
+        if (data.OutputScale > 1) {
+            // grown to whole scaled pixels, a pixel that is partly ignored is ignored
+            const auto scale = data.OutputScale;
+            for (auto &r : ret) {
+                r.left /= scale;
+                r.top /= scale;
+                r.right = (r.right + scale - 1) / scale;
+                r.bottom = (r.bottom + scale - 1) / scale;
+            }
+        }
+    }
+
+    // the frame img is part of, on every image handed out for the current frame
+    inline void Stamp(Image &img, const BaseFrameProcessor &base)
+    {
+        img.Sequence = base.FrameCount;
+        img.Timestamp = base.CaptureTime;
+        img.Interval = base.FrameInterval;
+    }
+    // the time between the refreshes source is captured on, 0 if it is not paced on them
+    template <class F, class C> std::chrono::nanoseconds RefreshPeriod(const F &data, const C &source)
+    {
+        const auto divisor = data.RefreshDivisor.load(std::memory_order_relaxed);
+        const auto rate = SourceRefreshRate(source);
+        if (divisor <= 0 || rate <= 0.0f) {
+            return std::chrono::nanoseconds(0);
+        }
+        return std::chrono::nanoseconds(static_cast<long long>(divisor * 1e9 / rate + 0.5));
+    }
+    // the interval frames of source are captured at in nanoseconds, 0 if none is set
+    template <class F, class C> long long GetFrameInterval(const F &data, const C &source)
+    {
+        const auto paced = RefreshPeriod(data, source);
+        if (paced.count()) {
+            return paced.count();
+        }
+#if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
+        auto timer = data.FrameTimer.load();
+#else
+        auto timer = std::atomic_load(&data.FrameTimer);
+#endif
+        return timer ? std::chrono::duration_cast<std::chrono::nanoseconds>(timer->duration()).count() : 0;
+    }
+    // Keeps frames on a grid of period from the first one. A Timer starts over after every frame, so its frames drift by however long
+    // the frame took and beat against the refresh rate
+    class RefreshPacer {
+        std::chrono::steady_clock::time_point Next;
+        std::chrono::nanoseconds Period{0};
+
+      public:
+        // false if period is 0 and the frames are not paced. A new period starts a new grid
+        bool start(std::chrono::nanoseconds period)
+        {
+            if (period != Period) {
+                Period = period;
+                Next = std::chrono::steady_clock::now();
+            }
+            return Period.count() != 0;
+        }
+        void wait()
+        {
+            Next += Period;
+            const auto now = std::chrono::steady_clock::now();
+            if (Next < now) {
+                // the refreshes that were missed are skipped, the frames stay on the grid
+                Next += ((now - Next) / Period + 1) * Period;
+            }
+            std::this_thread::sleep_until(Next);
+        }
+    };
 
-    SC_LITE_EXTERN std::vector<ImageRect> GetDifs(const Image &oldimg, const Image &newimg);
+    // hands the frame at startsrc, which is imageract big, to the frame callbacks and keeps the copy needed for the difs. owner is the
+    // buffer startsrc points into if callbacks may hold on to it
     template <class F, class C>
-    void ProcessCapture(const F &data, BaseFrameProcessor &base, const C &mointor, const unsigned char *startsrc, int srcrowstride)
+    void DeliverFrame(const F &data, BaseFrameProcessor &base, const C &mointor, const unsigned char *startsrc, int srcrowstride,
+                      const ImageRect &imageract, FrameBuffer *owner)
     {
-        ImageRect imageract;
-        imageract.left = 0;
-        imageract.top = 0;
-        imageract.bottom = Height(mointor);
-        imageract.right = Width(mointor);
         const auto sizeofimgbgra = static_cast<int>(sizeof(ImageBGRA));
         const auto startimgsrc = reinterpret_cast<const ImageBGRA *>(startsrc);
-        auto dstrowstride = sizeofimgbgra * Width(mointor);
+        auto dstrowstride = sizeofimgbgra * Width(imageract);
+        auto &scratch = base.Scratch;
+        // without difs every published frame is marked as changed everywhere
+        auto &published = scratch.Published;
+        published.assign(1, imageract);
         if (data.OnNewFrame) { // each frame we still let the caller know if asked for
             auto wholeimg = CreateImage(imageract, srcrowstride, startimgsrc);
             wholeimg.isContiguous = dstrowstride == srcrowstride;
+            wholeimg.Owner = owner;
+            Stamp(wholeimg, base);
             data.OnNewFrame(wholeimg, mointor);
         }
         if (data.OnFrameChanged) { // difs are needed, which means that we must hold the last known image in memory for comparisons...
+            // the last frame is overwritten with this one, or only with the changes that were reported
+            auto copyall = true;
+            auto &imgdifs = scratch.Difs;
+            // or only the hashes of its blocks
+            const auto hashed = data.Reference == DiffReference::Hashes;
             if (base.FirstRun) {
                 // first time through, just send the whole image
+                RecordChanges(*base.History, base.FrameCount, imageract, data.DiffBlockSize, published);
                 auto wholeimg = CreateImage(imageract, srcrowstride, startimgsrc);
+                if (hashed) {
+                    base.BlockHashes.clear();
+                    GetIgnoreRects(data, mointor, scratch.IgnoreRects);
+                    GetHashDifs(wholeimg, scratch.IgnoreRects, data.DiffBlockSize, base.BlockHashes, scratch, imgdifs);
+                }
+                if (data.OnCachedTiles) {
+                    // the whole frame is sent, its blocks only go into the cache
+                    LookupTiles(base.Tiles, wholeimg, published, data.DiffBlockSize, base.FrameCount, false, scratch);
+                    data.Statistics.TileLookups.fetch_add(scratch.CachedTiles.size(), std::memory_order_relaxed);
+                    if (!scratch.CachedTiles.empty()) {
+                        data.OnCachedTiles(scratch.CachedTiles, mointor);
+                    }
+                }
                 wholeimg.isContiguous = dstrowstride == srcrowstride;
+                wholeimg.Owner = owner;
+                Stamp(wholeimg, base);
                 data.OnFrameChanged(wholeimg, mointor);
                 base.FirstRun = false;
             }
             else {
                 // user wants difs, lets do it!
                 auto newimg = CreateImage(imageract, srcrowstride, startimgsrc);
-                auto oldimg = CreateImage(imageract, 0, reinterpret_cast<const ImageBGRA *>(base.ImageBuffer.get()));
-                auto imgdifs = GetDifs(oldimg, newimg);
+                GetIgnoreRects(data, mointor, scratch.IgnoreRects);
+                ImageMove move;
+                auto moved = false;
+                if (hashed) {
+                    // there is no last frame, only its hashes
+                    GetHashDifs(newimg, scratch.IgnoreRects, data.DiffBlockSize, base.BlockHashes, scratch, imgdifs);
+                }
+                else {
+                    auto oldimg = CreateImage(imageract, dstrowstride, reinterpret_cast<const ImageBGRA *>(base.ImageBuffer.get()));
+                    GetDifs(oldimg, newimg, scratch.IgnoreRects, data.Tolerance, data.DiffBlockSize, scratch, imgdifs);
+                    moved = data.OnFrameMoved && DetectMove(oldimg, newimg, imgdifs, scratch.IgnoreRects, move, scratch);
+                    if (moved) {
+                        data.OnFrameMoved(move, mointor);
+                        // the last frame is overwritten below anyway, move the block in place so only what is left over is reported
+                        ApplyMove(base.ImageBuffer.get(), dstrowstride, move);
+                        GetDifs(oldimg, newimg, scratch.IgnoreRects, data.Tolerance, data.DiffBlockSize, scratch, imgdifs);
+                    }
+                }
+                if (!scratch.CursorRects.empty()) {
+                    // the cursor is in both frames, but a tolerance or the ignore rects could hide that it moved
+                    AddDirtyBlocks(imgdifs, scratch.CursorRects, imageract, data.DiffBlockSize, scratch);
+                }
+                // what changed, the moved block included
+                published.assign(imgdifs.begin(), imgdifs.end());
+                if (moved) {
+                    published.emplace_back(move.Destination.x, move.Destination.y, move.Destination.x + Width(move.Source),
+                                           move.Destination.y + Height(move.Source));
+                }
+                // before the callbacks, which may ask for the changes up to this frame
+                RecordChanges(*base.History, base.FrameCount, imageract, data.DiffBlockSize, published);
+                // the last frame is still updated with all of imgdifs below
+                auto reported = &imgdifs;
+                if (data.OnCachedTiles) {
+                    const auto hits = LookupTiles(base.Tiles, newimg, imgdifs, data.DiffBlockSize, base.FrameCount, true, scratch);
+                    data.Statistics.TileLookups.fetch_add(scratch.CachedTiles.size(), std::memory_order_relaxed);
+                    data.Statistics.TileHits.fetch_add(hits, std::memory_order_relaxed);
+                    if (!scratch.CachedTiles.empty()) {
+                        data.OnCachedTiles(scratch.CachedTiles, mointor);
+                    }
+                    reported = &scratch.Uncached;
+                }
 
-                for (auto &r : imgdifs) {
+                for (auto &r : *reported) {
                     auto leftoffset = r.left * sizeofimgbgra;
                     auto thisstartsrc = startsrc + leftoffset + (r.top * srcrowstride);
 
                     auto difimg = CreateImage(r, srcrowstride, reinterpret_cast<const ImageBGRA *>(thisstartsrc));
                     difimg.isContiguous = false;
+                    difimg.Owner = owner;
+                    Stamp(difimg, base);
+                    // the last frame is only overwritten after the callbacks, any move was already applied to it
+                    Image referenceimg;
+                    if (!hashed) {
+                        referenceimg = CreateImage(r, dstrowstride,
+                                                   reinterpret_cast<const ImageBGRA *>(base.ImageBuffer.get() + leftoffset + r.top * dstrowstride));
+                        difimg.Reference = &referenceimg;
+                    }
                     data.OnFrameChanged(difimg, mointor);
                 }
+                // unreported changes stay out of the last frame, so they add up until they are big enough
+                copyall = isExact(data.Tolerance);
             }
-            auto startdst = base.ImageBuffer.get(); 
-            assert(base.ImageBufferSize >= dstrowstride * Height(mointor));
-            if (dstrowstride == srcrowstride) { // no need for multiple calls, there is no padding here 
-                memcpy(startdst, startsrc, dstrowstride * Height(mointor));
+            // the hashes are already up to date
+            if (!hashed) {
+                auto startdst = base.ImageBuffer.get();
+                assert(base.ImageBufferSize >= dstrowstride * Height(imageract));
+                const auto copy = [&](const ImageRect &r) {
+                    for (auto i = r.top; i < r.bottom; i++) {
+                        memcpy(startdst + (i * dstrowstride) + r.left * sizeofimgbgra, startsrc + (i * srcrowstride) + r.left * sizeofimgbgra,
+                               Width(r) * sizeofimgbgra);
+                    }
+                };
+                // no need for multiple calls if the whole frame is copied and there is no padding
+                if (copyall && dstrowstride == srcrowstride) {
+                    memcpy(startdst, startsrc, dstrowstride * Height(imageract));
+                }
+                else if (copyall) {
+                    copy(imageract);
+                }
+                else {
+                    for (auto &r : imgdifs) {
+                        copy(r);
+                    }
+                }
+            }
+        }
+        if (!data.Publishers.empty()) {
+            auto wholeimg = CreateImage(imageract, srcrowstride, startimgsrc);
+            Stamp(wholeimg, base);
+            for (auto &publisher : data.Publishers) {
+                publisher->publish(wholeimg, published.data(), published.size(), SourceId(mointor), Name(mointor));
             }
-            else { 
-                for (auto i = 0; i < Height(mointor); i++) {
-                    memcpy(startdst + (i * dstrowstride), startsrc + (i * srcrowstride), dstrowstride);
+        }
+    }
+
+    template <class F, class C>
+    void ProcessCapture(const F &data, BaseFrameProcessor &base, const C &mointor, const unsigned char *startsrc, int srcrowstride)
+    {
+        ImageRect imageract;
+        imageract.left = 0;
+        imageract.top = 0;
+        imageract.bottom = Height(mointor);
+        imageract.right = Width(mointor);
+        if (!base.History) {
+            base.History = data.Histories.get(SourceId(mointor));
+            base.FrameCount = base.History->Frames.load(std::memory_order_relaxed);
+        }
+        base.FrameCount++;
+        if (!base.CaptureTime) {
+            base.CaptureTime = MonotonicTime();
+        }
+        base.FrameInterval = GetFrameInterval(data, mointor);
+        // where the cursor was and is now, in the frames that are delivered
+        auto &cursorrects = base.Scratch.CursorRects;
+        cursorrects.clear();
+        if (data.CompositeCursor && base.Cursor.Changed) {
+            const auto scale = std::max(data.OutputScale, 1);
+            for (const auto &r : {base.Cursor.LastDrawn, base.Cursor.Drawn}) {
+                if (r.left < r.right && r.top < r.bottom) {
+                    cursorrects.emplace_back(r.left / scale, r.top / scale, (r.right + scale - 1) / scale, (r.bottom + scale - 1) / scale);
                 }
             }
         }
+        base.History->Frames.store(base.FrameCount, std::memory_order_relaxed);
+        if (base.CurrentBuffer) {
+            base.CurrentBuffer->Sequence = base.FrameCount;
+        }
+        data.Statistics.Frames.fetch_add(1, std::memory_order_relaxed);
+        const auto capacity =
+            base.Scratch.capacity() + base.ScaledImageBuffer.capacity() + base.ThumbnailBuffer.capacity() + base.Tiles.capacity();
+        base.Tiles.setCapacity(static_cast<size_t>(data.TileCacheCapacity));
+        if (data.OnNewThumbnail) {
+            auto wholeimg = CreateImage(imageract, srcrowstride, reinterpret_cast<const ImageBGRA *>(startsrc));
+            auto thumbnail = Downscale(base.ThumbnailBuffer, wholeimg, data.ThumbnailScale, data.ThumbnailFilter);
+            Stamp(thumbnail, base);
+            data.OnNewThumbnail(thumbnail, mointor);
+        }
+        if (data.OutputScale > 1) {
+            auto wholeimg = CreateImage(imageract, srcrowstride, reinterpret_cast<const ImageBGRA *>(startsrc));
+            auto scaled = Downscale(base.ScaledImageBuffer, wholeimg, data.OutputScale, data.OutputFilter);
+            // the scaled frame lives in ScaledImageBuffer, which is overwritten by the next frame
+            DeliverFrame(data, base, mointor, reinterpret_cast<const unsigned char *>(StartSrc(scaled)), scaled.RowStrideInBytes, Rect(scaled),
+                         nullptr);
+        }
+        else {
+            DeliverFrame(data, base, mointor, startsrc, srcrowstride, imageract, base.CurrentBuffer);
+        }
+        if (capacity != base.Scratch.capacity() + base.ScaledImageBuffer.capacity() + base.ThumbnailBuffer.capacity() + base.Tiles.capacity()) {
+            data.Statistics.FramesWithAllocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        // the next frame is timed by its own grab
+        base.CaptureTime = 0;
     }
 } // namespace Screen_Capture
 } // namespace SL
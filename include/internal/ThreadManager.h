@@ -1,6 +1,7 @@
 #pragma once
 #include "internal/SCCommon.h"
 #include "ScreenCapture.h"
+#include <algorithm>
 #include <atomic>
 #include <iostream>
 #include <memory>
@@ -76,25 +77,35 @@ namespace Screen_Capture {
         for (size_t i = 0; i < startmonitors.size(); i++) {
             if (startmonitors[i].Height != nowmonitors[i].Height || startmonitors[i].Id != nowmonitors[i].Id ||
                 startmonitors[i].Index != nowmonitors[i].Index || startmonitors[i].OffsetX != nowmonitors[i].OffsetX ||
-                startmonitors[i].OffsetY != nowmonitors[i].OffsetY || startmonitors[i].Width != nowmonitors[i].Width)
+                startmonitors[i].OffsetY != nowmonitors[i].OffsetY || startmonitors[i].Width != nowmonitors[i].Width ||
+                startmonitors[i].RefreshRate != nowmonitors[i].RefreshRate)
                 return true;
         }
         return false;
     }
+    // how often WatchMonitors compares the monitors with those the capture started with
+    constexpr auto MonitorCheckInterval = 250ms;
+    // asks for the capture to be rebuilt once the monitors differ from startmonitors. GetMonitors talks to the platform and allocates, so
+    // the monitors are checked on a thread of their own instead of on every frame of the capture threads
+    void WatchMonitors(std::shared_ptr<Thread_Data> data, std::vector<Monitor> startmonitors);
+
     template <class T, class F> bool TryCaptureMonitor(const F &data, Monitor &monitor)
     {
         T frameprocessor;   
         frameprocessor.ImageBufferSize = Width(monitor) * Height(monitor) * sizeof(ImageBGRA);
-        if (data->ScreenCaptureData.OnFrameChanged) { // only need the old buffer if difs are needed. If no dif is needed, then the
-                                                      // image is always new
+        if (KeepsLastFrame(data->ScreenCaptureData)) { // only need the old buffer if difs are needed. If no dif is needed, then the
+                                                       // image is always new
             frameprocessor.ImageBuffer = std::make_unique<unsigned char[]>(frameprocessor.ImageBufferSize);
         }
-        auto startmonitors = GetMonitors();
+        // changes after this are found by WatchMonitors
+        const auto monitors = GetMonitors();
+        RefreshPacer pacer;
         auto ret = frameprocessor.Init(data, monitor);
         if (ret != DUPL_RETURN_SUCCESS) {
             return false;
         }
-    
+        const auto insidebounds = isMonitorInsideBounds(monitors, monitor);
+
         while (!data->CommonData_.TerminateThreadsEvent) {
             // get a copy of the shared_ptr in a safe way
             
@@ -105,8 +116,8 @@ namespace Screen_Capture {
             auto timer = std::atomic_load(&data->ScreenCaptureData.FrameTimer);
 #endif
             timer->start();
-            auto monitors = GetMonitors();
-            if (isMonitorInsideBounds(monitors, monitor) && !HasMonitorsChanged(startmonitors, monitors)) {
+            const auto paced = pacer.start(RefreshPeriod(data->ScreenCaptureData, monitor));
+            if (insidebounds) {
                 ret = frameprocessor.ProcessFrame(monitors[Index(monitor)]);
             }
             else {
@@ -126,7 +137,12 @@ namespace Screen_Capture {
                 }
                 return true;
             }
-            timer->wait();
+            if (paced) {
+                pacer.wait();
+            }
+            else {
+                timer->wait();
+            }
             while (data->CommonData_.Paused) {
                 frameprocessor.Pause();
                 std::this_thread::sleep_for(50ms);
@@ -139,8 +155,8 @@ namespace Screen_Capture {
     {
         T frameprocessor;
         frameprocessor.ImageBufferSize = wnd.Size.x * wnd.Size.y * sizeof(ImageBGRA);
-        if (data->WindowCaptureData.OnFrameChanged) { // only need the old buffer if difs are needed. If no dif is needed, then the
-                                                      // image is always new
+        if (KeepsLastFrame(data->WindowCaptureData)) { // only need the old buffer if difs are needed. If no dif is needed, then the
+                                                       // image is always new
             frameprocessor.ImageBuffer = std::make_unique<unsigned char[]>(frameprocessor.ImageBufferSize);
         }
         auto ret = frameprocessor.Init(data, wnd);
@@ -177,8 +193,83 @@ namespace Screen_Capture {
         return true;
     }
 
+    // T grabs rects of the desktop. Every region keeps its own diff state, the regions of a cluster are cut out of a single grab
+    template <class T, class F> bool TryCaptureRegions(const F &data, const std::vector<Region> &regions)
+    {
+        T frameprocessor;
+        auto clusters = ClusterRegions(regions);
+        std::vector<BaseFrameProcessor> states(regions.size());
+        for (size_t i = 0; i < regions.size(); i++) {
+            states[i].ImageBufferSize = Width(regions[i]) * Height(regions[i]) * sizeof(ImageBGRA);
+            if (KeepsLastFrame(data->RegionCaptureData)) { // only need the old buffer if difs are needed
+                states[i].ImageBuffer = std::make_unique<unsigned char[]>(states[i].ImageBufferSize);
+            }
+        }
+        // changes after this are found by WatchMonitors
+        const auto monitors = GetMonitors();
+        auto ret = frameprocessor.Init(data, clusters);
+        if (ret != DUPL_RETURN_SUCCESS) {
+            return false;
+        }
+        const auto insidebounds =
+            std::all_of(regions.begin(), regions.end(), [&](const Region &r) { return isRegionInsideBounds(monitors, r); });
+
+        while (!data->CommonData_.TerminateThreadsEvent) {
+            frameprocessor.Resume();
+#if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
+            auto timer = data->RegionCaptureData.FrameTimer.load();
+#else
+            auto timer = std::atomic_load(&data->RegionCaptureData.FrameTimer);
+#endif
+            timer->start();
+            if (insidebounds) {
+                for (size_t c = 0; c < clusters.size() && ret == DUPL_RETURN_SUCCESS; c++) {
+                    const unsigned char *startsrc = nullptr;
+                    auto srcrowstride = 0;
+                    ret = frameprocessor.ProcessFrame(c, startsrc, srcrowstride);
+                    if (ret == DUPL_RETURN_SUCCESS) {
+                        // the regions of a cluster come out of the same grab
+                        const auto capturetime = MonotonicTime();
+                        for (auto i : clusters[c].Regions) {
+                            states[i].CaptureTime = capturetime;
+                            auto &rect = Rect(regions[i]);
+                            auto regionsrc = startsrc + (rect.top - clusters[c].Bounds.top) * srcrowstride +
+                                             (rect.left - clusters[c].Bounds.left) * static_cast<int>(sizeof(ImageBGRA));
+                            ProcessCapture(data->RegionCaptureData, states[i], regions[i], regionsrc, srcrowstride);
+                        }
+                    }
+                }
+            }
+            else {
+                // something happened, rebuild
+                ret = DUPL_RETURN_ERROR_EXPECTED;
+            }
+            if (ret != DUPL_RETURN_SUCCESS) {
+                if (ret == DUPL_RETURN_ERROR_EXPECTED) {
+                    // The system is in a transition state so request the duplication be restarted
+                    data->CommonData_.ExpectedErrorEvent = true;
+                    std::cout << "Exiting Thread due to expected error " << std::endl;
+                }
+                else {
+                    // Unexpected error so exit the application
+                    data->CommonData_.UnexpectedErrorEvent = true;
+                    std::cout << "Exiting Thread due to Unexpected error " << std::endl;
+                }
+                return true;
+            }
+            timer->wait();
+            while (data->CommonData_.Paused) {
+                frameprocessor.Pause();
+                std::this_thread::sleep_for(50ms);
+            }
+        }
+        return true;
+    }
+
     void RunCaptureMonitor(std::shared_ptr<Thread_Data> data, Monitor monitor);
     void RunCaptureWindow(std::shared_ptr<Thread_Data> data, Window window);
+    void RunCaptureRegions(std::shared_ptr<Thread_Data> data, std::vector<Region> regions);
+    void RunReplayMonitor(std::shared_ptr<Thread_Data> data, Monitor monitor);
 
     void RunCaptureMouse(std::shared_ptr<Thread_Data> data);
 } // namespace Screen_Capture
@@ -0,0 +1,22 @@
+#pragma once
+#include "internal/SCCommon.h"
+#include <memory>
+#include <vector>
+
+namespace SL {
+    namespace Screen_Capture {
+        // grabs each cluster of regions with a single CGWindowListCreateImage call
+        class CGRegionProcessor {
+            std::vector<ImageRect> Bounds;
+            std::vector<const void *> Grabs; // CFDataRef of the last grab of each cluster, kept alive until the next one
+        public:
+            ~CGRegionProcessor();
+            void Pause() {}
+            void Resume() {}
+            DUPL_RETURN Init(std::shared_ptr<Thread_Data> data, const std::vector<RegionCluster> &clusters);
+            // grabs cluster index, data points at the top left pixel of the cluster bounds
+            DUPL_RETURN ProcessFrame(size_t index, const unsigned char *&data, int &rowstride);
+        };
+
+    }
+}
@@ -1,20 +1,50 @@
 #pragma once
 #include "internal/SCCommon.h"
 #include <memory>
+#include <vector>
 #include <X11/Xlib.h>
 #include <sys/shm.h>
 #include <X11/extensions/XShm.h>
+#if defined(SCREEN_CAPTURE_LITE_XCOMPOSITE)
+#include <X11/extensions/Xcomposite.h>
+#endif
+#include <X11/extensions/Xfixes.h>
 
 namespace SL {
     namespace Screen_Capture {
+
+        // one shared memory image, consumers can hold it with RetainFrame while the processor captures into the others
+        struct X11FrameBuffer : public FrameBuffer {
+            XImage* XImage_ = nullptr;
+            XShmSegmentInfo ShmInfo = {};
+            ~X11FrameBuffer();
+        };
    
         class X11FrameProcessor: public BaseFrameProcessor {
             
 			Display* SelectedDisplay=nullptr;
             XID SelectedWindow = 0;
+            // the image of the buffer the next frame is captured into
 			XImage* XImage_=nullptr;
-			std::unique_ptr<XShmSegmentInfo> ShmInfo;
+            std::vector<std::shared_ptr<X11FrameBuffer>> Buffers;
+            size_t NextBuffer = 0;
             Monitor SelectedMonitor;
+            // window capture reads the backing pixmap of the redirected window when XComposite is there (and was found at build time), so
+            // covered parts are right too
+            bool Redirected = false;
+            bool Mapped = true;
+            Pixmap WindowPixmap = 0;
+            Visual* WindowVisual = nullptr;
+            int WindowDepth = 0;
+            // the cursor is read with XFixes, without it it is never drawn
+            bool HasXFixes = false;
+
+            bool AllocateImage(Visual* visual, int depth, int width, int height, int count);
+            void FreeImage();
+            bool NextImage();
+            DUPL_RETURN ResizeWindowImage(Window& selectedwindow, int width, int height);
+            // reads the cursor into Cursor, x and y are where the frame starts on the root window
+            void ReadCursor(int x, int y);
             
         public:
             X11FrameProcessor();
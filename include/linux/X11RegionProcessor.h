@@ -0,0 +1,34 @@
+#pragma once
+#include "internal/SCCommon.h"
+#include <memory>
+#include <vector>
+#include <X11/Xlib.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+
+namespace SL {
+    namespace Screen_Capture {
+
+        // grabs each cluster of regions straight off the root window, one shared memory image per cluster
+        class X11RegionProcessor {
+
+            struct ClusterImage {
+                XImage *XImage_ = nullptr;
+                XShmSegmentInfo ShmInfo = {};
+                ImageRect Bounds;
+            };
+            Display *SelectedDisplay = nullptr;
+            std::vector<ClusterImage> Clusters;
+
+        public:
+            X11RegionProcessor() {}
+            ~X11RegionProcessor();
+
+            void Pause() {}
+            void Resume() {}
+            DUPL_RETURN Init(std::shared_ptr<Thread_Data> data, const std::vector<RegionCluster> &clusters);
+            // grabs cluster index, data points at the top left pixel of the cluster bounds
+            DUPL_RETURN ProcessFrame(size_t index, const unsigned char *&data, int &rowstride);
+        };
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "internal/SCCommon.h"
+#include <memory>
+#include <vector>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+#include <xcb/damage.h>
+#include <xcb/composite.h>
+#include <xcb/xfixes.h>
+
+namespace SL {
+    namespace Screen_Capture {
+
+        // one shared memory segment, consumers can hold it with RetainFrame while the processor captures into the others
+        struct XCBFrameBuffer : public FrameBuffer {
+            xcb_shm_seg_t ShmSeg = XCB_NONE;
+            unsigned char *ShmData = nullptr;
+            ~XCBFrameBuffer();
+        };
+
+        // X11FrameProcessor on xcb. The requests of a frame are all sent before the first reply is waited for, and the screen is only read
+        // again after the server reported damage on it
+        class XCBFrameProcessor : public BaseFrameProcessor {
+
+            xcb_connection_t *Connection = nullptr;
+            xcb_window_t Root = XCB_NONE;
+            xcb_window_t SelectedWindow = XCB_NONE;
+            // what the image is read from, the root window, the window or its composite pixmap
+            xcb_drawable_t Source = XCB_NONE;
+            xcb_pixmap_t WindowPixmap = XCB_NONE;
+            bool Redirected = false;
+            bool Mapped = true;
+            bool Resized = false;
+            bool Destroyed = false;
+            xcb_damage_damage_t Damage = XCB_NONE;
+            uint8_t DamageNotify = 0;
+            bool Damaged = true;
+            // the cursor is read with xfixes, without it it is never drawn
+            bool HasXFixes = false;
+            std::vector<std::shared_ptr<XCBFrameBuffer>> Buffers;
+            size_t NextBuffer = 0;
+            // the buffer the last frame was read into, handed out again as long as nothing is damaged
+            XCBFrameBuffer *Buffer = nullptr;
+            // the cursor could not be taken out of the last frame because a consumer holds it
+            bool CursorInImage = false;
+            int ImageWidth = 0;
+            int ImageHeight = 0;
+            Monitor SelectedMonitor;
+
+            DUPL_RETURN Connect();
+            bool AllocateImage(int width, int height, int count);
+            void FreeImage();
+            bool NextImage();
+            // whether the last frame can not be handed out again and the screen has to be read into the next buffer
+            bool NeedsRead(bool cursor) const { return Damaged || !Buffer || CursorInImage || (cursor && Buffer->isHeld()); }
+            int RowStride() const { return ImageWidth * static_cast<int>(sizeof(ImageBGRA)); }
+            void ProcessEvents(const xcb_rectangle_t &bounds);
+            DUPL_RETURN ResizeWindowImage(Window &selectedwindow);
+            // reads the cursor into Cursor and draws it into the image
+            void DrawCursor();
+
+          public:
+            XCBFrameProcessor() {}
+            ~XCBFrameProcessor();
+
+            void Pause() {}
+            void Resume() {}
+            DUPL_RETURN Init(std::shared_ptr<Thread_Data> data, Monitor &monitor);
+            DUPL_RETURN ProcessFrame(const Monitor &currentmonitorinfo);
+            DUPL_RETURN Init(std::shared_ptr<Thread_Data> data, const Window &selectedwindow);
+            DUPL_RETURN ProcessFrame(Window &selectedwindow);
+        };
+    }
+}
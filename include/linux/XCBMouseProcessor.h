@@ -0,0 +1,28 @@
+#pragma once
+#include "internal/SCCommon.h"
+#include <memory>
+#include <xcb/xcb.h>
+#include <xcb/xfixes.h>
+
+namespace SL {
+    namespace Screen_Capture {
+
+        // X11MouseProcessor on xcb. The cursor image is only asked for after the server reported a new cursor, and then together with the
+        // pointer position
+        class XCBMouseProcessor : public BaseMouseProcessor {
+            xcb_connection_t *Connection = nullptr;
+            xcb_window_t Root = XCB_NONE;
+            uint8_t CursorNotify = 0;
+            bool CursorChanged = true;
+            Point HotSpot = {0, 0};
+
+        public:
+            const int MaxCursurorSize = 32;
+            XCBMouseProcessor() {}
+            ~XCBMouseProcessor();
+            DUPL_RETURN Init(std::shared_ptr<Thread_Data> data);
+            DUPL_RETURN ProcessFrame();
+        };
+
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "ScreenCapture.h"
+#include "internal/SCCommon.h"
+#include <memory>
+#include <vector>
+#include "GDIHelpers.h"
+
+namespace SL {
+    namespace Screen_Capture {
+
+        // BitBlts each cluster of regions out of the virtual desktop, one bitmap per cluster
+        class GDIRegionProcessor {
+            HDCWrapper DesktopDC;
+            HDCWrapper CaptureDC;
+            std::unique_ptr<HBITMAPWrapper[]> CaptureBMPs;
+            std::vector<ImageRect> Bounds;
+            std::vector<std::unique_ptr<unsigned char[]>> ImageBuffers;
+
+        public:
+            void Pause() {}
+            void Resume() {}
+            DUPL_RETURN Init(std::shared_ptr<Thread_Data> data, const std::vector<RegionCluster> &clusters);
+            // grabs cluster index, data points at the top left pixel of the cluster bounds
+            DUPL_RETURN ProcessFrame(size_t index, const unsigned char *&data, int &rowstride);
+        };
+    }
+}
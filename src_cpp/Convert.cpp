@@ -0,0 +1,402 @@
+#include "ScreenCapture_Convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCL_CONVERT_SSE2 1
+#include <emmintrin.h>
+#if defined(__SSSE3__) || defined(__AVX__)
+#define SCL_CONVERT_SSSE3 1
+#include <tmmintrin.h>
+#endif
+#endif
+
+namespace SL {
+namespace Screen_Capture {
+
+    namespace {
+        // the YUV math is done in fixed point with this many fractional bits, small enough that two products still fit the 16 bit
+        // multiply-add of SSE2
+        const int Shift = 14;
+
+        struct YuvCoefficients {
+            short YR, YG, YB;
+            int YBias;
+            short UR, UG, UB;
+            short VR, VG, VB;
+            int UVBias;
+        };
+
+        short ToFixed(double v) { return static_cast<short>(std::lround(v * (1 << Shift))); }
+
+        YuvCoefficients MakeCoefficients(ColorMatrix matrix, ColorRange range)
+        {
+            const auto kr = matrix == ColorMatrix::BT709 ? 0.2126 : 0.299;
+            const auto kb = matrix == ColorMatrix::BT709 ? 0.0722 : 0.114;
+            const auto yscale = range == ColorRange::Full ? 1.0 : 219.0 / 255.0;
+            const auto cscale = range == ColorRange::Full ? 1.0 : 224.0 / 255.0;
+
+            YuvCoefficients c;
+            // the green coefficients are derived from the others so that white maps exactly to the top of the range and grays have
+            // no chroma, independent of how the others were rounded
+            c.YR = ToFixed(kr * yscale);
+            c.YB = ToFixed(kb * yscale);
+            c.YG = static_cast<short>(ToFixed(yscale) - c.YR - c.YB);
+            c.YBias = ((range == ColorRange::Full ? 0 : 16) << Shift) + (1 << (Shift - 1));
+            c.UB = ToFixed(0.5 * cscale);
+            c.UR = ToFixed(-0.5 * kr / (1 - kb) * cscale);
+            c.UG = static_cast<short>(-c.UB - c.UR);
+            c.VR = ToFixed(0.5 * cscale);
+            c.VB = ToFixed(-0.5 * kb / (1 - kr) * cscale);
+            c.VG = static_cast<short>(-c.VR - c.VB);
+            c.UVBias = (128 << Shift) + (1 << (Shift - 1));
+            return c;
+        }
+
+        inline unsigned char Clamp(int v) { return static_cast<unsigned char>(v < 0 ? 0 : (v > 255 ? 255 : v)); }
+        inline unsigned char Dot(int r, int g, int b, short cr, short cg, short cb, int bias)
+        {
+            return Clamp((r * cr + g * cg + b * cb + bias) >> Shift);
+        }
+
+        const unsigned char *Row(const Image &img, int y)
+        {
+            return reinterpret_cast<const unsigned char *>(StartSrc(img)) + static_cast<size_t>(y) * img.RowStrideInBytes;
+        }
+
+#if SCL_CONVERT_SSE2
+        // splits 8 BGRA pixels into 16 bit lanes per channel
+        inline void Channels(__m128i a, __m128i b, __m128i &r, __m128i &g, __m128i &bl)
+        {
+            const auto mask = _mm_set1_epi32(0xFF);
+            bl = _mm_packs_epi32(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+            g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 8), mask), _mm_and_si128(_mm_srli_epi32(b, 8), mask));
+            r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 16), mask), _mm_and_si128(_mm_srli_epi32(b, 16), mask));
+        }
+
+        // cr * r + cg * g + cb * b + bias for 8 pixels, returns 16 bit lanes
+        inline __m128i Dot8(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb, int bias)
+        {
+            const auto crg = _mm_set1_epi32(static_cast<int>((static_cast<uint32_t>(static_cast<uint16_t>(cg)) << 16) | static_cast<uint16_t>(cr)));
+            const auto cb0 = _mm_set1_epi32(static_cast<uint16_t>(cb));
+            const auto vbias = _mm_set1_epi32(bias);
+            const auto zero = _mm_setzero_si128();
+            auto lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r, g), crg), _mm_madd_epi16(_mm_unpacklo_epi16(b, zero), cb0));
+            auto hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r, g), crg), _mm_madd_epi16(_mm_unpackhi_epi16(b, zero), cb0));
+            lo = _mm_srai_epi32(_mm_add_epi32(lo, vbias), Shift);
+            hi = _mm_srai_epi32(_mm_add_epi32(hi, vbias), Shift);
+            return _mm_packs_epi32(lo, hi);
+        }
+
+        // adds neighbouring lanes of two vectors of 8 channel values, the result has the 4 + 4 sums
+        inline __m128i PairSums(__m128i a, __m128i b)
+        {
+            const auto ones = _mm_set1_epi16(1);
+            return _mm_packs_epi32(_mm_madd_epi16(a, ones), _mm_madd_epi16(b, ones));
+        }
+#endif
+
+        void LumaRow(const unsigned char *src, unsigned char *dst, int width, const YuvCoefficients &c)
+        {
+            auto x = 0;
+#if SCL_CONVERT_SSE2
+            for (; x + 16 <= width; x += 16) {
+                auto p = reinterpret_cast<const __m128i *>(src + x * 4);
+                __m128i r, g, b;
+                Channels(_mm_loadu_si128(p), _mm_loadu_si128(p + 1), r, g, b);
+                auto y0 = Dot8(r, g, b, c.YR, c.YG, c.YB, c.YBias);
+                Channels(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3), r, g, b);
+                auto y1 = Dot8(r, g, b, c.YR, c.YG, c.YB, c.YBias);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(y0, y1));
+            }
+#endif
+            for (; x < width; x++) {
+                auto p = src + x * 4;
+                dst[x] = Dot(p[2], p[1], p[0], c.YR, c.YG, c.YB, c.YBias);
+            }
+        }
+
+        // Converts two source rows into two luma rows and one row of chroma. row1 is the same as row0 and y1 is null for the last row of
+        // an odd height image. Chroma is written to u and v, pixelstep apart, so the same code serves NV12 (interleaved) and I420.
+        void YuvRows(const unsigned char *row0, const unsigned char *row1, unsigned char *y0, unsigned char *y1, unsigned char *u, unsigned char *v,
+                     int pixelstep, int width, const YuvCoefficients &c)
+        {
+            auto x = 0;
+#if SCL_CONVERT_SSE2
+            for (; x + 16 <= width; x += 16) {
+                __m128i sumr[2], sumg[2], sumb[2];
+                for (auto half = 0; half < 2; half++) {
+                    auto p0 = reinterpret_cast<const __m128i *>(row0 + (x + half * 8) * 4);
+                    auto p1 = reinterpret_cast<const __m128i *>(row1 + (x + half * 8) * 4);
+                    __m128i r0, g0, b0, r1, g1, b1;
+                    Channels(_mm_loadu_si128(p0), _mm_loadu_si128(p0 + 1), r0, g0, b0);
+                    Channels(_mm_loadu_si128(p1), _mm_loadu_si128(p1 + 1), r1, g1, b1);
+                    auto l0 = Dot8(r0, g0, b0, c.YR, c.YG, c.YB, c.YBias);
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(y0 + x + half * 8), _mm_packus_epi16(l0, l0));
+                    if (y1) {
+                        auto l1 = Dot8(r1, g1, b1, c.YR, c.YG, c.YB, c.YBias);
+                        _mm_storel_epi64(reinterpret_cast<__m128i *>(y1 + x + half * 8), _mm_packus_epi16(l1, l1));
+                    }
+                    sumr[half] = _mm_add_epi16(r0, r1);
+                    sumg[half] = _mm_add_epi16(g0, g1);
+                    sumb[half] = _mm_add_epi16(b0, b1);
+                }
+                // average of each 2x2 block, rounded
+                const auto two = _mm_set1_epi16(2);
+                auto r = _mm_srli_epi16(_mm_add_epi16(PairSums(sumr[0], sumr[1]), two), 2);
+                auto g = _mm_srli_epi16(_mm_add_epi16(PairSums(sumg[0], sumg[1]), two), 2);
+                auto b = _mm_srli_epi16(_mm_add_epi16(PairSums(sumb[0], sumb[1]), two), 2);
+                auto cu = Dot8(r, g, b, c.UR, c.UG, c.UB, c.UVBias);
+                auto cv = Dot8(r, g, b, c.VR, c.VG, c.VB, c.UVBias);
+                auto u8 = _mm_packus_epi16(cu, cu);
+                auto v8 = _mm_packus_epi16(cv, cv);
+                if (pixelstep == 2) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x), _mm_unpacklo_epi8(u8, v8));
+                }
+                else {
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(u + x / 2), u8);
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(v + x / 2), v8);
+                }
+            }
+#endif
+            for (; x < width; x += 2) {
+                // the last column of an odd width image is paired with itself
+                const auto x1 = x + 1 < width ? x + 1 : x;
+                auto a = row0 + x * 4, b = row0 + x1 * 4, d = row1 + x * 4, e = row1 + x1 * 4;
+                y0[x] = Dot(a[2], a[1], a[0], c.YR, c.YG, c.YB, c.YBias);
+                if (x1 != x) {
+                    y0[x1] = Dot(b[2], b[1], b[0], c.YR, c.YG, c.YB, c.YBias);
+                }
+                if (y1) {
+                    y1[x] = Dot(d[2], d[1], d[0], c.YR, c.YG, c.YB, c.YBias);
+                    if (x1 != x) {
+                        y1[x1] = Dot(e[2], e[1], e[0], c.YR, c.YG, c.YB, c.YBias);
+                    }
+                }
+                const auto r = (a[2] + b[2] + d[2] + e[2] + 2) >> 2;
+                const auto g = (a[1] + b[1] + d[1] + e[1] + 2) >> 2;
+                const auto bl = (a[0] + b[0] + d[0] + e[0] + 2) >> 2;
+                u[x / 2 * pixelstep] = Dot(r, g, bl, c.UR, c.UG, c.UB, c.UVBias);
+                v[x / 2 * pixelstep] = Dot(r, g, bl, c.VR, c.VG, c.VB, c.UVBias);
+            }
+        }
+
+        void ExtractAndConvertToYuv(const Image &img, unsigned char *y, int ystride, unsigned char *u, int ustride, unsigned char *v, int vstride,
+                                    int pixelstep, ColorMatrix matrix, ColorRange range)
+        {
+            const auto c = MakeCoefficients(matrix, range);
+            const auto width = Width(img);
+            const auto height = Height(img);
+            for (auto row = 0; row < height; row += 2) {
+                const auto last = row + 1 >= height;
+                YuvRows(Row(img, row), Row(img, last ? row : row + 1), y + static_cast<size_t>(row) * ystride,
+                        last ? nullptr : y + static_cast<size_t>(row + 1) * ystride, u + static_cast<size_t>(row / 2) * ustride,
+                        v + static_cast<size_t>(row / 2) * vstride, pixelstep, width, c);
+            }
+        }
+    } // namespace
+
+    void ExtractAndConvertToRGBA(const Image &img, unsigned char *dst, size_t dst_size)
+    {
+        assert(dst_size >= static_cast<size_t>(Width(img) * Height(img) * 4));
+        (void)dst_size;
+        const auto width = Width(img);
+        for (auto row = 0; row < Height(img); row++) {
+            auto src = Row(img, row);
+            auto x = 0;
+#if SCL_CONVERT_SSE2
+            const auto green = _mm_set1_epi32(0x0000FF00);
+            const auto low = _mm_set1_epi32(0x000000FF);
+            const auto alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+            for (; x + 4 <= width; x += 4) {
+                auto p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+                // swap the B and R bytes of every pixel
+                auto swapped = _mm_or_si128(_mm_and_si128(p, green), _mm_and_si128(_mm_srli_epi32(p, 16), low));
+                swapped = _mm_or_si128(swapped, _mm_slli_epi32(_mm_and_si128(p, low), 16));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_or_si128(swapped, alpha));
+            }
+#endif
+            for (; x < width; x++) {
+                dst[x * 4] = src[x * 4 + 2];
+                dst[x * 4 + 1] = src[x * 4 + 1];
+                dst[x * 4 + 2] = src[x * 4];
+                dst[x * 4 + 3] = 255;
+            }
+            dst += static_cast<size_t>(width) * 4;
+        }
+    }
+
+    void ExtractAndConvertToRGB(const Image &img, unsigned char *dst, size_t dst_size)
+    {
+        assert(dst_size >= static_cast<size_t>(Width(img) * Height(img) * 3));
+        (void)dst_size;
+        const auto width = Width(img);
+        for (auto row = 0; row < Height(img); row++) {
+            auto src = Row(img, row);
+            auto x = 0;
+#if SCL_CONVERT_SSSE3
+            const auto shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+            // every store writes 16 bytes for 12 bytes of output, stop early enough to never write past the end of the row
+            for (; x + 6 <= width; x += 4) {
+                auto p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 3), _mm_shuffle_epi8(p, shuffle));
+            }
+#else
+            // 4 pixels at a time, swizzled in two (little endian) words and written as 12 bytes instead of byte by byte
+            for (; x + 4 <= width; x += 4) {
+                uint64_t a, b;
+                memcpy(&a, src + x * 4, sizeof(a));
+                memcpy(&b, src + x * 4 + 8, sizeof(b));
+                auto swap = [](uint64_t q) {
+                    return ((q >> 16) & 0x000000FF000000FFull) | (q & 0x0000FF000000FF00ull) | ((q & 0x000000FF000000FFull) << 16);
+                };
+                a = swap(a);
+                b = swap(b);
+                const uint64_t first = (a & 0xFFFFFF) | ((a >> 8) & 0xFFFFFF000000ull) | (b << 48);
+                const uint32_t last = static_cast<uint32_t>(((b >> 16) & 0xFF) | ((b >> 24) & 0xFFFFFF00ull));
+                memcpy(dst + x * 3, &first, sizeof(first));
+                memcpy(dst + x * 3 + 8, &last, sizeof(last));
+            }
+#endif
+            for (; x < width; x++) {
+                dst[x * 3] = src[x * 4 + 2];
+                dst[x * 3 + 1] = src[x * 4 + 1];
+                dst[x * 3 + 2] = src[x * 4];
+            }
+            dst += static_cast<size_t>(width) * 3;
+        }
+    }
+
+    void ExtractAndConvertToGray(const Image &img, unsigned char *dst, size_t dst_size, ColorMatrix matrix)
+    {
+        assert(dst_size >= static_cast<size_t>(Width(img) * Height(img)));
+        (void)dst_size;
+        const auto c = MakeCoefficients(matrix, ColorRange::Full);
+        for (auto row = 0; row < Height(img); row++) {
+            LumaRow(Row(img, row), dst + static_cast<size_t>(row) * Width(img), Width(img), c);
+        }
+    }
+
+    void ExtractAndConvertToNV12(const Image &img, unsigned char *y, int ystride, unsigned char *uv, int uvstride, ColorMatrix matrix,
+                                 ColorRange range)
+    {
+        ExtractAndConvertToYuv(img, y, ystride, uv, uvstride, uv + 1, uvstride, 2, matrix, range);
+    }
+
+    void ExtractAndConvertToI420(const Image &img, unsigned char *y, int ystride, unsigned char *u, int ustride, unsigned char *v, int vstride,
+                                 ColorMatrix matrix, ColorRange range)
+    {
+        ExtractAndConvertToYuv(img, y, ystride, u, ustride, v, vstride, 1, matrix, range);
+    }
+
+    ImageRect DownscaledRect(const ImageRect &rect, int divisor)
+    {
+        return ImageRect(0, 0, std::max(1, Width(rect) / divisor), std::max(1, Height(rect) / divisor));
+    }
+
+    void ExtractAndDownscale(const Image &img, unsigned char *dst, size_t dst_size, int divisor, ScaleFilter filter)
+    {
+        assert(divisor == 1 || divisor == 2 || divisor == 4 || divisor == 8);
+        const auto out = DownscaledRect(Rect(img), divisor);
+        assert(dst_size >= static_cast<size_t>(Width(out) * Height(out) * 4));
+        if (divisor == 1) {
+            Extract(img, dst, dst_size);
+            return;
+        }
+        const auto width = Width(img);
+        const auto height = Height(img);
+        // Box sums the whole divisor x divisor block, Bilinear the 2x2 pixels around its center. Either way the number of taps is a power
+        // of two so the average is a shift
+        const auto taps = filter == ScaleFilter::Box ? divisor : 2;
+        const auto first = filter == ScaleFilter::Box ? 0 : divisor / 2 - 1;
+        auto shift = 0;
+        while ((1 << shift) < taps * taps) {
+            shift++;
+        }
+
+        // column sums for a chunk of the output row, kept on the stack so a frame never allocates. The largest block is 8x8 pixels of 255,
+        // which still fits 16 bits
+        const int Chunk = 64;
+        alignas(16) uint16_t sums[Chunk * 8 * 4];
+
+        for (auto oy = 0; oy < Height(out); oy++) {
+            const unsigned char *rows[8];
+            for (auto t = 0; t < taps; t++) {
+                rows[t] = Row(img, std::min(oy * divisor + first + t, height - 1));
+            }
+            auto outrow = dst + static_cast<size_t>(oy) * Width(out) * 4;
+            for (auto ox0 = 0; ox0 < Width(out); ox0 += Chunk) {
+                const auto ox1 = std::min(ox0 + Chunk, Width(out));
+                const auto c0 = ox0 * divisor;
+                const auto bytes = (std::min(ox1 * divisor, width) - c0) * 4;
+
+                for (auto t = 0; t < taps; t++) {
+                    auto src = rows[t] + c0 * 4;
+                    auto i = 0;
+#if SCL_CONVERT_SSE2
+                    const auto zero = _mm_setzero_si128();
+                    for (; i + 16 <= bytes; i += 16) {
+                        auto p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                        auto lo = _mm_unpacklo_epi8(p, zero);
+                        auto hi = _mm_unpackhi_epi8(p, zero);
+                        auto acc = reinterpret_cast<__m128i *>(sums + i);
+                        if (t == 0) {
+                            _mm_store_si128(acc, lo);
+                            _mm_store_si128(acc + 1, hi);
+                        }
+                        else {
+                            _mm_store_si128(acc, _mm_add_epi16(_mm_load_si128(acc), lo));
+                            _mm_store_si128(acc + 1, _mm_add_epi16(_mm_load_si128(acc + 1), hi));
+                        }
+                    }
+#endif
+                    for (; i < bytes; i++) {
+                        sums[i] = static_cast<uint16_t>((t == 0 ? 0 : sums[i]) + src[i]);
+                    }
+                }
+
+                const auto round = 1 << (shift - 1);
+                auto ox = ox0;
+#if SCL_CONVERT_SSE2
+                // two output pixels per iteration, each tap adds the 4 channel sums of one column. Images smaller than a block need the
+                // clamping below
+                if (width >= divisor) {
+                    const auto vround = _mm_set1_epi16(static_cast<short>(round));
+                    for (; ox + 2 <= ox1; ox += 2) {
+                        auto total = _mm_setzero_si128();
+                        for (auto t = 0; t < taps; t++) {
+                            auto s = sums + (ox * divisor + first + t - c0) * 4;
+                            auto pair = _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(s)),
+                                                           _mm_loadl_epi64(reinterpret_cast<const __m128i *>(s + divisor * 4)));
+                            total = _mm_add_epi16(total, pair);
+                        }
+                        total = _mm_srli_epi16(_mm_add_epi16(total, vround), shift);
+                        _mm_storel_epi64(reinterpret_cast<__m128i *>(outrow + ox * 4), _mm_packus_epi16(total, total));
+                    }
+                }
+#endif
+                for (; ox < ox1; ox++) {
+                    unsigned int b = 0, g = 0, r = 0, a = 0;
+                    for (auto t = 0; t < taps; t++) {
+                        // only clamps for images that are smaller than a single block
+                        auto s = sums + (std::min(ox * divisor + first + t, width - 1) - c0) * 4;
+                        b += s[0];
+                        g += s[1];
+                        r += s[2];
+                        a += s[3];
+                    }
+                    auto o = outrow + ox * 4;
+                    o[0] = static_cast<unsigned char>((b + round) >> shift);
+                    o[1] = static_cast<unsigned char>((g + round) >> shift);
+                    o[2] = static_cast<unsigned char>((r + round) >> shift);
+                    o[3] = static_cast<unsigned char>((a + round) >> shift);
+                }
+            }
+        }
+    }
+
+} // namespace Screen_Capture
+} // namespace SL
@@ -0,0 +1,169 @@
+#include "internal/SCCommon.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCL_CURSOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace SL {
+namespace Screen_Capture {
+
+    namespace {
+        // v * (255 - alpha) / 255, rounded, without a division
+        inline int Scale(int v, int alpha)
+        {
+            const auto t = v * (255 - alpha) + 128;
+            return (t + (t >> 8)) >> 8;
+        }
+
+        // premultiplied over: dst = src + dst * (1 - src alpha)
+        void BlendRow(ImageBGRA *dst, const ImageBGRA *src, int count)
+        {
+            auto x = 0;
+#if SCL_CURSOR_SSE2
+            const auto zero = _mm_setzero_si128();
+            const auto round = _mm_set1_epi16(128);
+            for (; x + 4 <= count; x += 4) {
+                const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+                // most of a cursor is transparent, those pixels stay as they are
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xFFFF) {
+                    continue;
+                }
+                const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + x));
+                // 255 - alpha in all 4 bytes of each pixel
+                auto a = _mm_srli_epi32(s, 24);
+                a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+                a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+                const auto inv = _mm_xor_si128(a, _mm_set1_epi8(-1));
+                auto lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(inv, zero)), round);
+                auto hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(inv, zero)), round);
+                lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+                hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_adds_epu8(_mm_packus_epi16(lo, hi), s));
+            }
+#endif
+            for (; x < count; x++) {
+                const auto &s = src[x];
+                if (!s.A && !s.R && !s.G && !s.B) {
+                    continue;
+                }
+                auto &d = dst[x];
+                d.B = static_cast<unsigned char>(std::min(255, s.B + Scale(d.B, s.A)));
+                d.G = static_cast<unsigned char>(std::min(255, s.G + Scale(d.G, s.A)));
+                d.R = static_cast<unsigned char>(std::min(255, s.R + Scale(d.R, s.A)));
+                d.A = static_cast<unsigned char>(std::min(255, s.A + Scale(d.A, s.A)));
+            }
+        }
+
+        template <class T> void TakeCursorImage(CursorSprite &cursor, int width, int height, const T *argb)
+        {
+            cursor.Width = width;
+            cursor.Height = height;
+            cursor.Pixels.resize(static_cast<size_t>(width) * height);
+            for (size_t i = 0; i < cursor.Pixels.size(); i++) {
+                const auto p = static_cast<uint32_t>(argb[i]);
+                auto &px = cursor.Pixels[i];
+                px.B = static_cast<unsigned char>(p);
+                px.G = static_cast<unsigned char>(p >> 8);
+                px.R = static_cast<unsigned char>(p >> 16);
+                px.A = static_cast<unsigned char>(p >> 24);
+            }
+            cursor.NewImage = true;
+        }
+    } // namespace
+
+    void SetCursorImage(CursorSprite &cursor, int width, int height, const uint32_t *argb) { TakeCursorImage(cursor, width, height, argb); }
+    void SetCursorImage(CursorSprite &cursor, int width, int height, const unsigned long *argb) { TakeCursorImage(cursor, width, height, argb); }
+
+    void DrawCursor(unsigned char *startsrc, int srcrowstride, int width, int height, CursorSprite &cursor)
+    {
+        cursor.LastDrawn = cursor.Drawn;
+        cursor.Drawn = ImageRect();
+        if (cursor.Visible && !cursor.Pixels.empty()) {
+            const auto left = cursor.Position.x - cursor.HotSpot.x;
+            const auto top = cursor.Position.y - cursor.HotSpot.y;
+            const ImageRect drawn(std::max(left, 0), std::max(top, 0), std::min(left + cursor.Width, width), std::min(top + cursor.Height, height));
+            if (drawn.left < drawn.right && drawn.top < drawn.bottom) {
+                cursor.Drawn = drawn;
+                const auto drawnwidth = Width(drawn);
+                cursor.Under.resize(static_cast<size_t>(drawnwidth) * Height(drawn));
+                for (auto y = drawn.top; y < drawn.bottom; y++) {
+                    auto row = reinterpret_cast<ImageBGRA *>(startsrc + static_cast<size_t>(y) * srcrowstride) + drawn.left;
+                    memcpy(&cursor.Under[static_cast<size_t>(y - drawn.top) * drawnwidth], row, drawnwidth * sizeof(ImageBGRA));
+                    BlendRow(row, &cursor.Pixels[static_cast<size_t>(y - top) * cursor.Width + (drawn.left - left)], drawnwidth);
+                }
+            }
+        }
+        cursor.Changed = cursor.NewImage || !(cursor.Drawn == cursor.LastDrawn);
+        cursor.NewImage = false;
+    }
+
+    void EraseCursor(unsigned char *startsrc, int srcrowstride, const CursorSprite &cursor)
+    {
+        const auto &drawn = cursor.Drawn;
+        const auto width = Width(drawn);
+        for (auto y = drawn.top; y < drawn.bottom; y++) {
+            memcpy(startsrc + static_cast<size_t>(y) * srcrowstride + drawn.left * sizeof(ImageBGRA),
+                   &cursor.Under[static_cast<size_t>(y - drawn.top) * width], width * sizeof(ImageBGRA));
+        }
+    }
+
+    void AddDirtyBlocks(std::vector<ImageRect> &rects, const std::vector<ImageRect> &dirty, const ImageRect &bounds, int blocksize,
+                        DiffScratch &scratch)
+    {
+        const auto width = Width(bounds);
+        const auto height = Height(bounds);
+        const auto columns = (width + blocksize - 1) / blocksize;
+        const auto rows = (height + blocksize - 1) / blocksize;
+        auto &blocks = scratch.DirtyBlocks;
+        blocks.assign(static_cast<size_t>(columns) * rows, 0);
+        const auto mark = [&](const ImageRect &r) {
+            auto added = false;
+            const auto right = (std::min(r.right, width) + blocksize - 1) / blocksize;
+            const auto bottom = (std::min(r.bottom, height) + blocksize - 1) / blocksize;
+            for (auto by = std::max(r.top, 0) / blocksize; by < bottom; by++) {
+                for (auto bx = std::max(r.left, 0) / blocksize; bx < right; bx++) {
+                    auto &block = blocks[static_cast<size_t>(by) * columns + bx];
+                    added |= !block;
+                    block = 1;
+                }
+            }
+            return added;
+        };
+        for (const auto &r : rects) {
+            mark(r);
+        }
+        auto added = false;
+        for (const auto &r : dirty) {
+            added |= mark(r);
+        }
+        if (!added) {
+            return;
+        }
+        // one rect for every run of blocks in a row, merge joins them across rows
+        rects.clear();
+        for (auto by = 0; by < rows; by++) {
+            const auto top = by * blocksize;
+            const auto bottom = std::min(top + blocksize, height);
+            for (auto bx = 0; bx < columns;) {
+                if (!blocks[static_cast<size_t>(by) * columns + bx]) {
+                    bx++;
+                    continue;
+                }
+                const auto left = bx * blocksize;
+                while (bx < columns && blocks[static_cast<size_t>(by) * columns + bx]) {
+                    bx++;
+                }
+                rects.emplace_back(left, top, std::min(bx * blocksize, width), bottom);
+            }
+        }
+        merge(rects, scratch.Merged);
+    }
+
+} // namespace Screen_Capture
+} // namespace SL
@@ -0,0 +1,392 @@
+#include "ScreenCapture_Encode.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCL_ENCODE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace SL {
+namespace Screen_Capture {
+
+    namespace {
+        // Layout: "SCL1", width and height as 32 bit little endian, a flags byte, then the ops below until width * height pixels are
+        // covered. Runs carry on into the next row.
+        const unsigned char Magic[4] = {'S', 'C', 'L', '1'};
+        const size_t HeaderSize = 13;
+        const unsigned char FlagReference = 1;
+
+        // 00iiiiii                   the pixel at index i of the color cache
+        // 01rrggbb                   the previous pixel plus r, g, b, each -2..1
+        // 10gggggg rrrrbbbb          the previous pixel plus g -32..31, r and b are relative to g, -8..7
+        // 110nnnnn                   the previous pixel repeated n + 1 times
+        // 111nnnnn (up to 0xFB)      the next n + 1 pixels are the same as the reference
+        // 0xFC varint                the previous pixel repeated varint + MaxRun + 1 times
+        // 0xFD varint                the next varint + MaxRefRun + 1 pixels are the same as the reference
+        // 0xFE b g r                 a literal pixel
+        const unsigned char OpIndex = 0x00, OpDiff = 0x40, OpLuma = 0x80, OpRun = 0xC0, OpRefRun = 0xE0;
+        const unsigned char OpLongRun = 0xFC, OpLongRefRun = 0xFD, OpColor = 0xFE;
+        const uint32_t MaxRun = 32, MaxRefRun = 28;
+        // the longest op is a long run, one byte plus a 5 byte varint
+        const size_t MaxOpSize = 6;
+        const uint32_t ColorMask = 0x00FFFFFF;
+
+        inline uint32_t Hash(uint32_t px) { return (px * 0x9E3779B1u) >> 26; }
+
+        inline uint32_t Load(const unsigned char *p)
+        {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return v & ColorMask;
+        }
+
+        inline void WriteU32(unsigned char *p, uint32_t v)
+        {
+            p[0] = static_cast<unsigned char>(v);
+            p[1] = static_cast<unsigned char>(v >> 8);
+            p[2] = static_cast<unsigned char>(v >> 16);
+            p[3] = static_cast<unsigned char>(v >> 24);
+        }
+
+        inline uint32_t ReadU32(const unsigned char *p)
+        {
+            return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+                   static_cast<uint32_t>(p[3]) << 24;
+        }
+
+        // how many of the count pixels at a are the same as the pixels at b, ignoring alpha
+        int MatchLength(const unsigned char *a, const unsigned char *b, int count)
+        {
+            auto n = 0;
+#if SCL_ENCODE_SSE2
+            const auto mask = _mm_set1_epi32(static_cast<int>(ColorMask));
+            for (; n + 4 <= count; n += 4) {
+                auto x = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + n * 4)), mask);
+                auto y = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + n * 4)), mask);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(x, y)) != 0xFFFF) {
+                    break;
+                }
+            }
+#endif
+            for (; n < count && Load(a + n * 4) == Load(b + n * 4); n++) {
+            }
+            return n;
+        }
+
+        // how many of the count pixels at a are px, ignoring alpha
+        int RepeatLength(const unsigned char *a, uint32_t px, int count)
+        {
+            auto n = 0;
+#if SCL_ENCODE_SSE2
+            const auto mask = _mm_set1_epi32(static_cast<int>(ColorMask));
+            const auto y = _mm_set1_epi32(static_cast<int>(px));
+            for (; n + 4 <= count; n += 4) {
+                auto x = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + n * 4)), mask);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(x, y)) != 0xFFFF) {
+                    break;
+                }
+            }
+#endif
+            for (; n < count && Load(a + n * 4) == px; n++) {
+            }
+            return n;
+        }
+
+        inline unsigned char *WriteRun(unsigned char *out, uint32_t run, unsigned char op, unsigned char longop, uint32_t maxrun)
+        {
+            if (run <= maxrun) {
+                *out++ = static_cast<unsigned char>(op | (run - 1));
+                return out;
+            }
+            *out++ = longop;
+            run -= maxrun + 1;
+            while (run >= 0x80) {
+                *out++ = static_cast<unsigned char>(run | 0x80);
+                run >>= 7;
+            }
+            *out++ = static_cast<unsigned char>(run);
+            return out;
+        }
+
+        inline bool ReadVarint(const unsigned char *&in, const unsigned char *end, uint32_t &v)
+        {
+            v = 0;
+            for (auto shift = 0; shift < 35 && in < end; shift += 7) {
+                auto b = *in++;
+                v |= static_cast<uint32_t>(b & 0x7F) << shift;
+                if (!(b & 0x80)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // walks the destination (and reference) rows so ops can span rows
+        struct Cursor {
+            unsigned char *Dst;
+            int DstStride;
+            const unsigned char *Ref;
+            int RefStride;
+            int Width, Height;
+            int X = 0, Y = 0;
+
+            unsigned char *Row() const { return Dst + static_cast<size_t>(Y) * DstStride; }
+            const unsigned char *RefRow() const { return Ref + static_cast<size_t>(Y) * RefStride; }
+            void Advance(int n)
+            {
+                X += n;
+                if (X == Width) {
+                    X = 0;
+                    Y++;
+                }
+            }
+            uint64_t Remaining() const { return static_cast<uint64_t>(Height - Y) * Width - X; }
+        };
+
+        void Fill(Cursor &c, uint32_t px, uint32_t count)
+        {
+            px |= 0xFF000000;
+            while (count > 0) {
+                auto n = static_cast<int>(std::min<uint32_t>(count, static_cast<uint32_t>(c.Width - c.X)));
+                auto dst = c.Row() + c.X * 4;
+                for (auto i = 0; i < n; i++) {
+                    memcpy(dst + i * 4, &px, sizeof(px));
+                }
+                c.Advance(n);
+                count -= n;
+            }
+        }
+
+        // returns the last pixel copied, which becomes the previous pixel
+        uint32_t CopyReference(Cursor &c, uint32_t count)
+        {
+            uint32_t last = 0;
+            while (count > 0) {
+                auto n = static_cast<int>(std::min<uint32_t>(count, static_cast<uint32_t>(c.Width - c.X)));
+                auto dst = c.Row() + c.X * 4;
+                auto ref = c.RefRow() + c.X * 4;
+                if (dst != ref) {
+                    memcpy(dst, ref, static_cast<size_t>(n) * 4);
+                    for (auto i = 0; i < n; i++) {
+                        dst[i * 4 + 3] = 0xFF;
+                    }
+                }
+                last = Load(ref + (n - 1) * 4);
+                c.Advance(n);
+                count -= n;
+            }
+            return last;
+        }
+    } // namespace
+
+    size_t LosslessEncodeBound(int width, int height)
+    {
+        // a literal pixel is 4 bytes and no op costs more per pixel, the rest is the slack LosslessEncode keeps for its last ops
+        return HeaderSize + static_cast<size_t>(width) * height * 4 + MaxOpSize * 4;
+    }
+
+    size_t LosslessEncode(const Image &img, const Image *reference, unsigned char *dst, size_t dst_size)
+    {
+        const auto width = Width(img);
+        const auto height = Height(img);
+        assert(!reference || (Width(*reference) == width && Height(*reference) == height));
+        if (dst_size < HeaderSize + MaxOpSize * 4) {
+            return 0;
+        }
+        memcpy(dst, Magic, sizeof(Magic));
+        WriteU32(dst + 4, static_cast<uint32_t>(width));
+        WriteU32(dst + 8, static_cast<uint32_t>(height));
+        dst[12] = reference ? FlagReference : 0;
+
+        auto out = dst + HeaderSize;
+        // a pixel writes at most one pending run and a literal, keep room for that and the run written after the last pixel
+        const auto end = dst + dst_size - MaxOpSize * 3;
+        uint32_t cache[64] = {0};
+        uint32_t prev = 0, run = 0, refrun = 0;
+        auto flushrun = [&]() {
+            if (run) {
+                out = WriteRun(out, run, OpRun, OpLongRun, MaxRun);
+                run = 0;
+            }
+        };
+        auto flushrefrun = [&]() {
+            if (refrun) {
+                out = WriteRun(out, refrun, OpRefRun, OpLongRefRun, MaxRefRun);
+                refrun = 0;
+            }
+        };
+
+        auto row = reinterpret_cast<const unsigned char *>(StartSrc(img));
+        auto refrow = reference ? reinterpret_cast<const unsigned char *>(StartSrc(*reference)) : nullptr;
+        for (auto y = 0; y < height; y++) {
+            for (auto x = 0; x < width;) {
+                if (out > end) {
+                    return 0;
+                }
+                auto p = row + x * 4;
+                if (refrow) {
+                    auto n = MatchLength(p, refrow + x * 4, width - x);
+                    if (n > 0) {
+                        flushrun();
+                        refrun += n;
+                        x += n;
+                        prev = Load(refrow + (x - 1) * 4);
+                        continue;
+                    }
+                }
+                auto px = Load(p);
+                if (px == prev) {
+                    auto n = RepeatLength(p, px, width - x);
+                    flushrefrun();
+                    run += n;
+                    x += n;
+                    continue;
+                }
+                flushrun();
+                flushrefrun();
+                auto &cached = cache[Hash(px)];
+                if (cached == px) {
+                    *out++ = static_cast<unsigned char>(OpIndex | Hash(px));
+                }
+                else {
+                    cached = px;
+                    auto db = static_cast<int8_t>(p[0] - (prev & 0xFF));
+                    auto dg = static_cast<int8_t>(p[1] - ((prev >> 8) & 0xFF));
+                    auto dr = static_cast<int8_t>(p[2] - ((prev >> 16) & 0xFF));
+                    if (db >= -2 && db <= 1 && dg >= -2 && dg <= 1 && dr >= -2 && dr <= 1) {
+                        *out++ = static_cast<unsigned char>(OpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                    }
+                    else if (dg >= -32 && dg <= 31 && dr - dg >= -8 && dr - dg <= 7 && db - dg >= -8 && db - dg <= 7) {
+                        *out++ = static_cast<unsigned char>(OpLuma | (dg + 32));
+                        *out++ = static_cast<unsigned char>((dr - dg + 8) << 4 | (db - dg + 8));
+                    }
+                    else {
+                        *out++ = OpColor;
+                        *out++ = p[0];
+                        *out++ = p[1];
+                        *out++ = p[2];
+                    }
+                }
+                prev = px;
+                x++;
+            }
+            row += img.RowStrideInBytes;
+            if (refrow) {
+                refrow += reference->RowStrideInBytes;
+            }
+        }
+        flushrun();
+        flushrefrun();
+        return static_cast<size_t>(out - dst);
+    }
+
+    bool LosslessDecodeSize(const unsigned char *src, size_t src_size, int &width, int &height)
+    {
+        if (!src || src_size < HeaderSize || memcmp(src, Magic, sizeof(Magic)) != 0) {
+            return false;
+        }
+        auto w = ReadU32(src + 4), h = ReadU32(src + 8);
+        if (w > 0x7FFFFFFF || h > 0x7FFFFFFF) {
+            return false;
+        }
+        width = static_cast<int>(w);
+        height = static_cast<int>(h);
+        return true;
+    }
+
+    bool LosslessDecode(const unsigned char *src, size_t src_size, unsigned char *dst, int dstrowstride, const unsigned char *reference,
+                        int referencerowstride)
+    {
+        int width = 0, height = 0;
+        if (!LosslessDecodeSize(src, src_size, width, height)) {
+            return false;
+        }
+        const auto hasreference = (src[12] & FlagReference) != 0;
+        if (hasreference && !reference) {
+            return false;
+        }
+        if (width == 0 || height == 0) {
+            return true;
+        }
+
+        Cursor c{dst, dstrowstride, reference, referencerowstride, width, height};
+        auto in = src + HeaderSize;
+        const auto end = src + src_size;
+        uint32_t cache[64] = {0};
+        uint32_t prev = 0;
+        while (c.Y < height) {
+            if (in >= end) {
+                return false;
+            }
+            const auto op = *in++;
+            uint32_t px;
+            if (op < OpDiff) {
+                px = cache[op];
+            }
+            else if (op < OpLuma) {
+                auto b = ((prev & 0xFF) + (op & 3) - 2) & 0xFF;
+                auto g = (((prev >> 8) & 0xFF) + ((op >> 2) & 3) - 2) & 0xFF;
+                auto r = (((prev >> 16) & 0xFF) + ((op >> 4) & 3) - 2) & 0xFF;
+                px = b | g << 8 | r << 16;
+                cache[Hash(px)] = px;
+            }
+            else if (op < OpRun) {
+                if (in >= end) {
+                    return false;
+                }
+                const auto dg = static_cast<int>(op & 0x3F) - 32;
+                const auto drb = *in++;
+                auto b = ((prev & 0xFF) + dg + (drb & 0x0F) - 8) & 0xFF;
+                auto g = (((prev >> 8) & 0xFF) + dg) & 0xFF;
+                auto r = (((prev >> 16) & 0xFF) + dg + (drb >> 4) - 8) & 0xFF;
+                px = b | g << 8 | r << 16;
+                cache[Hash(px)] = px;
+            }
+            else if (op == OpColor) {
+                if (end - in < 3) {
+                    return false;
+                }
+                px = static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 | static_cast<uint32_t>(in[2]) << 16;
+                in += 3;
+                cache[Hash(px)] = px;
+            }
+            else if (op == 0xFF) {
+                return false;
+            }
+            else {
+                uint32_t count;
+                const auto isref = op >= OpRefRun && op != OpLongRun;
+                if (op == OpLongRun || op == OpLongRefRun) {
+                    if (!ReadVarint(in, end, count)) {
+                        return false;
+                    }
+                    count += (isref ? MaxRefRun : MaxRun) + 1;
+                }
+                else {
+                    count = (op & 0x1F) + 1;
+                }
+                if (count > c.Remaining() || (isref && !hasreference)) {
+                    return false;
+                }
+                if (isref) {
+                    prev = CopyReference(c, count);
+                }
+                else {
+                    Fill(c, prev, count);
+                }
+                continue;
+            }
+            px &= ColorMask;
+            auto out = px | 0xFF000000;
+            memcpy(c.Row() + c.X * 4, &out, sizeof(out));
+            c.Advance(1);
+            prev = px;
+        }
+        return true;
+    }
+
+} // namespace Screen_Capture
+} // namespace SL
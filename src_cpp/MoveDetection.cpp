@@ -0,0 +1,263 @@
+#include "internal/SCCommon.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace SL {
+namespace Screen_Capture {
+
+    namespace {
+        // smallest block, in rows or columns, that is reported as a move. Anything smaller is cheaper to send as pixels
+        const int MinMoveSize = 16;
+        // rows whose fingerprint shows up more often than this in the old frame are ambiguous (flat backgrounds) and do not get a vote
+        const size_t MaxCandidates = 4;
+
+        inline uint64_t Mix(uint64_t h, uint64_t v)
+        {
+            h ^= v;
+            h *= 0x9E3779B97F4A7C15ull;
+            return h ^ (h >> 32);
+        }
+
+        const unsigned char *StartOf(const Image &img, const ImageRect &region)
+        {
+            return reinterpret_cast<const unsigned char *>(StartSrc(img)) + static_cast<size_t>(region.top) * img.RowStrideInBytes +
+                   region.left * sizeof(ImageBGRA);
+        }
+
+        void HashRows(const Image &img, const ImageRect &region, std::vector<uint64_t> &hashes)
+        {
+            const auto width = Width(region);
+            hashes.resize(Height(region));
+            auto row = StartOf(img, region);
+            for (auto &hash : hashes) {
+                uint64_t h = 0;
+                auto x = 0;
+                for (; x + 2 <= width; x += 2) {
+                    uint64_t v;
+                    memcpy(&v, row + x * sizeof(ImageBGRA), sizeof(v));
+                    h = Mix(h, v);
+                }
+                if (x < width) {
+                    uint32_t v;
+                    memcpy(&v, row + x * sizeof(ImageBGRA), sizeof(v));
+                    h = Mix(h, v);
+                }
+                hash = h;
+                row += img.RowStrideInBytes;
+            }
+        }
+
+        // walks the region row by row so the memory access stays sequential
+        void HashColumns(const Image &img, const ImageRect &region, std::vector<uint64_t> &hashes)
+        {
+            const auto width = Width(region);
+            hashes.assign(width, 0);
+            auto row = StartOf(img, region);
+            for (auto y = 0; y < Height(region); y++) {
+                for (auto x = 0; x < width; x++) {
+                    uint32_t v;
+                    memcpy(&v, row + x * sizeof(ImageBGRA), sizeof(v));
+                    hashes[x] = Mix(hashes[x], v);
+                }
+                row += img.RowStrideInBytes;
+            }
+        }
+
+        // Finds the offset that maps the most lines of the old frame onto the new frame, then the longest run of lines that match at that
+        // offset. Lines are rows or columns depending on how the fingerprints were built.
+        bool FindShift(const std::vector<uint64_t> &oldhashes, const std::vector<uint64_t> &newhashes, DiffScratch &scratch, int &shift, int &start,
+                       int &length)
+        {
+            const auto count = static_cast<int>(newhashes.size());
+            auto &sorted = scratch.SortedHashes;
+            sorted.clear();
+            for (auto i = 0; i < count; i++) {
+                sorted.emplace_back(oldhashes[i], i);
+            }
+            std::sort(sorted.begin(), sorted.end());
+
+            auto &votes = scratch.Votes;
+            votes.assign(count * 2 + 1, 0);
+            for (auto i = 0; i < count; i++) {
+                if (i > 0 && newhashes[i] == newhashes[i - 1]) {
+                    continue; // flat areas match everywhere, they say nothing about the movement
+                }
+                auto range = std::equal_range(sorted.begin(), sorted.end(), std::make_pair(newhashes[i], 0),
+                                              [](const std::pair<uint64_t, int> &a, const std::pair<uint64_t, int> &b) { return a.first < b.first; });
+                if (range.first == range.second || static_cast<size_t>(range.second - range.first) > MaxCandidates) {
+                    continue;
+                }
+                for (auto it = range.first; it != range.second; ++it) {
+                    if (it->second != i) {
+                        votes[i - it->second + count] += 1;
+                    }
+                }
+            }
+            auto best = std::max_element(votes.begin(), votes.end());
+            if (*best < MinMoveSize / 2) {
+                return false;
+            }
+            shift = static_cast<int>(best - votes.begin()) - count;
+
+            length = 0;
+            auto runstart = 0, runlength = 0;
+            for (auto i = std::max(0, shift); i < std::min(count, count + shift); i++) {
+                if (newhashes[i] == oldhashes[i - shift]) {
+                    if (runlength++ == 0) {
+                        runstart = i;
+                    }
+                    if (runlength > length) {
+                        length = runlength;
+                        start = runstart;
+                    }
+                }
+                else {
+                    runlength = 0;
+                }
+            }
+            return length >= MinMoveSize;
+        }
+
+        // The difs are tile aligned and usually include static content around the change (sidebars, headers). Static content that is not
+        // uniform would break the fingerprints, so shrink region to the pixels that really changed.
+        ImageRect ChangedBounds(const Image &oldimg, const Image &newimg, const ImageRect &region)
+        {
+            ImageRect ret(region.right, region.bottom, region.left, region.top);
+            auto oldrow = reinterpret_cast<const ImageBGRA *>(StartOf(oldimg, region));
+            auto newrow = reinterpret_cast<const ImageBGRA *>(StartOf(newimg, region));
+            const auto width = Width(region);
+            for (auto y = region.top; y < region.bottom; y++) {
+                auto same = [&](int x) { return memcmp(oldrow + x, newrow + x, sizeof(ImageBGRA)) == 0; };
+                auto left = 0;
+                while (left < width && same(left)) {
+                    left++;
+                }
+                if (left < width) {
+                    auto right = width;
+                    while (right > left + 1 && right + region.left > ret.right && same(right - 1)) {
+                        right--;
+                    }
+                    ret.left = std::min(ret.left, region.left + left);
+                    ret.right = std::max(ret.right, region.left + right);
+                    ret.top = std::min(ret.top, y);
+                    ret.bottom = y + 1;
+                }
+                oldrow = GotoNextRow(oldimg, oldrow);
+                newrow = GotoNextRow(newimg, newrow);
+            }
+            return ret;
+        }
+
+        // the fingerprints only point at a candidate, make sure the pixels really are the same
+        bool IsMoveExact(const Image &oldimg, const Image &newimg, const ImageMove &move)
+        {
+            auto src = StartOf(oldimg, move.Source);
+            auto dst = StartOf(newimg, ImageRect(move.Destination.x, move.Destination.y, move.Destination.x + Width(move.Source),
+                                                 move.Destination.y + Height(move.Source)));
+            const auto rowbytes = Width(move.Source) * sizeof(ImageBGRA);
+            for (auto y = 0; y < Height(move.Source); y++) {
+                if (memcmp(src, dst, rowbytes) != 0) {
+                    return false;
+                }
+                src += oldimg.RowStrideInBytes;
+                dst += newimg.RowStrideInBytes;
+            }
+            return true;
+        }
+
+        // the pixels of ignored rects never went out, a move must neither take them along nor cover them
+        bool TouchesIgnored(const ImageMove &move, const std::vector<ImageRect> &ignore)
+        {
+            const ImageRect destination(move.Destination.x, move.Destination.y, move.Destination.x + Width(move.Source),
+                                        move.Destination.y + Height(move.Source));
+            for (auto &r : ignore) {
+                for (auto &m : {move.Source, destination}) {
+                    if (r.left < m.right && m.left < r.right && r.top < m.bottom && m.top < r.bottom) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+    } // namespace
+
+    bool DetectMove(const Image &oldimg, const Image &newimg, const std::vector<ImageRect> &difs, ImageMove &move)
+    {
+        DiffScratch scratch;
+        return DetectMove(oldimg, newimg, difs, {}, move, scratch);
+    }
+
+    bool DetectMove(const Image &oldimg, const Image &newimg, const std::vector<ImageRect> &difs, const std::vector<ImageRect> &ignore,
+                    ImageMove &move, DiffScratch &scratch)
+    {
+        if (difs.empty()) {
+            return false;
+        }
+        // only the area that changed can contain a move
+        ImageRect region = difs.front();
+        for (auto &r : difs) {
+            region.left = std::min(region.left, r.left);
+            region.top = std::min(region.top, r.top);
+            region.right = std::max(region.right, r.right);
+            region.bottom = std::max(region.bottom, r.bottom);
+        }
+        if (Width(region) < MinMoveSize || Height(region) < MinMoveSize) {
+            return false;
+        }
+        region = ChangedBounds(oldimg, newimg, region);
+        if (Width(region) < MinMoveSize || Height(region) < MinMoveSize) {
+            return false;
+        }
+
+        auto &oldhashes = scratch.OldHashes;
+        auto &newhashes = scratch.NewHashes;
+        int shift = 0, start = 0, length = 0;
+
+        // vertical scrolling is by far the most common, try it first
+        HashRows(oldimg, region, oldhashes);
+        HashRows(newimg, region, newhashes);
+        if (FindShift(oldhashes, newhashes, scratch, shift, start, length)) {
+            move.Source = ImageRect(region.left, region.top + start - shift, region.right, region.top + start - shift + length);
+            move.Destination = Point{region.left, region.top + start};
+            if (!TouchesIgnored(move, ignore) && IsMoveExact(oldimg, newimg, move)) {
+                return true;
+            }
+        }
+
+        HashColumns(oldimg, region, oldhashes);
+        HashColumns(newimg, region, newhashes);
+        if (FindShift(oldhashes, newhashes, scratch, shift, start, length)) {
+            move.Source = ImageRect(region.left + start - shift, region.top, region.left + start - shift + length, region.bottom);
+            move.Destination = Point{region.left + start, region.top};
+            if (!TouchesIgnored(move, ignore) && IsMoveExact(oldimg, newimg, move)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ApplyMove(unsigned char *img, int rowstride, const ImageMove &move)
+    {
+        const auto rowbytes = Width(move.Source) * sizeof(ImageBGRA);
+        auto copyrow = [&](int y) {
+            memmove(img + static_cast<size_t>(move.Destination.y + y) * rowstride + move.Destination.x * sizeof(ImageBGRA),
+                    img + static_cast<size_t>(move.Source.top + y) * rowstride + move.Source.left * sizeof(ImageBGRA), rowbytes);
+        };
+        // rows are copied in the direction that never reads a row that was already overwritten
+        if (move.Destination.y > move.Source.top) {
+            for (auto y = Height(move.Source) - 1; y >= 0; y--) {
+                copyrow(y);
+            }
+        }
+        else {
+            for (auto y = 0; y < Height(move.Source); y++) {
+                copyrow(y);
+            }
+        }
+    }
+
+} // namespace Screen_Capture
+} // namespace SL
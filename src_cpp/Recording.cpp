@@ -0,0 +1,540 @@
+#include "ScreenCapture_Recording.h"
+#include "ScreenCapture_Encode.h"
+#include "internal/SCCommon.h"
+#include "internal/ThreadManager.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SL {
+namespace Screen_Capture {
+
+    namespace {
+        // Layout, all little endian:
+        //   FileHeader
+        //   records: RecordHeader, then RectCount times a RectHeader followed by its LosslessEncode output
+        //   the seek index: Footer.IndexCount IndexEntry, then the Footer. Missing if the recorder did not shut down cleanly
+        const uint32_t FileMagic = 0x524C4353;   // "SCLR"
+        const uint32_t RecordMagic = 0x4D524653; // "SFRM"
+        const uint32_t FooterMagic = 0x494C4353; // "SCLI"
+        const uint32_t FileVersion = 1;
+        const uint32_t FlagKeyframe = 1;
+        // records are collected in a buffer this large before they go to the file, so the disk only sees large sequential writes
+        const size_t WriteBufferSize = 4 * 1024 * 1024;
+
+        struct FileHeader {
+            uint32_t Magic;
+            uint32_t Version;
+            uint64_t Reserved;
+        };
+        struct RecordHeader {
+            uint32_t Magic;
+            uint32_t Flags;
+            uint64_t PayloadSize;
+            int64_t Timestamp; // microseconds since the recording started
+            int64_t Source;
+            int32_t Width;
+            int32_t Height;
+            uint32_t RectCount;
+            uint32_t Reserved;
+        };
+        struct RectHeader {
+            int32_t Left, Top, Right, Bottom;
+            uint64_t EncodedSize;
+        };
+        struct IndexEntry {
+            int64_t Timestamp;
+            int64_t Source;
+            uint64_t Offset; // of the RecordHeader of a keyframe
+        };
+        struct Footer {
+            uint64_t IndexOffset;
+            uint32_t IndexCount;
+            uint32_t Magic;
+        };
+
+        class FrameRecorder : public IFramePublisher {
+            struct SourceState {
+                int Width = 0;
+                int Height = 0;
+                std::vector<unsigned char> Last; // the frame as the reader will have rebuilt it, contiguous
+                std::chrono::steady_clock::time_point LastKeyframe;
+                int64_t LastTimestamp = -1;
+            };
+
+            std::string Path;
+            FILE *File = nullptr;
+            std::vector<char> Buffer;
+            std::mutex Lock;
+            std::chrono::steady_clock::time_point Start;
+            std::chrono::steady_clock::duration KeyframeInterval;
+            std::map<int64_t, SourceState> Sources;
+            std::vector<IndexEntry> Index;
+            uint64_t Offset = 0;
+            std::vector<ImageRect> Rects;
+            std::vector<unsigned char> Payload;
+
+            void Write(const void *data, size_t size)
+            {
+                fwrite(data, 1, size, File);
+                Offset += size;
+            }
+
+          public:
+            ~FrameRecorder()
+            {
+                if (File) {
+                    Footer footer{Offset, static_cast<uint32_t>(Index.size()), FooterMagic};
+                    if (!Index.empty()) {
+                        Write(Index.data(), Index.size() * sizeof(IndexEntry));
+                    }
+                    Write(&footer, sizeof(footer));
+                    fclose(File);
+                }
+            }
+
+            bool Init(const std::string &path, std::chrono::seconds keyframeinterval)
+            {
+                Path = path;
+                KeyframeInterval = keyframeinterval;
+                File = fopen(path.c_str(), "wb");
+                if (!File) {
+                    return false;
+                }
+                Buffer.resize(WriteBufferSize);
+                setvbuf(File, Buffer.data(), _IOFBF, Buffer.size());
+                Start = std::chrono::steady_clock::now();
+                FileHeader header{FileMagic, FileVersion, 0};
+                Write(&header, sizeof(header));
+                return true;
+            }
+
+            virtual bool publish(const Image &frame, const ImageRect *dirtyrects, size_t dirtycount, long long source, const char *) override
+            {
+                const auto now = std::chrono::steady_clock::now();
+                const auto width = Width(frame);
+                const auto height = Height(frame);
+                const auto rowbytes = width * static_cast<int>(sizeof(ImageBGRA));
+                const ImageRect whole(0, 0, width, height);
+                // frames are published by the capture thread of each source
+                std::lock_guard<std::mutex> lock(Lock);
+                auto &state = Sources[source];
+                auto keyframe = state.Last.empty() || state.Width != width || state.Height != height;
+                Rects.clear();
+                if (!keyframe) {
+                    auto last = CreateImage(whole, rowbytes, reinterpret_cast<const ImageBGRA *>(state.Last.data()));
+                    if (dirtycount == 1 && dirtyrects[0] == whole) {
+                        // nobody computed difs for this frame, do it here so idle ticks cost nothing. Alpha is not stored, so it is not
+                        // compared either
+                        DiffTolerance tolerance;
+                        tolerance.IgnoreAlpha = true;
+                        Rects = GetDifs(last, frame, {}, tolerance);
+                    }
+                    else {
+                        Rects.assign(dirtyrects, dirtyrects + dirtycount);
+                    }
+                    if (Rects.empty()) {
+                        return true;
+                    }
+                    keyframe = now - state.LastKeyframe >= KeyframeInterval;
+                }
+                if (keyframe) {
+                    Rects.assign(1, whole);
+                    state.Width = width;
+                    state.Height = height;
+                    state.Last.resize(static_cast<size_t>(rowbytes) * height);
+                    state.LastKeyframe = now;
+                }
+
+                Payload.clear();
+                for (auto &r : Rects) {
+                    RectHeader recthdr{r.left, r.top, r.right, r.bottom, 0};
+                    auto start = Payload.size();
+                    Payload.resize(start + sizeof(RectHeader) + LosslessEncodeBound(Width(r), Height(r)));
+                    auto src = reinterpret_cast<const ImageBGRA *>(reinterpret_cast<const unsigned char *>(StartSrc(frame)) +
+                                                                   static_cast<size_t>(r.top) * frame.RowStrideInBytes + r.left * sizeof(ImageBGRA));
+                    auto rectimg = CreateImage(r, frame.RowStrideInBytes, src);
+                    auto lastpixels = state.Last.data() + static_cast<size_t>(r.top) * rowbytes + r.left * sizeof(ImageBGRA);
+                    auto reference = CreateImage(r, rowbytes, reinterpret_cast<const ImageBGRA *>(lastpixels));
+                    recthdr.EncodedSize = LosslessEncode(rectimg, keyframe ? nullptr : &reference, Payload.data() + start + sizeof(RectHeader),
+                                                         Payload.size() - start - sizeof(RectHeader));
+                    memcpy(Payload.data() + start, &recthdr, sizeof(recthdr));
+                    Payload.resize(start + sizeof(RectHeader) + recthdr.EncodedSize);
+                    // keep the frame as the reader sees it, alpha is not stored
+                    for (auto y = 0; y < Height(r); y++) {
+                        auto dst = lastpixels + static_cast<size_t>(y) * rowbytes;
+                        memcpy(dst, reinterpret_cast<const unsigned char *>(src) + static_cast<size_t>(y) * frame.RowStrideInBytes,
+                               Width(r) * sizeof(ImageBGRA));
+                        for (auto x = 0; x < Width(r); x++) {
+                            dst[x * sizeof(ImageBGRA) + 3] = 0xFF;
+                        }
+                    }
+                }
+
+                // frames are found by their timestamp, two in the same microsecond would hide one of them
+                const auto timestamp = std::max(std::chrono::duration_cast<std::chrono::microseconds>(now - Start).count(), state.LastTimestamp + 1);
+                state.LastTimestamp = timestamp;
+                if (keyframe) {
+                    Index.push_back(IndexEntry{timestamp, source, Offset});
+                }
+                RecordHeader header{RecordMagic, keyframe ? FlagKeyframe : 0, Payload.size(), timestamp, source, width, height,
+                                    static_cast<uint32_t>(Rects.size()), 0};
+                Write(&header, sizeof(header));
+                Write(Payload.data(), Payload.size());
+                return ferror(File) == 0;
+            }
+
+            virtual const std::string &path() const override { return Path; }
+        };
+
+        class RecordingReader : public IRecordingReader {
+            const unsigned char *Data = nullptr;
+            size_t Size = 0;
+            // where the records end, the start of the index if there is one
+            size_t End = 0;
+            std::vector<IndexEntry> Keyframes; // sorted by Source then Timestamp
+            std::vector<long long> SourceIds;
+            int64_t Duration = 0;
+#if defined(_WIN32)
+            HANDLE FileHandle = INVALID_HANDLE_VALUE;
+            HANDLE MappingHandle = nullptr;
+#endif
+
+            // the state of the last frameAt
+            long long CurrentSource = 0;
+            uint64_t CurrentKeyframe = 0;
+            uint64_t CurrentNext = 0; // the record after the last one applied
+            int64_t CurrentTimestamp = -1;
+            int CurrentWidth = 0, CurrentHeight = 0;
+            std::vector<unsigned char> Frame;
+
+            bool ReadRecord(uint64_t offset, RecordHeader &header) const
+            {
+                if (offset + sizeof(RecordHeader) > End) {
+                    return false;
+                }
+                memcpy(&header, Data + offset, sizeof(header));
+                return header.Magic == RecordMagic && header.PayloadSize <= End - offset - sizeof(RecordHeader);
+            }
+
+            bool Apply(uint64_t offset, const RecordHeader &header)
+            {
+                if (header.Flags & FlagKeyframe) {
+                    CurrentWidth = header.Width;
+                    CurrentHeight = header.Height;
+                    Frame.assign(static_cast<size_t>(CurrentWidth) * CurrentHeight * sizeof(ImageBGRA), 0);
+                }
+                else if (header.Width != CurrentWidth || header.Height != CurrentHeight) {
+                    return false;
+                }
+                const auto rowbytes = CurrentWidth * static_cast<int>(sizeof(ImageBGRA));
+                auto p = Data + offset + sizeof(RecordHeader);
+                auto payloadend = p + header.PayloadSize;
+                for (uint32_t i = 0; i < header.RectCount; i++) {
+                    RectHeader r;
+                    if (static_cast<size_t>(payloadend - p) < sizeof(r)) {
+                        return false;
+                    }
+                    memcpy(&r, p, sizeof(r));
+                    p += sizeof(r);
+                    int w = 0, h = 0;
+                    if (r.EncodedSize > static_cast<uint64_t>(payloadend - p) || r.Left < 0 || r.Top < 0 || r.Right > CurrentWidth ||
+                        r.Bottom > CurrentHeight || !LosslessDecodeSize(p, static_cast<size_t>(r.EncodedSize), w, h) || w != r.Right - r.Left ||
+                        h != r.Bottom - r.Top) {
+                        return false;
+                    }
+                    // the rect is decoded on top of the frame it was coded against
+                    auto dst = Frame.data() + static_cast<size_t>(r.Top) * rowbytes + r.Left * sizeof(ImageBGRA);
+                    if (!LosslessDecode(p, static_cast<size_t>(r.EncodedSize), dst, rowbytes, dst, rowbytes)) {
+                        return false;
+                    }
+                    p += r.EncodedSize;
+                }
+                return true;
+            }
+
+            // the last keyframe of source at or before t, or the first one of source if there is none
+            std::vector<IndexEntry>::const_iterator FindKeyframe(long long source, int64_t t) const
+            {
+                auto it = std::upper_bound(Keyframes.begin(), Keyframes.end(), IndexEntry{t, source, 0}, [](const IndexEntry &a, const IndexEntry &b) {
+                    return a.Source < b.Source || (a.Source == b.Source && a.Timestamp < b.Timestamp);
+                });
+                if (it != Keyframes.begin() && (it - 1)->Source == source) {
+                    return it - 1;
+                }
+                return it != Keyframes.end() && it->Source == source ? it : Keyframes.end();
+            }
+
+          public:
+            ~RecordingReader()
+            {
+#if defined(_WIN32)
+                if (Data) {
+                    UnmapViewOfFile(Data);
+                }
+                if (MappingHandle) {
+                    CloseHandle(MappingHandle);
+                }
+                if (FileHandle != INVALID_HANDLE_VALUE) {
+                    CloseHandle(FileHandle);
+                }
+#else
+                if (Data) {
+                    munmap(const_cast<unsigned char *>(Data), Size);
+                }
+#endif
+            }
+
+            bool Init(const std::string &path)
+            {
+#if defined(_WIN32)
+                FileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+                LARGE_INTEGER filesize;
+                if (FileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(FileHandle, &filesize) || filesize.QuadPart < sizeof(FileHeader)) {
+                    return false;
+                }
+                MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (!MappingHandle) {
+                    return false;
+                }
+                Size = static_cast<size_t>(filesize.QuadPart);
+                Data = static_cast<const unsigned char *>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0));
+                if (!Data) {
+                    return false;
+                }
+#else
+                auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) {
+                    return false;
+                }
+                struct stat st;
+                if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+                    close(fd);
+                    return false;
+                }
+                Size = static_cast<size_t>(st.st_size);
+                auto mapping = mmap(nullptr, Size, PROT_READ, MAP_SHARED, fd, 0);
+                close(fd);
+                if (mapping == MAP_FAILED) {
+                    return false;
+                }
+                Data = static_cast<const unsigned char *>(mapping);
+#endif
+                FileHeader header;
+                memcpy(&header, Data, sizeof(header));
+                if (header.Magic != FileMagic || header.Version != FileVersion) {
+                    return false;
+                }
+
+                Footer footer = {};
+                if (Size >= sizeof(FileHeader) + sizeof(Footer)) {
+                    memcpy(&footer, Data + Size - sizeof(Footer), sizeof(footer));
+                }
+                if (footer.Magic == FooterMagic && footer.IndexOffset >= sizeof(FileHeader) &&
+                    footer.IndexOffset + static_cast<uint64_t>(footer.IndexCount) * sizeof(IndexEntry) + sizeof(Footer) == Size) {
+                    End = static_cast<size_t>(footer.IndexOffset);
+                    Keyframes.resize(footer.IndexCount);
+                    if (footer.IndexCount) {
+                        memcpy(Keyframes.data(), Data + End, Keyframes.size() * sizeof(IndexEntry));
+                    }
+                    // the records are only walked from a keyframe on, the last one is needed for the duration
+                    RecordHeader record;
+                    for (uint64_t offset = Keyframes.empty() ? sizeof(FileHeader) : Keyframes.back().Offset; ReadRecord(offset, record);
+                         offset += sizeof(RecordHeader) + record.PayloadSize) {
+                        Duration = std::max(Duration, record.Timestamp);
+                    }
+                }
+                else {
+                    // the recorder did not finish, rebuild the index from the records that made it to disk
+                    End = Size;
+                    RecordHeader record;
+                    uint64_t offset = sizeof(FileHeader);
+                    for (; ReadRecord(offset, record); offset += sizeof(RecordHeader) + record.PayloadSize) {
+                        if (record.Flags & FlagKeyframe) {
+                            Keyframes.push_back(IndexEntry{record.Timestamp, record.Source, offset});
+                        }
+                        Duration = std::max(Duration, record.Timestamp);
+                    }
+                    End = static_cast<size_t>(offset);
+                }
+                std::stable_sort(Keyframes.begin(), Keyframes.end(), [](const IndexEntry &a, const IndexEntry &b) {
+                    return a.Source < b.Source || (a.Source == b.Source && a.Timestamp < b.Timestamp);
+                });
+                for (auto &k : Keyframes) {
+                    if (SourceIds.empty() || SourceIds.back() != k.Source) {
+                        SourceIds.push_back(k.Source);
+                    }
+                }
+                return true;
+            }
+
+            virtual std::vector<long long> sources() const override { return SourceIds; }
+
+            virtual std::chrono::microseconds duration() const override { return std::chrono::microseconds(Duration); }
+
+            virtual bool frameAt(long long source, std::chrono::microseconds timestamp, Image &img) override
+            {
+                const auto t = static_cast<int64_t>(timestamp.count());
+                auto it = FindKeyframe(source, t);
+                if (it == Keyframes.end() || it->Timestamp > t) {
+                    return false;
+                }
+                // keep going from the last call when playing forward
+                if (CurrentTimestamp < 0 || CurrentSource != source || CurrentKeyframe != it->Offset || CurrentTimestamp > t) {
+                    CurrentSource = source;
+                    CurrentKeyframe = it->Offset;
+                    CurrentNext = it->Offset;
+                    CurrentTimestamp = -1;
+                }
+                RecordHeader record;
+                for (; ReadRecord(CurrentNext, record) && record.Timestamp <= t; CurrentNext += sizeof(RecordHeader) + record.PayloadSize) {
+                    if (record.Source != source) {
+                        continue;
+                    }
+                    if ((record.Flags & FlagKeyframe) && CurrentNext != CurrentKeyframe) {
+                        break; // the next keyframe starts after t, it was not found above
+                    }
+                    if (!Apply(CurrentNext, record)) {
+                        CurrentTimestamp = -1;
+                        return false;
+                    }
+                    CurrentTimestamp = record.Timestamp;
+                }
+                if (CurrentTimestamp < 0) {
+                    return false;
+                }
+                const ImageRect rect(0, 0, CurrentWidth, CurrentHeight);
+                img = CreateImage(rect, CurrentWidth * static_cast<int>(sizeof(ImageBGRA)), reinterpret_cast<const ImageBGRA *>(Frame.data()));
+                return true;
+            }
+
+            virtual bool nextFrame(long long source, std::chrono::microseconds after, std::chrono::microseconds &timestamp) override
+            {
+                const auto t = static_cast<int64_t>(after.count());
+                auto it = FindKeyframe(source, t);
+                if (it == Keyframes.end()) {
+                    return false;
+                }
+                // playing forward the last frameAt already walked up to t
+                auto offset = it->Offset;
+                if (CurrentTimestamp >= 0 && CurrentSource == source && CurrentKeyframe == it->Offset && CurrentTimestamp <= t) {
+                    offset = CurrentNext;
+                }
+                RecordHeader record;
+                for (; ReadRecord(offset, record); offset += sizeof(RecordHeader) + record.PayloadSize) {
+                    if (record.Source == source && record.Timestamp > t) {
+                        timestamp = std::chrono::microseconds(record.Timestamp);
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+    } // namespace
+
+    std::shared_ptr<IFramePublisher> CreateFrameRecorder(const std::string &path, std::chrono::seconds keyframeinterval)
+    {
+        auto recorder = std::make_shared<FrameRecorder>();
+        if (recorder->Init(path, keyframeinterval)) {
+            return recorder;
+        }
+        return std::shared_ptr<IFramePublisher>();
+    }
+
+    std::shared_ptr<IRecordingReader> OpenRecording(const std::string &path)
+    {
+        auto reader = std::make_shared<RecordingReader>();
+        if (reader->Init(path)) {
+            return reader;
+        }
+        return std::shared_ptr<IRecordingReader>();
+    }
+
+    std::vector<Monitor> GetRecordedMonitors(const std::string &path)
+    {
+        std::vector<Monitor> monitors;
+        auto reader = OpenRecording(path);
+        if (!reader) {
+            return monitors;
+        }
+        for (auto source : reader->sources()) {
+            std::chrono::microseconds first;
+            Image img;
+            if (reader->nextFrame(source, std::chrono::microseconds(-1), first) && reader->frameAt(source, first, img)) {
+                monitors.push_back(CreateMonitor(static_cast<int>(monitors.size()), static_cast<int>(source), Height(img), Width(img), 0, 0,
+                                                 "Recording " + std::to_string(source), 1.0f));
+            }
+        }
+        return monitors;
+    }
+
+    void RunReplayMonitor(std::shared_ptr<Thread_Data> data, Monitor monitor)
+    {
+        // each thread has its own reader, they keep the frame they rebuilt
+        auto reader = OpenRecording(data->Replay.Path);
+        if (!reader) {
+            data->CommonData_.UnexpectedErrorEvent = true;
+            return;
+        }
+        BaseFrameProcessor base;
+        base.Data = data;
+        const auto speed = data->Replay.Speed;
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::microseconds timestamp(-1), first(-1);
+        Image img;
+        while (!data->CommonData_.TerminateThreadsEvent && reader->nextFrame(Id(monitor), timestamp, timestamp)) {
+            if (first.count() < 0) {
+                first = timestamp;
+            }
+            if (speed > 0) {
+                const auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>((timestamp - first) / speed);
+                // the recording can be idle for minutes, stay responsive to a stop
+                while (!data->CommonData_.TerminateThreadsEvent && std::chrono::steady_clock::now() < due) {
+                    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(due - std::chrono::steady_clock::now(), 50ms));
+                }
+            }
+            if (!reader->frameAt(Id(monitor), timestamp, img)) {
+                data->CommonData_.UnexpectedErrorEvent = true;
+                return;
+            }
+            if (Width(img) != Width(monitor) || Height(img) != Height(monitor)) {
+                // the source was resized while it was recorded, the next difs are against nothing
+                monitor.Width = monitor.OriginalWidth = Width(img);
+                monitor.Height = monitor.OriginalHeight = Height(img);
+                base.FirstRun = true;
+            }
+            const auto buffersize = Width(monitor) * Height(monitor) * static_cast<int>(sizeof(ImageBGRA));
+            if (KeepsLastFrame(data->ScreenCaptureData) && base.ImageBufferSize != buffersize) {
+                base.ImageBufferSize = buffersize;
+                base.ImageBuffer = std::make_unique<unsigned char[]>(base.ImageBufferSize);
+            }
+            ProcessCapture(data->ScreenCaptureData, base, monitor, reinterpret_cast<const unsigned char *>(StartSrc(img)), img.RowStrideInBytes);
+
+            if (data->CommonData_.Paused) {
+                // the time spent paused is not part of the recording
+                const auto pausedat = std::chrono::steady_clock::now();
+                while (data->CommonData_.Paused && !data->CommonData_.TerminateThreadsEvent) {
+                    std::this_thread::sleep_for(50ms);
+                }
+                start += std::chrono::steady_clock::now() - pausedat;
+            }
+        }
+    }
+
+} // namespace Screen_Capture
+} // namespace SL
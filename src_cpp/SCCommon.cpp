@@ -6,6 +6,15 @@
 #include <cstring>
 #include <iostream>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCL_DIFF_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
 namespace SL {
 namespace Screen_Capture {
 
@@ -21,12 +30,16 @@ namespace Screen_Capture {
         }
     }
 
+    // the bits live in blocks, which keeps its memory for the next BitMap
     template <typename Block> class BitMap {
         static_assert(std::is_unsigned<Block>::value);
         static const size_t BitsPerBlock = sizeof(Block) * 8;
 
       public:
-        BitMap(size_t height, size_t width) : Width(width), Height(height), Blocks((width * height) / BitsPerBlock + 1, 0) {}
+        BitMap(std::vector<Block> &blocks, size_t height, size_t width) : Width(width), Height(height), Blocks(blocks)
+        {
+            Blocks.assign((width * height) / BitsPerBlock + 1, 0);
+        }
 
         bool get(size_t x, size_t y) const
         {
@@ -53,17 +66,22 @@ namespace Screen_Capture {
       private:
         size_t Width;
         size_t Height;
-        std::vector<Block> Blocks;
+        std::vector<Block> &Blocks;
     };
 
-    static void merge(std::vector<ImageRect> &rects)
+    void merge(std::vector<ImageRect> &rects)
+    {
+        std::vector<ImageRect> outrects;
+        merge(rects, outrects);
+    }
+
+    void merge(std::vector<ImageRect> &rects, std::vector<ImageRect> &outrects)
     {
         if (rects.size() <= 2) {
             return; // make sure there is at least 2
         }
 
-        std::vector<ImageRect> outrects;
-        outrects.reserve(rects.size());
+        outrects.clear();
         outrects.push_back(rects[0]);
 
         // horizontal scan
@@ -77,7 +95,7 @@ namespace Screen_Capture {
         }
 
         if (outrects.size() <= 2) {
-            rects = std::move(outrects);
+            rects.swap(outrects);
             return; // make sure there is at least 2
         }
 
@@ -99,78 +117,329 @@ namespace Screen_Capture {
 
 #define maxdist 256
 
-    static std::vector<ImageRect> GetRects(const BitMap<uint64_t> &map)
+    static void GetRects(const BitMap<uint64_t> &map, int blocksize, std::vector<ImageRect> &rects)
     {
-        std::vector<ImageRect> rects;
-        rects.reserve(map.width() * map.height());
+        rects.clear();
 
         for (decltype(map.height()) x = 0; x < map.height(); ++x) {
             for (decltype(map.width()) y = 0; y < map.width(); ++y) {
                 if (map.get(x, y)) {
                     ImageRect rect;
 
-                    rect.top = static_cast<decltype(rect.top)>(x * maxdist);
-                    rect.bottom = static_cast<decltype(rect.bottom)>((x + 1) * maxdist);
+                    rect.top = static_cast<decltype(rect.top)>(x * blocksize);
+                    rect.bottom = static_cast<decltype(rect.bottom)>((x + 1) * blocksize);
 
-                    rect.left = static_cast<decltype(rect.left)>(y * maxdist);
-                    rect.right = static_cast<decltype(rect.right)>((y + 1) * maxdist);
+                    rect.left = static_cast<decltype(rect.left)>(y * blocksize);
+                    rect.right = static_cast<decltype(rect.right)>((y + 1) * blocksize);
 
                     rects.push_back(rect);
                 }
             }
         }
+    }
 
-        return rects;
+    static void GetRowBands(int width, int height, const std::vector<ImageRect> &ignore, DiffScratch &scratch)
+    {
+        // the spans only change where an ignore rect starts or ends
+        auto &edges = scratch.Edges;
+        edges.assign(1, height);
+        for (auto &r : ignore) {
+            for (auto edge : {r.top, r.bottom}) {
+                if (edge > 0 && edge < height) {
+                    edges.push_back(edge);
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        auto &covered = scratch.Covered;
+        scratch.Bands.clear();
+        scratch.Spans.clear();
+        auto top = 0;
+        for (auto bottom : edges) {
+            covered.clear();
+            for (auto &r : ignore) {
+                auto left = std::max(r.left, 0), right = std::min(r.right, width);
+                if (r.top <= top && r.bottom >= bottom && left < right) {
+                    covered.emplace_back(left, right);
+                }
+            }
+            std::sort(covered.begin(), covered.end());
+            RowBand band{bottom, scratch.Spans.size(), 0};
+            auto x = 0;
+            for (auto &c : covered) {
+                if (c.first > x) {
+                    scratch.Spans.emplace_back(x, c.first);
+                }
+                x = std::max(x, c.second);
+            }
+            if (x < width) {
+                scratch.Spans.emplace_back(x, width);
+            }
+            band.EndSpan = scratch.Spans.size();
+            scratch.Bands.push_back(band);
+            top = bottom;
+        }
+    }
+
+    // the number of the npixels pixels at oldpx and newpx with a channel that differs by more than its threshold. The thresholds are
+    // packed like the pixels
+    static int CountChangedPixels(const unsigned char *oldpx, const unsigned char *newpx, int npixels, uint32_t thresholds)
+    {
+        auto count = 0;
+        auto i = 0;
+#if SCL_DIFF_SSE2
+        const auto threshold = _mm_set1_epi32(static_cast<int>(thresholds));
+        const auto zero = _mm_setzero_si128();
+        // counts the unchanged pixels of each lane, an unchanged pixel compares to -1
+        auto unchangedcount = _mm_setzero_si128();
+        const auto unchanged = [&](int at) {
+            const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(oldpx + at * 4));
+            const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(newpx + at * 4));
+            const auto absdiff = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+            // the channels above their threshold are the ones left over, a pixel is unchanged if nothing is left of it
+            return _mm_cmpeq_epi32(_mm_subs_epu8(absdiff, threshold), zero);
+        };
+        // two blocks at a time keep more loads in flight
+        auto unchangedcount2 = _mm_setzero_si128();
+        for (; i + 8 <= npixels; i += 8) {
+            unchangedcount = _mm_sub_epi32(unchangedcount, unchanged(i));
+            unchangedcount2 = _mm_sub_epi32(unchangedcount2, unchanged(i + 4));
+        }
+        for (; i + 4 <= npixels; i += 4) {
+            unchangedcount = _mm_sub_epi32(unchangedcount, unchanged(i));
+        }
+        unchangedcount = _mm_add_epi32(unchangedcount, unchangedcount2);
+        unchangedcount = _mm_add_epi32(unchangedcount, _mm_shuffle_epi32(unchangedcount, _MM_SHUFFLE(1, 0, 3, 2)));
+        unchangedcount = _mm_add_epi32(unchangedcount, _mm_shuffle_epi32(unchangedcount, _MM_SHUFFLE(2, 3, 0, 1)));
+        count = i - _mm_cvtsi128_si32(unchangedcount);
+#endif
+        for (; i < npixels; i++) {
+            for (auto c = 0; c < 4; c++) {
+                const auto a = oldpx[i * 4 + c], b = newpx[i * 4 + c];
+                if ((a > b ? a - b : b - a) > static_cast<int>((thresholds >> (c * 8)) & 0xff)) {
+                    count++;
+                    break;
+                }
+            }
+        }
+        return count;
+    }
+
+    // what a pass of GetDifs compares and where it marks the blocks that changed
+    struct DiffPass {
+        ImageRect Area;
+        int BlockSize;
+        int MinChangedPixels;
+        BitMap<uint64_t> &Changes;
+        // the changed pixels of each block in the current row of blocks
+        std::vector<int> &ChangedPixels;
+        // by block, the first row a pixel of it changed in. Only kept if set
+        std::vector<int> *FirstChangedRow;
+    };
+
+    static void FindChangedBlocks(const Image &oldImage, const Image &newImage, const DiffScratch &scratch, bool exact, uint32_t thresholds,
+                                  DiffPass &pass)
+    {
+        const auto &area = pass.Area;
+        const auto firstblock = area.left / pass.BlockSize;
+        const auto lastblock = (area.right - 1) / pass.BlockSize;
+        // the blocks of the current row of blocks not marked yet, once there are none the rest of its rows are skipped
+        auto unmarked = 0;
+        auto band = scratch.Bands.begin();
+        for (int row = area.top; row < area.bottom; ++row) {
+            const size_t blockrow = row / pass.BlockSize;
+            if (row == area.top || row % pass.BlockSize == 0) {
+                std::fill(pass.ChangedPixels.begin() + firstblock, pass.ChangedPixels.begin() + lastblock + 1, 0);
+                unmarked = 0;
+                for (auto block = firstblock; block <= lastblock; block++) {
+                    unmarked += pass.Changes.get(blockrow, block) ? 0 : 1;
+                }
+            }
+            if (!unmarked) {
+                row = std::min(area.bottom, static_cast<int>(blockrow + 1) * pass.BlockSize) - 1;
+                continue;
+            }
+            while (band->Bottom <= row) {
+                ++band;
+            }
+            // rows can be padded
+            const auto old_ptr =
+                reinterpret_cast<const int *>(reinterpret_cast<const unsigned char *>(StartSrc(oldImage)) + row * oldImage.RowStrideInBytes);
+            const auto new_ptr =
+                reinterpret_cast<const int *>(reinterpret_cast<const unsigned char *>(StartSrc(newImage)) + row * newImage.RowStrideInBytes);
+            for (auto span = scratch.Spans.begin() + band->FirstSpan; span != scratch.Spans.begin() + band->EndSpan; ++span) {
+                const auto right = std::min(span->second, area.right);
+                for (auto x = std::max(span->first, area.left); x < right;) {
+                    const auto block = x / pass.BlockSize;
+                    const auto end = std::min(right, (block + 1) * pass.BlockSize);
+                    if (!pass.Changes.get(blockrow, block)) {
+                        const auto changed = exact ? (memcmp(old_ptr + x, new_ptr + x, (end - x) * sizeof(int)) != 0 ? 1 : 0)
+                                                   : CountChangedPixels(reinterpret_cast<const unsigned char *>(old_ptr + x),
+                                                                        reinterpret_cast<const unsigned char *>(new_ptr + x), end - x, thresholds);
+                        if (changed) {
+                            if (pass.FirstChangedRow && !pass.ChangedPixels[block]) {
+                                (*pass.FirstChangedRow)[blockrow * pass.Changes.width() + block] = row;
+                            }
+                            pass.ChangedPixels[block] += changed;
+                            if (pass.ChangedPixels[block] >= pass.MinChangedPixels) {
+                                pass.Changes.set(blockrow, block);
+                                unmarked--;
+                            }
+                        }
+                    }
+                    x = end;
+                }
+            }
+        }
     }
 
-    std::vector<ImageRect> GetDifs(const Image &oldImage, const Image &newImage)
+    std::vector<ImageRect> GetDifs(const Image &oldImage, const Image &newImage, const std::vector<ImageRect> &ignore, const DiffTolerance &tolerance,
+                                   int blocksize)
     {
-        auto old_ptr = (const int *)StartSrc(oldImage);
-        auto new_ptr = (const int *)StartSrc(newImage);
+        DiffScratch scratch;
+        std::vector<ImageRect> rects;
+        GetDifs(oldImage, newImage, ignore, tolerance, blocksize, scratch, rects);
+        return rects;
+    }
 
+    void GetDifs(const Image &oldImage, const Image &newImage, const std::vector<ImageRect> &ignore, const DiffTolerance &tolerance, int blocksize,
+                 DiffScratch &scratch, std::vector<ImageRect> &rects)
+    {
+        assert(blocksize >= 8 && blocksize <= maxdist && maxdist % blocksize == 0);
         const auto width = Width(newImage);
         const auto height = Height(newImage);
 
         const auto width_chunks = width / maxdist;
         const auto height_chunks = height / maxdist;
 
-        const auto line_rem = width % maxdist;
-        const auto bottom_rem = height % maxdist;
-
-        BitMap<uint64_t> changes{static_cast<size_t>(height_chunks) + 1, static_cast<size_t>(width_chunks) + 1};
+        BitMap<uint64_t> changes{scratch.Tiles, static_cast<size_t>(height_chunks) + 1, static_cast<size_t>(width_chunks) + 1};
+
+        const auto exact = isExact(tolerance);
+        // an ignored alpha can not be above the threshold
+        const uint32_t thresholds = tolerance.B | tolerance.G << 8 | tolerance.R << 16 | (tolerance.IgnoreAlpha ? 0xffu : tolerance.A) << 24;
+        const auto refine = blocksize < maxdist;
+        scratch.ChangedPixels.resize(width / blocksize + 1);
+        scratch.FirstChangedRow.resize(refine ? changes.width() * changes.height() : 0);
+
+        // ignored pixels are never read
+        GetRowBands(width, height, ignore, scratch);
+        // the whole image in tiles first, a tile stops being compared at its first change so idle areas are all that is read completely
+        DiffPass tiles{ImageRect(0, 0, width, height), maxdist, tolerance.MinChangedPixels, changes, scratch.ChangedPixels,
+                       refine ? &scratch.FirstChangedRow : nullptr};
+        FindChangedBlocks(oldImage, newImage, scratch, exact, thresholds, tiles);
+        if (!refine) {
+            GetRects(changes, maxdist, rects);
+            merge(rects, scratch.Merged);
+            SanitizeRects(rects, newImage);
+            return;
+        }
 
-        const auto compare = [&](size_t x, size_t y, size_t npixels) {
-            if (!changes.get(x, y)) {
-                if (memcmp(old_ptr, new_ptr, npixels * sizeof(int))) {
-                    changes.set(x, y);
+        // then only the changed tiles in blocks, from the row the tile changed first in. Any changed pixel marks a block, the tile as a whole
+        // already has enough of them
+        BitMap<uint64_t> blocks{scratch.Blocks, static_cast<size_t>(height / blocksize) + 1, static_cast<size_t>(width / blocksize) + 1};
+        for (size_t y = 0; y < changes.height(); y++) {
+            for (size_t x = 0; x < changes.width(); x++) {
+                if (!changes.get(y, x)) {
+                    continue;
                 }
+                const auto top = scratch.FirstChangedRow[y * changes.width() + x] / blocksize * blocksize;
+                const auto left = static_cast<int>(x) * maxdist;
+                DiffPass tile{ImageRect(left, top, std::min(left + maxdist, width), std::min(static_cast<int>(y + 1) * maxdist, height)),
+                              blocksize,
+                              1,
+                              blocks,
+                              scratch.ChangedPixels,
+                              nullptr};
+                FindChangedBlocks(oldImage, newImage, scratch, exact, thresholds, tile);
             }
+        }
+        GetRects(blocks, blocksize, rects);
+        merge(rects, scratch.Merged);
+        SanitizeRects(rects, newImage);
+    }
 
-            old_ptr += npixels;
-            new_ptr += npixels;
-        };
+    std::shared_ptr<ChangeHistory> ChangeHistoryMap::get(long long source) const
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        auto &history = Histories[source];
+        if (!history) {
+            history = std::make_shared<ChangeHistory>();
+        }
+        return history;
+    }
 
-        for (int x = 0; x < height_chunks; ++x) {
-            for (int i = 0; i < maxdist; ++i) { // for each row in current line of chunks
-                for (int y = 0; y < width_chunks; ++y) {
-                    compare(x, y, maxdist);
-                }
-                compare(x, width_chunks, line_rem);
+    std::shared_ptr<ChangeHistory> ChangeHistoryMap::find(long long source) const
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        auto found = Histories.find(source);
+        return found == Histories.end() ? nullptr : found->second;
+    }
+
+    void RecordChanges(ChangeHistory &history, unsigned long long sequence, const ImageRect &frame, int blocksize,
+                       const std::vector<ImageRect> &rects)
+    {
+        const auto width = Width(frame);
+        const auto height = Height(frame);
+        const auto columns = (width + blocksize - 1) / blocksize;
+        const auto rows = (height + blocksize - 1) / blocksize;
+        std::lock_guard<std::mutex> lock(history.Mutex);
+        if (history.Width != width || history.Height != height || history.BlockSize != blocksize) {
+            // nothing recorded so far says anything about a frame of this size
+            history.Width = width;
+            history.Height = height;
+            history.BlockSize = blocksize;
+            history.Versions.assign(static_cast<size_t>(columns) * rows, sequence);
+            return;
+        }
+        for (const auto &r : rects) {
+            const auto left = std::max(r.left, 0) / blocksize;
+            const auto top = std::max(r.top, 0) / blocksize;
+            const auto right = std::min((r.right + blocksize - 1) / blocksize, columns);
+            const auto bottom = std::min((r.bottom + blocksize - 1) / blocksize, rows);
+            for (auto y = top; y < bottom; y++) {
+                auto row = history.Versions.begin() + static_cast<size_t>(y) * columns;
+                std::fill(row + left, row + std::max(left, right), sequence);
             }
         }
+    }
 
-        for (int i = 0; i < bottom_rem; ++i) {
-            for (int y = 0; y < width_chunks; ++y) {
-                compare(height_chunks, y, maxdist);
+    bool ChangesSince(ChangeHistory &history, unsigned long long sequence, std::vector<ImageRect> &rects)
+    {
+        rects.clear();
+        std::lock_guard<std::mutex> lock(history.Mutex);
+        if (history.Versions.empty()) {
+            return false;
+        }
+        const auto blocksize = history.BlockSize;
+        const auto columns = (history.Width + blocksize - 1) / blocksize;
+        const auto rows = static_cast<int>(history.Versions.size()) / columns;
+        for (auto y = 0; y < rows; y++) {
+            auto row = history.Versions.data() + static_cast<size_t>(y) * columns;
+            for (auto x = 0; x < columns; x++) {
+                if (row[x] <= sequence) {
+                    continue;
+                }
+                // one rect for every run of changed blocks in the row, merge joins them across rows
+                auto end = x + 1;
+                while (end < columns && row[end] > sequence) {
+                    end++;
+                }
+                rects.emplace_back(x * blocksize, y * blocksize, std::min(end * blocksize, history.Width),
+                                   std::min((y + 1) * blocksize, history.Height));
+                x = end;
             }
-
-            compare(height_chunks, width_chunks, line_rem);
         }
-
-        auto rects = GetRects(changes);
         merge(rects);
-        SanitizeRects(rects, newImage);
-        return rects;
+        return true;
+    }
+
+    std::vector<Monitor> GetMonitors()
+    {
+        std::vector<Monitor> ret;
+        GetMonitors(ret);
+        return ret;
     }
 
     Monitor CreateMonitor(int index, int id, int h, int w, int ox, int oy, const std::string &n, float scaling)
@@ -205,6 +474,55 @@ namespace Screen_Capture {
         ret.isContiguous = rowStrideInBytes == sizeof(ImageBGRA) * Width(imgrect);
         return ret;
     }
+    Image Downscale(std::vector<unsigned char> &buffer, const Image &img, int divisor, ScaleFilter filter)
+    {
+        auto rect = DownscaledRect(Rect(img), divisor);
+        buffer.resize(static_cast<size_t>(Width(rect)) * Height(rect) * sizeof(ImageBGRA));
+        ExtractAndDownscale(img, buffer.data(), buffer.size(), divisor, filter);
+        return CreateImage(rect, Width(rect) * sizeof(ImageBGRA), reinterpret_cast<const ImageBGRA *>(buffer.data()));
+    }
+    std::vector<RegionCluster> ClusterRegions(const std::vector<Region> &regions)
+    {
+        std::vector<RegionCluster> clusters;
+        for (size_t i = 0; i < regions.size(); i++) {
+            RegionCluster cluster;
+            cluster.Bounds = regions[i].Rect;
+            cluster.Regions.push_back(i);
+            // the new region can join several clusters together, keep merging until it overlaps none of the others
+            for (auto merged = true; merged;) {
+                merged = false;
+                for (auto it = clusters.begin(); it != clusters.end(); ++it) {
+                    auto &b = it->Bounds;
+                    if (b.left < cluster.Bounds.right && cluster.Bounds.left < b.right && b.top < cluster.Bounds.bottom &&
+                        cluster.Bounds.top < b.bottom) {
+                        cluster.Bounds = ImageRect(std::min(b.left, cluster.Bounds.left), std::min(b.top, cluster.Bounds.top),
+                                                   std::max(b.right, cluster.Bounds.right), std::max(b.bottom, cluster.Bounds.bottom));
+                        cluster.Regions.insert(cluster.Regions.end(), it->Regions.begin(), it->Regions.end());
+                        clusters.erase(it);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+            clusters.push_back(cluster);
+        }
+        return clusters;
+    }
+
+    bool isRegionInsideBounds(const std::vector<Monitor> &monitors, const Region &region)
+    {
+        if (monitors.empty() || Width(region) <= 0 || Height(region) <= 0) {
+            return false;
+        }
+        ImageRect desktop(OffsetX(monitors.front()), OffsetY(monitors.front()), OffsetX(monitors.front()) + Width(monitors.front()),
+                          OffsetY(monitors.front()) + Height(monitors.front()));
+        for (auto &m : monitors) {
+            desktop = ImageRect(std::min(desktop.left, OffsetX(m)), std::min(desktop.top, OffsetY(m)), std::max(desktop.right, OffsetX(m) + Width(m)),
+                                std::max(desktop.bottom, OffsetY(m) + Height(m)));
+        }
+        return desktop.Contains(region.Rect);
+    }
+
     int Index(const Monitor &mointor) { return mointor.Index; }
     int Id(const Monitor &mointor) { return mointor.Id; }
     int Adapter(const Monitor &mointor) { return mointor.Adapter; }
@@ -219,11 +537,16 @@ namespace Screen_Capture {
     int OffsetX(const Image &img) { return img.Bounds.left; }
     int OffsetY(const Image &img) { return img.Bounds.top; }
     const char *Name(const Monitor &mointor) { return mointor.Name; }
+    float RefreshRate(const Monitor &mointor) { return mointor.RefreshRate; }
     const char *Name(const Window &mointor) { return mointor.Name; }
     int Height(const Monitor &mointor) { return mointor.Height; }
     int Width(const Monitor &mointor) { return mointor.Width; }
     void Height(Monitor &mointor, int h) { mointor.Height = h; }
     void Width(Monitor &mointor, int w) { mointor.Width = w; }
+    int Height(const Region &region) { return Height(region.Rect); }
+    int Width(const Region &region) { return Width(region.Rect); }
+    const char *Name(const Region &region) { return region.Name; }
+    const ImageRect &Rect(const Region &region) { return region.Rect; }
     int Height(const Window &mointor) { return mointor.Size.y; }
     int Width(const Window &mointor) { return mointor.Size.x; }
     void Height(Window &mointor, int h) { mointor.Size.y = h; }
@@ -234,6 +557,8 @@ namespace Screen_Capture {
     int Width(const Image &img) { return Width(img.Bounds); }
     int X(const Point &p) { return p.x; }
     int Y(const Point &p) { return p.y; }
+    const ImageRect &Source(const ImageMove &move) { return move.Source; }
+    const Point &Destination(const ImageMove &move) { return move.Destination; }
     const ImageRect &Rect(const Image &img) { return img.Bounds; }
     const ImageBGRA *GotoNextRow(const Image &img, const ImageBGRA *current)
     {
@@ -241,6 +566,35 @@ namespace Screen_Capture {
         return reinterpret_cast<const ImageBGRA *>(c + img.RowStrideInBytes);
     }
     bool isDataContiguous(const Image &img) { return img.isContiguous; }
+    const Image *Reference(const Image &img) { return img.Reference; }
+    unsigned long long Sequence(const Image &img) { return img.Sequence; }
+    long long Timestamp(const Image &img) { return img.Timestamp; }
+    long long Interval(const Image &img) { return img.Interval; }
+    long long MonotonicTime()
+    {
+#if defined(__linux__)
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<long long>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+    std::shared_ptr<const Image> RetainFrame(const Image &img)
+    {
+        if (!img.Owner) {
+            return std::shared_ptr<const Image>();
+        }
+        auto owner = img.Owner->shared_from_this();
+        owner->Holds.fetch_add(1, std::memory_order_relaxed);
+        auto held = new Image(img);
+        // the previous frame it points to is only valid during the callback
+        held->Reference = nullptr;
+        return std::shared_ptr<const Image>(held, [owner](const Image *p) {
+            owner->Holds.fetch_sub(1, std::memory_order_release);
+            delete p;
+        });
+    }
     // number of bytes per row, NOT including the Rowpadding
     int RowStride(const Image &img) { return sizeof(ImageBGRA) * Width(img); }
     const ImageBGRA *StartSrc(const Image &img) { return img.Data; }
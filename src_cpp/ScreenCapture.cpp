@@ -1,12 +1,16 @@
 #include "ScreenCapture.h"
 #include "ScreenCapture_C_API.h"
+#include "ScreenCapture_Recording.h"
+#include "ScreenCapture_SharedFrames.h"
 #include "internal/SCCommon.h"
 #include "internal/ThreadManager.h"
 #include <algorithm>
 #include <assert.h>
+#include <cstddef>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <type_traits>
 
@@ -76,6 +80,8 @@ class ScreenCaptureManager : public IScreenCaptureManager {
 
     std::thread Thread_;
     bool ShuttingDown = false;
+    // serializes the copy, change and swap of the ignore rects
+    std::mutex IgnoreRectsMutex;
     ScreenCaptureManager()
     {
         Thread_Data_ = std::make_shared<Thread_Data>();
@@ -84,6 +90,8 @@ class ScreenCaptureManager : public IScreenCaptureManager {
         Thread_Data_->ScreenCaptureData.MouseTimer = std::make_shared<Timer>(50ms);
         Thread_Data_->WindowCaptureData.FrameTimer = std::make_shared<Timer>(100ms);
         Thread_Data_->WindowCaptureData.MouseTimer = std::make_shared<Timer>(50ms);
+        Thread_Data_->RegionCaptureData.FrameTimer = std::make_shared<Timer>(100ms);
+        Thread_Data_->RegionCaptureData.MouseTimer = std::make_shared<Timer>(50ms);
     }
 
     virtual ~ScreenCaptureManager()
@@ -133,23 +141,108 @@ class ScreenCaptureManager : public IScreenCaptureManager {
 #if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
             Thread_Data_->ScreenCaptureData.FrameTimer.store(timer);
             Thread_Data_->WindowCaptureData.FrameTimer.store(timer);
+            Thread_Data_->RegionCaptureData.FrameTimer.store(timer);
 #else
             std::atomic_store(&Thread_Data_->ScreenCaptureData.FrameTimer, timer);
             std::atomic_store(&Thread_Data_->WindowCaptureData.FrameTimer, timer);
+            std::atomic_store(&Thread_Data_->RegionCaptureData.FrameTimer, timer);
 #endif  
     }
 
+    virtual void setFrameRefreshDivisor(int divisor) override
+    {
+        Thread_Data_->ScreenCaptureData.RefreshDivisor.store(divisor, std::memory_order_relaxed);
+    }
+
     virtual void setMouseChangeInterval(const std::shared_ptr<Timer> &timer) override
     {
 #if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
             Thread_Data_->ScreenCaptureData.MouseTimer.store(timer);
             Thread_Data_->WindowCaptureData.MouseTimer.store(timer);
+            Thread_Data_->RegionCaptureData.MouseTimer.store(timer);
 #else
             std::atomic_store(&Thread_Data_->ScreenCaptureData.MouseTimer, timer);
             std::atomic_store(&Thread_Data_->WindowCaptureData.MouseTimer, timer);
+            std::atomic_store(&Thread_Data_->RegionCaptureData.MouseTimer, timer);
 #endif  
     }
 
+    template <class D> void storeIgnoreRects(D &data, long long source, const std::vector<ImageRect> &rects)
+    {
+        std::lock_guard<std::mutex> lock(IgnoreRectsMutex);
+#if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
+        auto current = data.IgnoreRects.load();
+#else
+        auto current = std::atomic_load(&data.IgnoreRects);
+#endif
+        // the capture threads keep reading the current map, they get the new one with their next frame
+        auto next = current ? std::make_shared<IgnoreRectMap>(*current) : std::make_shared<IgnoreRectMap>();
+        if (rects.empty()) {
+            next->erase(source);
+        }
+        else {
+            (*next)[source] = rects;
+        }
+#if defined(_WIN32) && defined(__cplusplus) && __cplusplus >= 202002L && !defined(__MINGW32__)
+        data.IgnoreRects.store(std::shared_ptr<const IgnoreRectMap>(std::move(next)));
+#else
+        std::atomic_store(&data.IgnoreRects, std::shared_ptr<const IgnoreRectMap>(std::move(next)));
+#endif
+    }
+
+    virtual void setIgnoreRects(const Monitor &monitor, const std::vector<ImageRect> &rects) override
+    {
+        storeIgnoreRects(Thread_Data_->ScreenCaptureData, SourceId(monitor), rects);
+    }
+
+    virtual void setIgnoreRects(const Window &window, const std::vector<ImageRect> &rects) override
+    {
+        storeIgnoreRects(Thread_Data_->WindowCaptureData, SourceId(window), rects);
+    }
+
+    virtual void setIgnoreRects(const Region &region, const std::vector<ImageRect> &rects) override
+    {
+        storeIgnoreRects(Thread_Data_->RegionCaptureData, SourceId(region), rects);
+    }
+
+    template <class D> static bool findChanges(const D &data, long long source, unsigned long long sequence, std::vector<ImageRect> &rects)
+    {
+        auto history = data.Histories.find(source);
+        if (!history) {
+            rects.clear();
+            return false;
+        }
+        return ChangesSince(*history, sequence, rects);
+    }
+
+    virtual bool getChangesSince(const Monitor &monitor, unsigned long long sequence, std::vector<ImageRect> &rects) const override
+    {
+        return findChanges(Thread_Data_->ScreenCaptureData, SourceId(monitor), sequence, rects);
+    }
+
+    virtual bool getChangesSince(const Window &window, unsigned long long sequence, std::vector<ImageRect> &rects) const override
+    {
+        return findChanges(Thread_Data_->WindowCaptureData, SourceId(window), sequence, rects);
+    }
+
+    virtual bool getChangesSince(const Region &region, unsigned long long sequence, std::vector<ImageRect> &rects) const override
+    {
+        return findChanges(Thread_Data_->RegionCaptureData, SourceId(region), sequence, rects);
+    }
+
+    virtual CaptureStatistics getStatistics() const override
+    {
+        CaptureStatistics ret;
+        for (auto statistics : {&Thread_Data_->ScreenCaptureData.Statistics, &Thread_Data_->WindowCaptureData.Statistics,
+                                &Thread_Data_->RegionCaptureData.Statistics}) {
+            ret.Frames += statistics->Frames.load(std::memory_order_relaxed);
+            ret.FramesWithAllocations += statistics->FramesWithAllocations.load(std::memory_order_relaxed);
+            ret.TileLookups += statistics->TileLookups.load(std::memory_order_relaxed);
+            ret.TileHits += statistics->TileHits.load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
     virtual void pause() override { Thread_Data_->CommonData_.Paused = true; }
 
     virtual bool isPaused() const override { return Thread_Data_->CommonData_.Paused; }
@@ -157,6 +250,14 @@ class ScreenCaptureManager : public IScreenCaptureManager {
     virtual void resume() override { Thread_Data_->CommonData_.Paused = false; }
 };
 
+// the hashes of the blocks can not tell what moved or how much a pixel changed
+template <class D> static bool HashesCanDiff(const D &data)
+{
+    const auto &tolerance = data.Tolerance;
+    return data.Reference == DiffReference::Frame ||
+           (!data.OnFrameMoved && !tolerance.B && !tolerance.G && !tolerance.R && !tolerance.A && tolerance.MinChangedPixels <= 1);
+}
+
 class ScreenCaptureConfiguration : public ICaptureConfiguration<ScreenCaptureCallback> {
 
     std::shared_ptr<ScreenCaptureManager> Impl_;
@@ -188,10 +289,92 @@ class ScreenCaptureConfiguration : public ICaptureConfiguration<ScreenCaptureCal
         return std::make_shared<ScreenCaptureConfiguration>(Impl_);
     }
 
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> onFrameMoved(const ScreenMoveCallback &cb) override
+    {
+        assert(cb);
+        assert(!Impl_->Thread_Data_->ScreenCaptureData.OnFrameMoved);
+        Impl_->Thread_Data_->ScreenCaptureData.OnFrameMoved = cb;
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> setOutputScale(int divisor, ScaleFilter filter) override
+    {
+        assert(divisor == 1 || divisor == 2 || divisor == 4 || divisor == 8);
+        Impl_->Thread_Data_->ScreenCaptureData.OutputScale = divisor;
+        Impl_->Thread_Data_->ScreenCaptureData.OutputFilter = filter;
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> onNewThumbnail(const ScreenCaptureCallback &cb, int divisor,
+                                                                                         ScaleFilter filter) override
+    {
+        assert(cb);
+        assert(divisor == 2 || divisor == 4 || divisor == 8);
+        assert(!Impl_->Thread_Data_->ScreenCaptureData.OnNewThumbnail);
+        Impl_->Thread_Data_->ScreenCaptureData.OnNewThumbnail = cb;
+        Impl_->Thread_Data_->ScreenCaptureData.ThumbnailScale = divisor;
+        Impl_->Thread_Data_->ScreenCaptureData.ThumbnailFilter = filter;
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> publishFrames(const std::shared_ptr<IFramePublisher> &publisher) override
+    {
+        assert(publisher);
+        Impl_->Thread_Data_->ScreenCaptureData.Publishers.push_back(publisher);
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> setFrameBufferCount(int count) override
+    {
+        assert(count >= 1);
+        Impl_->Thread_Data_->ScreenCaptureData.FrameBufferCount = count;
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> setDiffTolerance(const DiffTolerance &tolerance) override
+    {
+        assert(tolerance.MinChangedPixels >= 1);
+        Impl_->Thread_Data_->ScreenCaptureData.Tolerance = tolerance;
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> setDiffBlockSize(int size) override
+    {
+        assert(size >= 8 && size <= 256 && (size & (size - 1)) == 0);
+        Impl_->Thread_Data_->ScreenCaptureData.DiffBlockSize = size;
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> setDiffReference(DiffReference reference) override
+    {
+        Impl_->Thread_Data_->ScreenCaptureData.Reference = reference;
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> setCompositeCursor(bool composite) override
+    {
+        Impl_->Thread_Data_->ScreenCaptureData.CompositeCursor = composite;
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> onCachedTiles(const ScreenTileCallback &cb, int capacity) override
+    {
+        assert(cb);
+        assert(capacity >= 1);
+        assert(!Impl_->Thread_Data_->ScreenCaptureData.OnCachedTiles);
+        Impl_->Thread_Data_->ScreenCaptureData.OnCachedTiles = cb;
+        Impl_->Thread_Data_->ScreenCaptureData.TileCacheCapacity = capacity;
+        return std::make_shared<ScreenCaptureConfiguration>(Impl_);
+    }
+
     virtual std::shared_ptr<IScreenCaptureManager> start_capturing() override
     {
         assert(Impl_->Thread_Data_->ScreenCaptureData.OnMouseChanged || Impl_->Thread_Data_->ScreenCaptureData.OnFrameChanged ||
-               Impl_->Thread_Data_->ScreenCaptureData.OnNewFrame);
+               Impl_->Thread_Data_->ScreenCaptureData.OnNewFrame || Impl_->Thread_Data_->ScreenCaptureData.OnNewThumbnail ||
+               !Impl_->Thread_Data_->ScreenCaptureData.Publishers.empty());
+        assert(!Impl_->Thread_Data_->ScreenCaptureData.OnFrameMoved || Impl_->Thread_Data_->ScreenCaptureData.OnFrameChanged);
+        assert(!Impl_->Thread_Data_->ScreenCaptureData.OnCachedTiles || Impl_->Thread_Data_->ScreenCaptureData.OnFrameChanged);
+        assert(HashesCanDiff(Impl_->Thread_Data_->ScreenCaptureData));
         Impl_->start();
         return Impl_;
     }
@@ -230,10 +413,212 @@ class WindowCaptureConfiguration : public ICaptureConfiguration<WindowCaptureCal
         return std::make_shared<WindowCaptureConfiguration>(Impl_);
     }
 
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> onFrameMoved(const WindowMoveCallback &cb) override
+    {
+        assert(!Impl_->Thread_Data_->WindowCaptureData.OnFrameMoved);
+        Impl_->Thread_Data_->WindowCaptureData.OnFrameMoved = cb;
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> setOutputScale(int divisor, ScaleFilter filter) override
+    {
+        assert(divisor == 1 || divisor == 2 || divisor == 4 || divisor == 8);
+        Impl_->Thread_Data_->WindowCaptureData.OutputScale = divisor;
+        Impl_->Thread_Data_->WindowCaptureData.OutputFilter = filter;
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> onNewThumbnail(const WindowCaptureCallback &cb, int divisor,
+                                                                                         ScaleFilter filter) override
+    {
+        assert(divisor == 2 || divisor == 4 || divisor == 8);
+        assert(!Impl_->Thread_Data_->WindowCaptureData.OnNewThumbnail);
+        Impl_->Thread_Data_->WindowCaptureData.OnNewThumbnail = cb;
+        Impl_->Thread_Data_->WindowCaptureData.ThumbnailScale = divisor;
+        Impl_->Thread_Data_->WindowCaptureData.ThumbnailFilter = filter;
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> publishFrames(const std::shared_ptr<IFramePublisher> &publisher) override
+    {
+        assert(publisher);
+        Impl_->Thread_Data_->WindowCaptureData.Publishers.push_back(publisher);
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> setFrameBufferCount(int count) override
+    {
+        assert(count >= 1);
+        Impl_->Thread_Data_->WindowCaptureData.FrameBufferCount = count;
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> setDiffTolerance(const DiffTolerance &tolerance) override
+    {
+        assert(tolerance.MinChangedPixels >= 1);
+        Impl_->Thread_Data_->WindowCaptureData.Tolerance = tolerance;
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> setDiffBlockSize(int size) override
+    {
+        assert(size >= 8 && size <= 256 && (size & (size - 1)) == 0);
+        Impl_->Thread_Data_->WindowCaptureData.DiffBlockSize = size;
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> setDiffReference(DiffReference reference) override
+    {
+        Impl_->Thread_Data_->WindowCaptureData.Reference = reference;
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> setCompositeCursor(bool composite) override
+    {
+        Impl_->Thread_Data_->WindowCaptureData.CompositeCursor = composite;
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> onCachedTiles(const WindowTileCallback &cb, int capacity) override
+    {
+        assert(cb);
+        assert(capacity >= 1);
+        assert(!Impl_->Thread_Data_->WindowCaptureData.OnCachedTiles);
+        Impl_->Thread_Data_->WindowCaptureData.OnCachedTiles = cb;
+        Impl_->Thread_Data_->WindowCaptureData.TileCacheCapacity = capacity;
+        return std::make_shared<WindowCaptureConfiguration>(Impl_);
+    }
+
     virtual std::shared_ptr<IScreenCaptureManager> start_capturing() override
     {
         assert(Impl_->Thread_Data_->WindowCaptureData.OnMouseChanged || Impl_->Thread_Data_->WindowCaptureData.OnFrameChanged ||
-               Impl_->Thread_Data_->WindowCaptureData.OnNewFrame);
+               Impl_->Thread_Data_->WindowCaptureData.OnNewFrame || Impl_->Thread_Data_->WindowCaptureData.OnNewThumbnail ||
+               !Impl_->Thread_Data_->WindowCaptureData.Publishers.empty());
+        assert(!Impl_->Thread_Data_->WindowCaptureData.OnFrameMoved || Impl_->Thread_Data_->WindowCaptureData.OnFrameChanged);
+        assert(!Impl_->Thread_Data_->WindowCaptureData.OnCachedTiles || Impl_->Thread_Data_->WindowCaptureData.OnFrameChanged);
+        assert(HashesCanDiff(Impl_->Thread_Data_->WindowCaptureData));
+        Impl_->start();
+        return Impl_;
+    }
+};
+
+class RegionCaptureConfiguration : public ICaptureConfiguration<RegionCaptureCallback> {
+
+    std::shared_ptr<ScreenCaptureManager> Impl_;
+
+  public:
+    RegionCaptureConfiguration(const std::shared_ptr<ScreenCaptureManager> &impl) : Impl_(impl) {}
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> onNewFrame(const RegionCaptureCallback &cb) override
+    {
+        assert(cb);
+        assert(!Impl_->Thread_Data_->RegionCaptureData.OnNewFrame);
+        Impl_->Thread_Data_->RegionCaptureData.OnNewFrame = cb;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> onFrameChanged(const RegionCaptureCallback &cb) override
+    {
+        assert(cb);
+        assert(!Impl_->Thread_Data_->RegionCaptureData.OnFrameChanged);
+        Impl_->Thread_Data_->RegionCaptureData.OnFrameChanged = cb;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> onMouseChanged(const MouseCallback &cb) override
+    {
+        assert(cb);
+        assert(!Impl_->Thread_Data_->RegionCaptureData.OnMouseChanged);
+        Impl_->Thread_Data_->RegionCaptureData.OnMouseChanged = cb;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> onFrameMoved(const RegionMoveCallback &cb) override
+    {
+        assert(cb);
+        assert(!Impl_->Thread_Data_->RegionCaptureData.OnFrameMoved);
+        Impl_->Thread_Data_->RegionCaptureData.OnFrameMoved = cb;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> setOutputScale(int divisor, ScaleFilter filter) override
+    {
+        assert(divisor == 1 || divisor == 2 || divisor == 4 || divisor == 8);
+        Impl_->Thread_Data_->RegionCaptureData.OutputScale = divisor;
+        Impl_->Thread_Data_->RegionCaptureData.OutputFilter = filter;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> onNewThumbnail(const RegionCaptureCallback &cb, int divisor,
+                                                                                         ScaleFilter filter) override
+    {
+        assert(cb);
+        assert(divisor == 2 || divisor == 4 || divisor == 8);
+        assert(!Impl_->Thread_Data_->RegionCaptureData.OnNewThumbnail);
+        Impl_->Thread_Data_->RegionCaptureData.OnNewThumbnail = cb;
+        Impl_->Thread_Data_->RegionCaptureData.ThumbnailScale = divisor;
+        Impl_->Thread_Data_->RegionCaptureData.ThumbnailFilter = filter;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> publishFrames(const std::shared_ptr<IFramePublisher> &publisher) override
+    {
+        assert(publisher);
+        Impl_->Thread_Data_->RegionCaptureData.Publishers.push_back(publisher);
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> setFrameBufferCount(int count) override
+    {
+        assert(count >= 1);
+        Impl_->Thread_Data_->RegionCaptureData.FrameBufferCount = count;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> setDiffTolerance(const DiffTolerance &tolerance) override
+    {
+        assert(tolerance.MinChangedPixels >= 1);
+        Impl_->Thread_Data_->RegionCaptureData.Tolerance = tolerance;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> setDiffBlockSize(int size) override
+    {
+        assert(size >= 8 && size <= 256 && (size & (size - 1)) == 0);
+        Impl_->Thread_Data_->RegionCaptureData.DiffBlockSize = size;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> setDiffReference(DiffReference reference) override
+    {
+        Impl_->Thread_Data_->RegionCaptureData.Reference = reference;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> setCompositeCursor(bool composite) override
+    {
+        Impl_->Thread_Data_->RegionCaptureData.CompositeCursor = composite;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> onCachedTiles(const RegionTileCallback &cb, int capacity) override
+    {
+        assert(cb);
+        assert(capacity >= 1);
+        assert(!Impl_->Thread_Data_->RegionCaptureData.OnCachedTiles);
+        Impl_->Thread_Data_->RegionCaptureData.OnCachedTiles = cb;
+        Impl_->Thread_Data_->RegionCaptureData.TileCacheCapacity = capacity;
+        return std::make_shared<RegionCaptureConfiguration>(Impl_);
+    }
+
+    virtual std::shared_ptr<IScreenCaptureManager> start_capturing() override
+    {
+        assert(Impl_->Thread_Data_->RegionCaptureData.OnMouseChanged || Impl_->Thread_Data_->RegionCaptureData.OnFrameChanged ||
+               Impl_->Thread_Data_->RegionCaptureData.OnNewFrame || Impl_->Thread_Data_->RegionCaptureData.OnNewThumbnail ||
+               !Impl_->Thread_Data_->RegionCaptureData.Publishers.empty());
+        assert(!Impl_->Thread_Data_->RegionCaptureData.OnFrameMoved || Impl_->Thread_Data_->RegionCaptureData.OnFrameChanged);
+        assert(!Impl_->Thread_Data_->RegionCaptureData.OnCachedTiles || Impl_->Thread_Data_->RegionCaptureData.OnFrameChanged);
+        assert(HashesCanDiff(Impl_->Thread_Data_->RegionCaptureData));
         Impl_->start();
         return Impl_;
     }
@@ -247,6 +632,16 @@ std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> CreateCaptureConfi
     return std::make_shared<ScreenCaptureConfiguration>(impl);
 }
 
+std::shared_ptr<ICaptureConfiguration<ScreenCaptureCallback>> CreateReplayConfiguration(const std::string &path, double speed)
+{
+    assert(!path.empty() && speed >= 0);
+    auto impl = std::make_shared<ScreenCaptureManager>();
+    impl->Thread_Data_->Replay.Path = path;
+    impl->Thread_Data_->Replay.Speed = speed;
+    impl->Thread_Data_->ScreenCaptureData.getThingsToWatch = [path]() { return GetRecordedMonitors(path); };
+    return std::make_shared<ScreenCaptureConfiguration>(impl);
+}
+
 std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> CreateCaptureConfiguration(const WindowCallback &windowtocapture)
 {
     auto impl = std::make_shared<ScreenCaptureManager>();
@@ -254,6 +649,14 @@ std::shared_ptr<ICaptureConfiguration<WindowCaptureCallback>> CreateCaptureConfi
     return std::make_shared<WindowCaptureConfiguration>(impl);
 }
 
+std::shared_ptr<ICaptureConfiguration<RegionCaptureCallback>> CreateCaptureConfiguration(const RegionCallback &regionstocapture)
+{
+    assert(regionstocapture);
+    auto impl = std::make_shared<ScreenCaptureManager>();
+    impl->Thread_Data_->RegionCaptureData.getThingsToWatch = regionstocapture;
+    return std::make_shared<RegionCaptureConfiguration>(impl);
+}
+
 }; // namespace SL::Screen_Capture
 
 int SCL_GetMonitors(SCL_MonitorRef monitors, int monitors_size)
@@ -277,6 +680,8 @@ int SCL_IsMonitorInsideBounds(SCL_MonitorRefConst monitors, const int monitorsiz
     return int(IsMonitorInsideBounds(monitors, monitorsize, *monitor));
 }
 
+float SCL_MonitorRefreshRate(SCL_MonitorRefConst monitor) { return SL::Screen_Capture::RefreshRate(*monitor); }
+
 void SCL_MonitorOnNewFrame(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenCaptureCallback cb)
 {
     ptr->ptr = ptr->ptr->onNewFrame([=](const SL::Screen_Capture::Image &img, const SL::Screen_Capture::Monitor &monitor) { cb(&img, &monitor); });
@@ -312,6 +717,49 @@ void SCL_MonitorOnMouseChangedWithContext(SCL_ICaptureConfigurationScreenCapture
         [=](const SL::Screen_Capture::Image *img, const SL::Screen_Capture::MousePoint &mousepoint) { cb(img, &mousepoint, ptr->context); });
 }
 
+void SCL_MonitorOnFrameMoved(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenMoveCallback cb)
+{
+    ptr->ptr =
+        ptr->ptr->onFrameMoved([=](const SL::Screen_Capture::ImageMove &move, const SL::Screen_Capture::Monitor &monitor) { cb(&move, &monitor); });
+}
+
+void SCL_MonitorOnFrameMovedWithContext(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenMoveCallbackWithContext cb)
+{
+    ptr->ptr = ptr->ptr->onFrameMoved(
+        [=](const SL::Screen_Capture::ImageMove &move, const SL::Screen_Capture::Monitor &monitor) { cb(&move, &monitor, ptr->context); });
+}
+
+void SCL_MonitorSetOutputScale(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int divisor, int filter)
+{
+    ptr->ptr = ptr->ptr->setOutputScale(divisor, static_cast<SL::Screen_Capture::ScaleFilter>(filter));
+}
+
+int SCL_MonitorPublishFrames(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, const char *socketpath, int maxwidth, int maxheight,
+                             int slots)
+{
+    auto publisher = socketpath ? SL::Screen_Capture::CreateFramePublisher(socketpath, maxwidth, maxheight, slots) : nullptr;
+    if (!publisher) {
+        return 0;
+    }
+    ptr->ptr = ptr->ptr->publishFrames(publisher);
+    return 1;
+}
+
+void SCL_MonitorOnNewThumbnail(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenCaptureCallback cb, int divisor, int filter)
+{
+    ptr->ptr = ptr->ptr->onNewThumbnail(
+        [=](const SL::Screen_Capture::Image &img, const SL::Screen_Capture::Monitor &monitor) { cb(&img, &monitor); }, divisor,
+        static_cast<SL::Screen_Capture::ScaleFilter>(filter));
+}
+
+void SCL_MonitorOnNewThumbnailWithContext(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenCaptureCallbackWithContext cb,
+                                          int divisor, int filter)
+{
+    ptr->ptr = ptr->ptr->onNewThumbnail(
+        [=](const SL::Screen_Capture::Image &img, const SL::Screen_Capture::Monitor &monitor) { cb(&img, &monitor, ptr->context); }, divisor,
+        static_cast<SL::Screen_Capture::ScaleFilter>(filter));
+}
+
 SCL_IScreenCaptureManagerWrapperRef SCL_MonitorStartCapturing(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr)
 {
     auto p = new SL::Screen_Capture::C_API::IScreenCaptureManagerWrapper{ptr->ptr->start_capturing()};
@@ -328,12 +776,70 @@ void SCL_SetMouseChangeInterval(SCL_IScreenCaptureManagerWrapperRef ptr, int mil
     ptr->ptr->setMouseChangeInterval(std::chrono::milliseconds(milliseconds));
 }
 
+void SCL_SetFrameRefreshDivisor(SCL_IScreenCaptureManagerWrapperRef ptr, int divisor) { ptr->ptr->setFrameRefreshDivisor(divisor); }
+
 void SCL_PauseCapturing(SCL_IScreenCaptureManagerWrapperRef ptr) { ptr->ptr->pause(); }
 
 int SCL_IsPaused(SCL_IScreenCaptureManagerWrapperRef ptr) { return int(ptr->ptr->isPaused()); }
 
 void SCL_Resume(SCL_IScreenCaptureManagerWrapperRef ptr) { ptr->ptr->resume(); }
 
+void SCL_GetCaptureStatistics(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_CaptureStatistics *statistics)
+{
+    auto s = ptr->ptr->getStatistics();
+    statistics->Frames = s.Frames;
+    statistics->FramesWithAllocations = s.FramesWithAllocations;
+    statistics->TileLookups = s.TileLookups;
+    statistics->TileHits = s.TileHits;
+}
+
+static std::vector<SL::Screen_Capture::ImageRect> ToImageRects(const SCL_SharedRect *rects, int count)
+{
+    std::vector<SL::Screen_Capture::ImageRect> ret;
+    for (auto i = 0; rects && i < count; i++) {
+        ret.emplace_back(rects[i].left, rects[i].top, rects[i].right, rects[i].bottom);
+    }
+    return ret;
+}
+
+void SCL_MonitorSetIgnoreRects(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_MonitorRefConst monitor, const SCL_SharedRect *rects, int count)
+{
+    ptr->ptr->setIgnoreRects(*monitor, ToImageRects(rects, count));
+}
+
+void SCL_WindowSetIgnoreRects(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_WindowRefConst window, const SCL_SharedRect *rects, int count)
+{
+    ptr->ptr->setIgnoreRects(*window, ToImageRects(rects, count));
+}
+
+static int FromImageRects(bool known, const std::vector<SL::Screen_Capture::ImageRect> &changes, SCL_SharedRect *rects, int rects_size)
+{
+    if (!known) {
+        return -1;
+    }
+    auto maxelements = std::clamp(static_cast<int>(changes.size()), 0, rects ? rects_size : 0);
+    for (auto i = 0; i < maxelements; i++) {
+        rects[i] = SCL_SharedRect{changes[i].left, changes[i].top, changes[i].right, changes[i].bottom};
+    }
+    return static_cast<int>(changes.size());
+}
+
+int SCL_MonitorGetChangesSince(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_MonitorRefConst monitor, unsigned long long sequence,
+                               SCL_SharedRect *rects, int rects_size)
+{
+    std::vector<SL::Screen_Capture::ImageRect> changes;
+    auto known = ptr->ptr->getChangesSince(*monitor, sequence, changes);
+    return FromImageRects(known, changes, rects, rects_size);
+}
+
+int SCL_WindowGetChangesSince(SCL_IScreenCaptureManagerWrapperRef ptr, SCL_WindowRefConst window, unsigned long long sequence,
+                              SCL_SharedRect *rects, int rects_size)
+{
+    std::vector<SL::Screen_Capture::ImageRect> changes;
+    auto known = ptr->ptr->getChangesSince(*window, sequence, changes);
+    return FromImageRects(known, changes, rects, rects_size);
+}
+
 void SCL_FreeIScreenCaptureManagerWrapper(SCL_IScreenCaptureManagerWrapperRef ptr) { delete ptr; }
 
 void SCL_WindowOnNewFrame(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowCaptureCallback cb)
@@ -370,12 +876,200 @@ void SCL_WindowOnMouseChangedWithContext(SCL_ICaptureConfigurationWindowCaptureC
         [=](const SL::Screen_Capture::Image *img, const SL::Screen_Capture::MousePoint &mousepoint) { cb(img, &mousepoint, ptr->context); });
 }
 
+void SCL_WindowOnFrameMoved(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowMoveCallback cb)
+{
+    ptr->ptr =
+        ptr->ptr->onFrameMoved([=](const SL::Screen_Capture::ImageMove &move, const SL::Screen_Capture::Window &window) { cb(&move, &window); });
+}
+
+void SCL_WindowOnFrameMovedWithContext(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowMoveCallbackWithContext cb)
+{
+    ptr->ptr = ptr->ptr->onFrameMoved(
+        [=](const SL::Screen_Capture::ImageMove &move, const SL::Screen_Capture::Window &window) { cb(&move, &window, ptr->context); });
+}
+
+void SCL_WindowSetOutputScale(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int divisor, int filter)
+{
+    ptr->ptr = ptr->ptr->setOutputScale(divisor, static_cast<SL::Screen_Capture::ScaleFilter>(filter));
+}
+
+int SCL_WindowPublishFrames(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, const char *socketpath, int maxwidth, int maxheight,
+                            int slots)
+{
+    auto publisher = socketpath ? SL::Screen_Capture::CreateFramePublisher(socketpath, maxwidth, maxheight, slots) : nullptr;
+    if (!publisher) {
+        return 0;
+    }
+    ptr->ptr = ptr->ptr->publishFrames(publisher);
+    return 1;
+}
+
+void SCL_WindowOnNewThumbnail(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowCaptureCallback cb, int divisor, int filter)
+{
+    ptr->ptr = ptr->ptr->onNewThumbnail(
+        [=](const SL::Screen_Capture::Image &img, const SL::Screen_Capture::Window &window) { cb(&img, &window); }, divisor,
+        static_cast<SL::Screen_Capture::ScaleFilter>(filter));
+}
+
+void SCL_WindowOnNewThumbnailWithContext(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowCaptureCallbackWithContext cb,
+                                         int divisor, int filter)
+{
+    ptr->ptr = ptr->ptr->onNewThumbnail(
+        [=](const SL::Screen_Capture::Image &img, const SL::Screen_Capture::Window &window) { cb(&img, &window, ptr->context); }, divisor,
+        static_cast<SL::Screen_Capture::ScaleFilter>(filter));
+}
+
 SCL_IScreenCaptureManagerWrapperRef SCL_WindowStartCapturing(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr)
 {
     auto p = new SL::Screen_Capture::C_API::IScreenCaptureManagerWrapper{ptr->ptr->start_capturing()};
     return p;
 }
 
+void SCL_MonitorSetFrameBufferCount(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int count)
+{
+    ptr->ptr = ptr->ptr->setFrameBufferCount(count);
+}
+
+void SCL_WindowSetFrameBufferCount(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int count)
+{
+    ptr->ptr = ptr->ptr->setFrameBufferCount(count);
+}
+
+static SL::Screen_Capture::DiffTolerance ToDiffTolerance(int b, int g, int r, int a, int ignorealpha, int minchangedpixels)
+{
+    SL::Screen_Capture::DiffTolerance tolerance;
+    tolerance.B = static_cast<unsigned char>(std::clamp(b, 0, 255));
+    tolerance.G = static_cast<unsigned char>(std::clamp(g, 0, 255));
+    tolerance.R = static_cast<unsigned char>(std::clamp(r, 0, 255));
+    tolerance.A = static_cast<unsigned char>(std::clamp(a, 0, 255));
+    tolerance.IgnoreAlpha = ignorealpha != 0;
+    tolerance.MinChangedPixels = std::max(minchangedpixels, 1);
+    return tolerance;
+}
+
+void SCL_MonitorSetDiffTolerance(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int b, int g, int r, int a, int ignorealpha,
+                                 int minchangedpixels)
+{
+    ptr->ptr = ptr->ptr->setDiffTolerance(ToDiffTolerance(b, g, r, a, ignorealpha, minchangedpixels));
+}
+
+void SCL_WindowSetDiffTolerance(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int b, int g, int r, int a, int ignorealpha,
+                                int minchangedpixels)
+{
+    ptr->ptr = ptr->ptr->setDiffTolerance(ToDiffTolerance(b, g, r, a, ignorealpha, minchangedpixels));
+}
+
+void SCL_MonitorSetDiffBlockSize(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int size)
+{
+    ptr->ptr = ptr->ptr->setDiffBlockSize(size);
+}
+
+void SCL_WindowSetDiffBlockSize(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int size)
+{
+    ptr->ptr = ptr->ptr->setDiffBlockSize(size);
+}
+
+void SCL_MonitorSetDiffReference(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int reference)
+{
+    ptr->ptr = ptr->ptr->setDiffReference(static_cast<SL::Screen_Capture::DiffReference>(reference));
+}
+
+void SCL_WindowSetDiffReference(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int reference)
+{
+    ptr->ptr = ptr->ptr->setDiffReference(static_cast<SL::Screen_Capture::DiffReference>(reference));
+}
+
+void SCL_MonitorSetCompositeCursor(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, int composite)
+{
+    ptr->ptr = ptr->ptr->setCompositeCursor(composite != 0);
+}
+
+void SCL_WindowSetCompositeCursor(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, int composite)
+{
+    ptr->ptr = ptr->ptr->setCompositeCursor(composite != 0);
+}
+
+// the tiles are handed out as they are, no copy per frame
+static_assert(sizeof(SCL_CachedTile) == sizeof(SL::Screen_Capture::CachedTile) &&
+              offsetof(SCL_CachedTile, Hash) == offsetof(SL::Screen_Capture::CachedTile, Hash) &&
+              offsetof(SCL_CachedTile, Hit) == offsetof(SL::Screen_Capture::CachedTile, Hit));
+
+static const SCL_CachedTile *ToCachedTiles(const std::vector<SL::Screen_Capture::CachedTile> &tiles)
+{
+    return reinterpret_cast<const SCL_CachedTile *>(tiles.data());
+}
+
+void SCL_MonitorOnCachedTiles(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenTileCallback cb, int capacity)
+{
+    ptr->ptr = ptr->ptr->onCachedTiles(
+        [=](const std::vector<SL::Screen_Capture::CachedTile> &tiles, const SL::Screen_Capture::Monitor &monitor) {
+            cb(ToCachedTiles(tiles), static_cast<int>(tiles.size()), &monitor);
+        },
+        capacity);
+}
+
+void SCL_MonitorOnCachedTilesWithContext(SCL_ICaptureConfigurationScreenCaptureCallbackWrapperRef ptr, SCL_ScreenTileCallbackWithContext cb,
+                                         int capacity)
+{
+    ptr->ptr = ptr->ptr->onCachedTiles(
+        [=](const std::vector<SL::Screen_Capture::CachedTile> &tiles, const SL::Screen_Capture::Monitor &monitor) {
+            cb(ToCachedTiles(tiles), static_cast<int>(tiles.size()), &monitor, ptr->context);
+        },
+        capacity);
+}
+
+void SCL_WindowOnCachedTiles(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowTileCallback cb, int capacity)
+{
+    ptr->ptr = ptr->ptr->onCachedTiles(
+        [=](const std::vector<SL::Screen_Capture::CachedTile> &tiles, const SL::Screen_Capture::Window &window) {
+            cb(ToCachedTiles(tiles), static_cast<int>(tiles.size()), &window);
+        },
+        capacity);
+}
+
+void SCL_WindowOnCachedTilesWithContext(SCL_ICaptureConfigurationWindowCaptureCallbackWrapperRef ptr, SCL_WindowTileCallbackWithContext cb,
+                                        int capacity)
+{
+    ptr->ptr = ptr->ptr->onCachedTiles(
+        [=](const std::vector<SL::Screen_Capture::CachedTile> &tiles, const SL::Screen_Capture::Window &window) {
+            cb(ToCachedTiles(tiles), static_cast<int>(tiles.size()), &window, ptr->context);
+        },
+        capacity);
+}
+
+int SCL_AcquireFrame(SCL_ImageRefConst image, SCL_Frame *frame)
+{
+    auto held = image ? SL::Screen_Capture::RetainFrame(*image) : nullptr;
+    if (!held) {
+        return 0;
+    }
+    frame->Sequence = held->Owner->Sequence;
+    frame->Timestamp = held->Timestamp;
+    frame->Bounds = SCL_SharedRect{held->Bounds.left, held->Bounds.top, held->Bounds.right, held->Bounds.bottom};
+    frame->RowStrideInBytes = held->RowStrideInBytes;
+    frame->Data = reinterpret_cast<const unsigned char *>(held->Data);
+    // the hold lives on the heap until it is released, no matter which thread does it
+    frame->Handle = new std::shared_ptr<const SL::Screen_Capture::Image>(std::move(held));
+    return 1;
+}
+
+unsigned long long SCL_ImageSequence(SCL_ImageRefConst image) { return SL::Screen_Capture::Sequence(*image); }
+
+long long SCL_ImageTimestamp(SCL_ImageRefConst image) { return SL::Screen_Capture::Timestamp(*image); }
+
+long long SCL_ImageInterval(SCL_ImageRefConst image) { return SL::Screen_Capture::Interval(*image); }
+
+long long SCL_MonotonicTime() { return SL::Screen_Capture::MonotonicTime(); }
+
+void SCL_ReleaseFrame(SCL_Frame *frame)
+{
+    if (frame && frame->Handle) {
+        delete static_cast<std::shared_ptr<const SL::Screen_Capture::Image> *>(frame->Handle);
+        frame->Handle = nullptr;
+        frame->Data = nullptr;
+    }
+}
+
 unsigned char *SCL_Utility_CopyToContiguous(unsigned char *dst, SCL_ImageRefConst image)
 {
 
@@ -0,0 +1,406 @@
+#include "ScreenCapture_SharedFrames.h"
+#include "ScreenCapture_C_API.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace SL {
+namespace Screen_Capture {
+
+    namespace {
+        const uint32_t SharedMagic = 0x53434C46; // "SCLF"
+        const uint32_t SharedVersion = 1;
+        // frames with more dirty rects are published as a single rect covering the frame
+        const uint32_t MaxDirtyRects = 512;
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                      "the shared memory handshake needs lock free atomics");
+
+        // The segment starts with the header, followed by SlotCount slots of SlotSize bytes.
+        struct SharedHeader {
+            uint32_t Magic;
+            uint32_t Version;
+            uint32_t SlotCount;
+            uint32_t MaxWidth;
+            uint32_t MaxHeight;
+            uint32_t PixelOffset; // from the start of a slot
+            uint64_t SlotSize;
+            std::atomic<uint64_t> LatestSequence; // the newest complete frame, 0 before the first one
+            std::atomic<uint32_t> Futex;          // bumped on every frame, consumers without work sleep on it
+        };
+
+        // Seqlock: Lock is odd while the slot is written. Readers check it did not change after they are done with a frame
+        struct SharedSlot {
+            std::atomic<uint64_t> Lock;
+            uint64_t Sequence;
+            uint64_t PreviousSequence; // the frame of the same source the dirty rects are relative to, 0 if none
+            int64_t Source;
+            char Name[128];
+            int32_t Width;
+            int32_t Height;
+            int32_t RowStrideInBytes;
+            uint32_t DirtyCount;
+            SCL_SharedRect Dirty[MaxDirtyRects];
+        };
+
+        inline uint64_t AlignUp(uint64_t v, uint64_t alignment) { return (v + alignment - 1) / alignment * alignment; }
+
+#if defined(__linux__)
+        inline SharedSlot *SlotAt(unsigned char *mapping, uint64_t sequence)
+        {
+            auto header = reinterpret_cast<SharedHeader *>(mapping);
+            return reinterpret_cast<SharedSlot *>(mapping + AlignUp(sizeof(SharedHeader), 64) + (sequence % header->SlotCount) * header->SlotSize);
+        }
+
+        long Futex(std::atomic<uint32_t> *addr, int op, uint32_t val, const timespec *timeout)
+        {
+            return syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), op, val, timeout, nullptr, 0);
+        }
+
+        bool FillAddress(const std::string &path, sockaddr_un &addr)
+        {
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+                return false;
+            }
+            memcpy(addr.sun_path, path.c_str(), path.size());
+            return true;
+        }
+
+        class FramePublisher : public IFramePublisher {
+            std::string Path;
+            int MemFd = -1;
+            int ListenFd = -1;
+            unsigned char *Mapping = nullptr;
+            size_t MappingSize = 0;
+            SharedHeader *Header = nullptr;
+            std::thread Acceptor;
+            std::mutex Lock;
+            uint64_t Sequence = 0;
+            std::map<int64_t, uint64_t> LastBySource;
+
+            void Accept()
+            {
+                for (;;) {
+                    auto fd = accept(ListenFd, nullptr, nullptr);
+                    if (fd < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        return; // the socket was shut down
+                    }
+                    // hand the memfd to the consumer, it is the only thing that ever goes over the socket
+                    char byte = 0;
+                    iovec iov{&byte, 1};
+                    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+                    msghdr msg = {};
+                    msg.msg_iov = &iov;
+                    msg.msg_iovlen = 1;
+                    msg.msg_control = control;
+                    msg.msg_controllen = sizeof(control);
+                    auto cmsg = CMSG_FIRSTHDR(&msg);
+                    cmsg->cmsg_level = SOL_SOCKET;
+                    cmsg->cmsg_type = SCM_RIGHTS;
+                    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+                    memcpy(CMSG_DATA(cmsg), &MemFd, sizeof(int));
+                    sendmsg(fd, &msg, MSG_NOSIGNAL);
+                    close(fd);
+                }
+            }
+
+          public:
+            ~FramePublisher()
+            {
+                if (ListenFd >= 0) {
+                    shutdown(ListenFd, SHUT_RDWR);
+                    if (Acceptor.joinable()) {
+                        Acceptor.join();
+                    }
+                    close(ListenFd);
+                    unlink(Path.c_str());
+                }
+                if (Mapping) {
+                    munmap(Mapping, MappingSize);
+                }
+                if (MemFd >= 0) {
+                    close(MemFd);
+                }
+            }
+
+            bool Init(const std::string &socketpath, int maxwidth, int maxheight, int slots)
+            {
+                Path = socketpath;
+                sockaddr_un addr;
+                if (maxwidth <= 0 || maxheight <= 0 || slots < 2 || !FillAddress(Path, addr)) {
+                    return false;
+                }
+                const auto pixeloffset = AlignUp(sizeof(SharedSlot), 64);
+                const auto slotsize = AlignUp(pixeloffset + static_cast<uint64_t>(maxwidth) * maxheight * sizeof(ImageBGRA), 4096);
+                MappingSize = static_cast<size_t>(AlignUp(sizeof(SharedHeader), 64) + slotsize * slots);
+
+                MemFd = static_cast<int>(syscall(SYS_memfd_create, "screen_capture_lite", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+                if (MemFd < 0 || ftruncate(MemFd, static_cast<off_t>(MappingSize)) != 0) {
+                    return false;
+                }
+                auto mapping = mmap(nullptr, MappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, MemFd, 0);
+                if (mapping == MAP_FAILED) {
+                    return false;
+                }
+                Mapping = static_cast<unsigned char *>(mapping);
+                // consumers can neither resize the segment under us nor map it writable
+                auto seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+#ifdef F_SEAL_FUTURE_WRITE
+                if (fcntl(MemFd, F_ADD_SEALS, seals | F_SEAL_FUTURE_WRITE) == 0) {
+                    seals = 0;
+                }
+                else if (errno != EINVAL) {
+                    return false;
+                }
+                // kernels before 5.1 reject the whole call for the unknown seal, the size is still sealed then
+#endif
+                if (seals && fcntl(MemFd, F_ADD_SEALS, seals) != 0) {
+                    return false;
+                }
+
+                Header = new (Mapping) SharedHeader();
+                Header->Magic = SharedMagic;
+                Header->Version = SharedVersion;
+                Header->SlotCount = static_cast<uint32_t>(slots);
+                Header->MaxWidth = static_cast<uint32_t>(maxwidth);
+                Header->MaxHeight = static_cast<uint32_t>(maxheight);
+                Header->PixelOffset = static_cast<uint32_t>(pixeloffset);
+                Header->SlotSize = slotsize;
+                for (auto i = 0; i < slots; i++) {
+                    new (SlotAt(Mapping, i)) SharedSlot();
+                }
+
+                ListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (ListenFd < 0) {
+                    return false;
+                }
+                unlink(Path.c_str());
+                if (bind(ListenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(ListenFd, 16) != 0) {
+                    close(ListenFd);
+                    ListenFd = -1;
+                    return false;
+                }
+                Acceptor = std::thread([this] { Accept(); });
+                return true;
+            }
+
+            virtual bool publish(const Image &frame, const ImageRect *dirtyrects, size_t dirtycount, long long source, const char *name) override
+            {
+                const auto width = Width(frame);
+                const auto height = Height(frame);
+                if (width > static_cast<int>(Header->MaxWidth) || height > static_cast<int>(Header->MaxHeight)) {
+                    return false;
+                }
+                // capture threads of different monitors share the publisher
+                std::lock_guard<std::mutex> lock(Lock);
+                const auto sequence = ++Sequence;
+                auto slot = SlotAt(Mapping, sequence);
+                auto locked = slot->Lock.load(std::memory_order_relaxed) + 1;
+                slot->Lock.store(locked, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                auto &last = LastBySource[source];
+                slot->Sequence = sequence;
+                slot->PreviousSequence = last;
+                slot->Source = source;
+                memset(slot->Name, 0, sizeof(slot->Name));
+                if (name) {
+                    strncpy(slot->Name, name, sizeof(slot->Name) - 1);
+                }
+                slot->Width = width;
+                slot->Height = height;
+                slot->RowStrideInBytes = width * static_cast<int>(sizeof(ImageBGRA));
+                if (last == 0 || dirtycount > MaxDirtyRects) {
+                    slot->Dirty[0] = SCL_SharedRect{0, 0, width, height};
+                    slot->DirtyCount = 1;
+                }
+                else {
+                    for (size_t i = 0; i < dirtycount; i++) {
+                        slot->Dirty[i] = SCL_SharedRect{dirtyrects[i].left, dirtyrects[i].top, dirtyrects[i].right, dirtyrects[i].bottom};
+                    }
+                    slot->DirtyCount = static_cast<uint32_t>(dirtycount);
+                }
+                Extract(frame, reinterpret_cast<unsigned char *>(slot) + Header->PixelOffset, static_cast<size_t>(slot->RowStrideInBytes) * height);
+                last = sequence;
+
+                slot->Lock.store(locked + 1, std::memory_order_release);
+                Header->LatestSequence.store(sequence);
+                // consumers map the segment read only so they cannot announce that they wait, the wake is cheap when nobody does
+                Header->Futex.fetch_add(1);
+                Futex(&Header->Futex, FUTEX_WAKE, INT_MAX, nullptr);
+                return true;
+            }
+
+            virtual const std::string &path() const override { return Path; }
+        };
+#endif
+    } // namespace
+
+    std::shared_ptr<IFramePublisher> CreateFramePublisher(const std::string &socketpath, int maxwidth, int maxheight, int slots)
+    {
+#if defined(__linux__)
+        auto publisher = std::make_shared<FramePublisher>();
+        if (publisher->Init(socketpath, maxwidth, maxheight, slots)) {
+            return publisher;
+        }
+#else
+        (void)socketpath;
+        (void)maxwidth;
+        (void)maxheight;
+        (void)slots;
+#endif
+        return std::shared_ptr<IFramePublisher>();
+    }
+
+} // namespace Screen_Capture
+} // namespace SL
+
+struct SCL_SharedFrameConsumer {
+    unsigned char *Mapping = nullptr;
+    size_t MappingSize = 0;
+};
+
+#if defined(__linux__)
+using namespace SL::Screen_Capture;
+
+SCL_SharedFrameConsumerRef SCL_OpenSharedFrames(const char *socketpath)
+{
+    sockaddr_un addr;
+    if (!socketpath || !FillAddress(socketpath, addr)) {
+        return nullptr;
+    }
+    auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    char byte = 0;
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto received = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    close(fd);
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    if (received != 1 || !cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        return nullptr;
+    }
+    int memfd = -1;
+    memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if (fstat(memfd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(SharedHeader)) {
+        mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, memfd, 0);
+    }
+    close(memfd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    auto header = static_cast<const SharedHeader *>(mapping);
+    if (header->Magic != SharedMagic || header->Version != SharedVersion) {
+        munmap(mapping, static_cast<size_t>(st.st_size));
+        return nullptr;
+    }
+    auto consumer = new SCL_SharedFrameConsumer();
+    consumer->Mapping = static_cast<unsigned char *>(mapping);
+    consumer->MappingSize = static_cast<size_t>(st.st_size);
+    return consumer;
+}
+
+void SCL_CloseSharedFrames(SCL_SharedFrameConsumerRef consumer)
+{
+    if (consumer) {
+        munmap(consumer->Mapping, consumer->MappingSize);
+        delete consumer;
+    }
+}
+
+int SCL_WaitForSharedFrame(SCL_SharedFrameConsumerRef consumer, unsigned long long lastsequence, int timeoutms)
+{
+    // the futex is a counter the publisher bumps after every frame, read it before the sequence so a frame published in between makes
+    // the wait return right away
+    auto header = reinterpret_cast<SharedHeader *>(consumer->Mapping);
+    auto counter = header->Futex.load();
+    if (header->LatestSequence.load() > lastsequence) {
+        return 1;
+    }
+    timespec timeout{timeoutms / 1000, (timeoutms % 1000) * 1000000L};
+    Futex(&header->Futex, FUTEX_WAIT, counter, timeoutms < 0 ? nullptr : &timeout);
+    return header->LatestSequence.load() > lastsequence ? 1 : 0;
+}
+
+int SCL_AcquireSharedFrame(SCL_SharedFrameConsumerRef consumer, SCL_SharedFrame *frame)
+{
+    auto header = reinterpret_cast<SharedHeader *>(consumer->Mapping);
+    for (;;) {
+        auto sequence = header->LatestSequence.load();
+        if (sequence == 0) {
+            return 0;
+        }
+        auto slot = SlotAt(consumer->Mapping, sequence);
+        auto lock = slot->Lock.load(std::memory_order_acquire);
+        if (lock & 1 || slot->Sequence != sequence) {
+            continue; // the publisher lapped us, take the newer frame
+        }
+        frame->Sequence = slot->Sequence;
+        frame->PreviousSequence = slot->PreviousSequence;
+        frame->Source = slot->Source;
+        frame->Name = slot->Name;
+        frame->Width = slot->Width;
+        frame->Height = slot->Height;
+        frame->RowStrideInBytes = slot->RowStrideInBytes;
+        frame->Data = reinterpret_cast<const unsigned char *>(slot) + header->PixelOffset;
+        frame->DirtyRectCount = static_cast<int>(std::min(slot->DirtyCount, MaxDirtyRects));
+        frame->DirtyRects = slot->Dirty;
+        frame->Lock = lock;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->Lock.load(std::memory_order_relaxed) == lock) {
+            return 1;
+        }
+    }
+}
+
+int SCL_IsSharedFrameValid(SCL_SharedFrameConsumerRef consumer, const SCL_SharedFrame *frame)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return SlotAt(consumer->Mapping, frame->Sequence)->Lock.load(std::memory_order_relaxed) == frame->Lock ? 1 : 0;
+}
+#else
+SCL_SharedFrameConsumerRef SCL_OpenSharedFrames(const char *) { return nullptr; }
+void SCL_CloseSharedFrames(SCL_SharedFrameConsumerRef) {}
+int SCL_WaitForSharedFrame(SCL_SharedFrameConsumerRef, unsigned long long, int) { return 0; }
+int SCL_AcquireSharedFrame(SCL_SharedFrameConsumerRef, SCL_SharedFrame *) { return 0; }
+int SCL_IsSharedFrameValid(SCL_SharedFrameConsumerRef, const SCL_SharedFrame *) { return 0; }
+#endif
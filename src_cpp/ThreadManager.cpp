@@ -19,7 +19,15 @@ void SL::Screen_Capture::ThreadManager::Init(const std::shared_ptr<Thread_Data>&
 {
     assert(m_ThreadHandles.empty());
 
-    if (data->ScreenCaptureData.getThingsToWatch) {
+    if (!data->Replay.Path.empty()) {
+        // the monitors come from the recording, there is no screen to check them against or mouse to follow
+        auto monitors = data->ScreenCaptureData.getThingsToWatch();
+        m_ThreadHandles.resize(monitors.size());
+        for (size_t i = 0; i < monitors.size(); ++i) {
+            m_ThreadHandles[i] = std::thread(&SL::Screen_Capture::RunReplayMonitor, data, monitors[i]);
+        }
+    }
+    else if (data->ScreenCaptureData.getThingsToWatch) {
         auto monitors = data->ScreenCaptureData.getThingsToWatch();
         auto mons = GetMonitors();
         for ([[maybe_unused]] auto &m : monitors) {
@@ -36,6 +44,7 @@ void SL::Screen_Capture::ThreadManager::Init(const std::shared_ptr<Thread_Data>&
                 SL::Screen_Capture::RunCaptureMouse(data);
             });
         }
+        m_ThreadHandles.emplace_back(&SL::Screen_Capture::WatchMonitors, data, mons);
 
     }
     else if (data->WindowCaptureData.getThingsToWatch) {
@@ -50,6 +59,44 @@ void SL::Screen_Capture::ThreadManager::Init(const std::shared_ptr<Thread_Data>&
             });
         }
     }
+    else if (data->RegionCaptureData.getThingsToWatch) {
+        auto regions = data->RegionCaptureData.getThingsToWatch();
+        auto mons = GetMonitors();
+        for ([[maybe_unused]] auto &r : regions) {
+            assert(isRegionInsideBounds(mons, r));
+        }
+        // a single thread grabs all regions so overlapping ones can share the grab
+        m_ThreadHandles.resize(1 + (data->RegionCaptureData.OnMouseChanged ? 1 : 0)); // add another thread for mouse capturing if needed
+        m_ThreadHandles[0] = std::thread(&SL::Screen_Capture::RunCaptureRegions, data, regions);
+        if (data->RegionCaptureData.OnMouseChanged) {
+            m_ThreadHandles.back() = std::thread([data] {
+                SL::Screen_Capture::RunCaptureMouse(data);
+            });
+        }
+        m_ThreadHandles.emplace_back(&SL::Screen_Capture::WatchMonitors, data, mons);
+    }
+}
+
+void SL::Screen_Capture::WatchMonitors(std::shared_ptr<Thread_Data> data, std::vector<Monitor> startmonitors)
+{
+    // kept outside of the loop so every check reuses its memory
+    std::vector<Monitor> monitors;
+    auto waited = 0ms;
+    while (!data->CommonData_.TerminateThreadsEvent) {
+        // short sleeps, so the capture is not held up when it stops
+        std::this_thread::sleep_for(50ms);
+        waited += 50ms;
+        if (waited < MonitorCheckInterval || data->CommonData_.Paused) {
+            continue;
+        }
+        waited = 0ms;
+        GetMonitors(monitors);
+        if (HasMonitorsChanged(startmonitors, monitors)) {
+            // something happened, rebuild
+            data->CommonData_.ExpectedErrorEvent = true;
+            return;
+        }
+    }
 }
 
 void SL::Screen_Capture::ThreadManager::Join()
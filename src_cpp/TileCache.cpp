@@ -0,0 +1,299 @@
+#include "internal/SCCommon.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace SL {
+namespace Screen_Capture {
+
+    namespace {
+        const uint32_t NoEntry = UINT32_MAX;
+        const uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+        const uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+        const uint64_t Prime3 = 0x165667B19E3779F9ull;
+        // alpha is garbage on most platforms, it must not make equal blocks look different
+        const uint64_t NoAlpha = 0x00FFFFFF00FFFFFFull;
+
+        inline uint64_t Rotl(uint64_t v, int bits) { return (v << bits) | (v >> (64 - bits)); }
+
+        inline uint64_t Round(uint64_t acc, uint64_t v)
+        {
+            acc += (v & NoAlpha) * Prime2;
+            return Rotl(acc, 31) * Prime1;
+        }
+
+        // a block is hashed in 4 lanes, so a hash in progress is 4 words
+        const size_t LaneCount = 4;
+
+        void StartHash(uint64_t *lanes)
+        {
+            lanes[0] = Prime1 + Prime2;
+            lanes[1] = Prime2;
+            lanes[2] = 0;
+            lanes[3] = 0 - Prime1;
+        }
+
+        // the lanes go through 32 bytes side by side, what is left of a row goes into them a word at a time
+        void HashRow(uint64_t *lanes, const unsigned char *p, size_t bytes)
+        {
+            size_t x = 0;
+            for (; x + LaneCount * sizeof(uint64_t) <= bytes; x += LaneCount * sizeof(uint64_t)) {
+                uint64_t v[LaneCount];
+                memcpy(v, p + x, sizeof(v));
+                lanes[0] = Round(lanes[0], v[0]);
+                lanes[1] = Round(lanes[1], v[1]);
+                lanes[2] = Round(lanes[2], v[2]);
+                lanes[3] = Round(lanes[3], v[3]);
+            }
+            for (auto lane = 0; x < bytes; x += sizeof(uint64_t), lane++) {
+                uint64_t v = 0;
+                memcpy(&v, p + x, std::min(bytes - x, sizeof(v)));
+                lanes[lane] = Round(lanes[lane], v);
+            }
+        }
+
+        uint64_t FinishHash(const uint64_t *lanes, const ImageRect &block)
+        {
+            auto h = Rotl(lanes[0], 1) + Rotl(lanes[1], 7) + Rotl(lanes[2], 12) + Rotl(lanes[3], 18);
+            h ^= (static_cast<uint64_t>(Width(block)) << 32 | static_cast<uint64_t>(Height(block))) * Prime3;
+            h ^= h >> 33;
+            h *= Prime2;
+            h ^= h >> 29;
+            h *= Prime3;
+            return h ^ (h >> 32);
+        }
+
+        const unsigned char *StartOf(const Image &img, int x, int y)
+        {
+            return reinterpret_cast<const unsigned char *>(StartSrc(img)) + static_cast<size_t>(y) * img.RowStrideInBytes + x * sizeof(ImageBGRA);
+        }
+    } // namespace
+
+    uint64_t HashBlock(const Image &img, const ImageRect &block)
+    {
+        uint64_t lanes[LaneCount];
+        StartHash(lanes);
+        auto row = StartOf(img, block.left, block.top);
+        for (auto y = block.top; y < block.bottom; y++, row += img.RowStrideInBytes) {
+            HashRow(lanes, row, Width(block) * sizeof(ImageBGRA));
+        }
+        return FinishHash(lanes, block);
+    }
+
+    void TileCache::setCapacity(size_t capacity)
+    {
+        if (capacity == Capacity) {
+            return;
+        }
+        Capacity = capacity;
+        Entries.clear();
+        Entries.reserve(capacity);
+        // at most half full, so the probes stay short
+        size_t slots = 16;
+        while (slots < capacity * 2) {
+            slots *= 2;
+        }
+        Slots.assign(capacity ? slots : 0, 0);
+        Newest = Oldest = NoEntry;
+    }
+
+    size_t TileCache::find(uint64_t hash) const
+    {
+        const auto mask = Slots.size() - 1;
+        auto slot = static_cast<size_t>(hash) & mask;
+        while (Slots[slot] && Entries[Slots[slot] - 1].Hash != hash) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void TileCache::erase(size_t slot)
+    {
+        // linear probing without tombstones, the entries behind the hole move up if the hole is on their way from their home slot
+        const auto mask = Slots.size() - 1;
+        auto next = slot;
+        for (;;) {
+            next = (next + 1) & mask;
+            if (!Slots[next]) {
+                break;
+            }
+            const auto home = static_cast<size_t>(Entries[Slots[next] - 1].Hash) & mask;
+            const auto between = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+            if (!between) {
+                Slots[slot] = Slots[next];
+                slot = next;
+            }
+        }
+        Slots[slot] = 0;
+    }
+
+    void TileCache::unlink(uint32_t entry)
+    {
+        auto &e = Entries[entry];
+        (e.Older == NoEntry ? Oldest : Entries[e.Older].Newer) = e.Newer;
+        (e.Newer == NoEntry ? Newest : Entries[e.Newer].Older) = e.Older;
+    }
+
+    void TileCache::pushNewest(uint32_t entry)
+    {
+        auto &e = Entries[entry];
+        e.Older = Newest;
+        e.Newer = NoEntry;
+        (Newest == NoEntry ? Oldest : Entries[Newest].Newer) = entry;
+        Newest = entry;
+    }
+
+    bool TileCache::use(uint64_t hash, unsigned long long sequence)
+    {
+        if (!Capacity) {
+            return false;
+        }
+        auto slot = find(hash);
+        if (Slots[slot]) {
+            const auto entry = Slots[slot] - 1;
+            unlink(entry);
+            pushNewest(entry);
+            // the pixels of a block added by this frame are not out yet
+            return Entries[entry].Added != sequence;
+        }
+        uint32_t entry;
+        if (Entries.size() < Capacity) {
+            entry = static_cast<uint32_t>(Entries.size());
+            Entries.push_back(Entry{hash, sequence, NoEntry, NoEntry});
+        }
+        else {
+            entry = Oldest;
+            erase(find(Entries[entry].Hash));
+            unlink(entry);
+            Entries[entry].Hash = hash;
+            Entries[entry].Added = sequence;
+            // the hole may have moved the slot of the new hash
+            slot = find(hash);
+        }
+        Slots[slot] = entry + 1;
+        pushNewest(entry);
+        return false;
+    }
+
+    size_t LookupTiles(TileCache &cache, const Image &img, const std::vector<ImageRect> &rects, int blocksize, unsigned long long sequence,
+                       bool hits, DiffScratch &scratch)
+    {
+        auto &tiles = scratch.CachedTiles;
+        auto &uncached = scratch.Uncached;
+        tiles.clear();
+        uncached.clear();
+        size_t found = 0;
+        for (const auto &r : rects) {
+            assert(r.left % blocksize == 0 && r.top % blocksize == 0);
+            for (auto top = r.top; top < r.bottom; top += blocksize) {
+                const auto bottom = std::min(top + blocksize, r.bottom);
+                // the run of blocks in this row that still goes to onFrameChanged
+                auto runleft = r.left;
+                for (auto left = r.left; left < r.right; left += blocksize) {
+                    const auto right = std::min(left + blocksize, r.right);
+                    auto hit = false;
+                    if (right - left == blocksize && bottom - top == blocksize) {
+                        CachedTile tile;
+                        tile.Rect = ImageRect(left, top, right, bottom);
+                        tile.Hash = HashBlock(img, tile.Rect);
+                        tile.Hit = hit = cache.use(tile.Hash, sequence) && hits;
+                        tiles.push_back(tile);
+                    }
+                    if (hit) {
+                        found++;
+                        if (runleft < left) {
+                            uncached.emplace_back(runleft, top, left, bottom);
+                        }
+                        runleft = right;
+                    }
+                }
+                if (hits && runleft < r.right) {
+                    uncached.emplace_back(runleft, top, r.right, bottom);
+                }
+            }
+        }
+        if (hits) {
+            merge(uncached, scratch.Merged);
+        }
+        return found;
+    }
+
+    void GetHashDifs(const Image &img, const std::vector<ImageRect> &ignore, int blocksize, std::vector<uint64_t> &hashes, DiffScratch &scratch,
+                     std::vector<ImageRect> &rects)
+    {
+        rects.clear();
+        const auto width = Width(img);
+        const auto height = Height(img);
+        const auto columns = (width + blocksize - 1) / blocksize;
+        const auto rows = (height + blocksize - 1) / blocksize;
+        if (hashes.size() != static_cast<size_t>(columns) * rows) {
+            // nothing to compare against, every block changed
+            hashes.assign(static_cast<size_t>(columns) * rows, 0);
+        }
+        auto &lanes = scratch.HashLanes;
+        lanes.resize(static_cast<size_t>(columns) * LaneCount);
+        auto &bandignore = scratch.BandIgnore;
+        auto &masked = scratch.MaskedRow;
+        for (auto by = 0; by < rows; by++) {
+            const auto top = by * blocksize;
+            const auto bottom = std::min(top + blocksize, height);
+            bandignore.clear();
+            for (const auto &r : ignore) {
+                if (r.top < bottom && r.bottom > top) {
+                    bandignore.push_back(r);
+                }
+            }
+            for (auto bx = 0; bx < columns; bx++) {
+                StartHash(&lanes[bx * LaneCount]);
+            }
+            // row by row through the band, so the memory is read in order
+            for (auto y = top; y < bottom; y++) {
+                auto row = StartOf(img, 0, y);
+                for (auto bx = 0; bx < columns; bx++) {
+                    const auto left = bx * blocksize;
+                    const auto right = std::min(left + blocksize, width);
+                    auto start = row + left * sizeof(ImageBGRA);
+                    const auto bytes = (right - left) * sizeof(ImageBGRA);
+                    for (const auto &r : bandignore) {
+                        if (r.top > y || r.bottom <= y || r.left >= right || r.right <= left) {
+                            continue;
+                        }
+                        // ignored pixels hash as black, so they never change the block
+                        if (start != masked.data()) {
+                            masked.assign(start, start + bytes);
+                            start = masked.data();
+                        }
+                        const auto from = std::max(r.left, left) - left;
+                        const auto to = std::min(r.right, right) - left;
+                        memset(masked.data() + from * sizeof(ImageBGRA), 0, (to - from) * sizeof(ImageBGRA));
+                    }
+                    HashRow(&lanes[bx * LaneCount], start, bytes);
+                }
+            }
+            // one rect for every run of changed blocks, merge joins them across rows
+            auto runleft = -1;
+            for (auto bx = 0; bx <= columns; bx++) {
+                auto changed = false;
+                if (bx < columns) {
+                    const ImageRect block(bx * blocksize, top, std::min((bx + 1) * blocksize, width), bottom);
+                    const auto hash = FinishHash(&lanes[bx * LaneCount], block);
+                    auto &last = hashes[static_cast<size_t>(by) * columns + bx];
+                    changed = hash != last;
+                    last = hash;
+                }
+                if (changed && runleft < 0) {
+                    runleft = bx * blocksize;
+                }
+                else if (!changed && runleft >= 0) {
+                    rects.emplace_back(runleft, top, std::min(bx * blocksize, width), bottom);
+                    runleft = -1;
+                }
+            }
+        }
+        merge(rects, scratch.Merged);
+    }
+
+} // namespace Screen_Capture
+} // namespace SL
@@ -22,6 +22,7 @@ namespace Screen_Capture {
                                                 kCGWindowImageBoundsIgnoreFraming);
         if (!imageRef)
             return DUPL_RETURN_ERROR_EXPECTED; // this happens when the monitors change.
+        CaptureTime = MonotonicTime();
 
         auto width = CGImageGetWidth(imageRef);
         auto height = CGImageGetHeight(imageRef);
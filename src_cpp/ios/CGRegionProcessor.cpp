@@ -0,0 +1,58 @@
+#include "CGRegionProcessor.h"
+#include "TargetConditionals.h"
+#include <ApplicationServices/ApplicationServices.h>
+
+namespace SL {
+namespace Screen_Capture {
+
+    CGRegionProcessor::~CGRegionProcessor()
+    {
+        for (auto grab : Grabs) {
+            if (grab) {
+                CFRelease(grab);
+            }
+        }
+    }
+    DUPL_RETURN CGRegionProcessor::Init(std::shared_ptr<Thread_Data> data, const std::vector<RegionCluster> &clusters)
+    {
+        for (auto &c : clusters) {
+            Bounds.push_back(c.Bounds);
+        }
+        Grabs.resize(clusters.size(), nullptr);
+        return DUPL_RETURN::DUPL_RETURN_SUCCESS;
+    }
+    DUPL_RETURN CGRegionProcessor::ProcessFrame(size_t index, const unsigned char *&data, int &rowstride)
+    {
+        auto &bounds = Bounds[index];
+        // regions are in points, nominal resolution returns one pixel per point so the sizes line up with the monitor sizes
+        auto imageRef = CGWindowListCreateImage(CGRectMake(bounds.left, bounds.top, Width(bounds), Height(bounds)),
+                                                kCGWindowListOptionOnScreenOnly, kCGNullWindowID, kCGWindowImageNominalResolution);
+        if (!imageRef)
+            return DUPL_RETURN_ERROR_EXPECTED; // this happens when the monitors change.
+
+        auto width = CGImageGetWidth(imageRef);
+        auto height = CGImageGetHeight(imageRef);
+        if (width != static_cast<size_t>(Width(bounds)) || height != static_cast<size_t>(Height(bounds))) {
+            CGImageRelease(imageRef);
+            return DUPL_RETURN_ERROR_EXPECTED;
+        }
+        auto prov = CGImageGetDataProvider(imageRef);
+        if (!prov) {
+            CGImageRelease(imageRef);
+            return DUPL_RETURN_ERROR_EXPECTED;
+        }
+        // right now only support full 32 bit images.. Most desktops should run this as its the most efficent
+        assert(CGImageGetBitsPerPixel(imageRef) == sizeof(ImageBGRA) * 8);
+
+        auto rawdatas = CGDataProviderCopyData(prov);
+        if (Grabs[index]) {
+            CFRelease(Grabs[index]);
+        }
+        Grabs[index] = rawdatas;
+        data = CFDataGetBytePtr(rawdatas);
+        rowstride = static_cast<int>(CGImageGetBytesPerRow(imageRef));
+        CGImageRelease(imageRef);
+        return DUPL_RETURN_SUCCESS;
+    }
+}
+}
@@ -6,15 +6,12 @@
 namespace SL{
     namespace Screen_Capture{
         
-        std::vector<Monitor> GetMonitors() {
-            std::vector<Monitor> ret;
-            std::vector<CGDirectDisplayID> displays;
+        void GetMonitors(std::vector<Monitor>& ret) {
+            ret.clear();
+            // this runs over and over while capturing, a fixed list saves asking for the count first
+            CGDirectDisplayID displays[32];
             CGDisplayCount count=0;
-            //get count
-            CGGetActiveDisplayList(0, 0, &count);
-            displays.resize(count);
-    
-            CGGetActiveDisplayList(count, displays.data(), &count);
+            CGGetActiveDisplayList(sizeof(displays) / sizeof(displays[0]), displays, &count);
             for(auto  i = 0; i < count; i++) {
                 //only include non-mirrored displays
                 if(CGDisplayMirrorsDisplay(displays[i]) == kCGNullDirectDisplay){
@@ -23,15 +20,16 @@ namespace SL{
                     
                     auto width = CGDisplayModeGetPixelWidth(dismode);
                     auto height = CGDisplayModeGetPixelHeight(dismode);
+                    // 0 for built in panels that do not have a fixed one
+                    auto refreshrate = static_cast<float>(CGDisplayModeGetRefreshRate(dismode));
                     CGDisplayModeRelease(dismode);
                     auto r = CGDisplayBounds(displays[i]);
                     auto scale = static_cast<float>(width)/static_cast<float>(r.size.width);
                     auto name = std::string("Monitor ") + std::to_string(displays[i]);
                     ret.push_back(CreateMonitor(static_cast<int>(ret.size()), displays[i],height,width, int(r.origin.x), int(r.origin.y), name, scale));
+                    ret.back().RefreshRate = refreshrate;
                 }
             }
-            return ret;
-
         }
     }
 }
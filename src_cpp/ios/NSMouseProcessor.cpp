@@ -20,7 +20,7 @@ namespace Screen_Capture {
     {
         auto Ret = DUPL_RETURN_SUCCESS;
 
-        if (Data->ScreenCaptureData.OnMouseChanged || Data->WindowCaptureData.OnMouseChanged) {
+        if (Data->ScreenCaptureData.OnMouseChanged || Data->WindowCaptureData.OnMouseChanged || Data->RegionCaptureData.OnMouseChanged) {
             auto mouseev = CGEventCreate(NULL);
             auto loc = CGEventGetLocation(mouseev);
             CFRelease(mouseev);
@@ -70,6 +70,9 @@ namespace Screen_Capture {
                 if (Data->ScreenCaptureData.OnMouseChanged) {
                     Data->ScreenCaptureData.OnMouseChanged(&wholeimgfirst, mousepoint);
                 }
+                if (Data->RegionCaptureData.OnMouseChanged) {
+                    Data->RegionCaptureData.OnMouseChanged(&wholeimgfirst, mousepoint);
+                }
                 if (Data->WindowCaptureData.OnMouseChanged) {
                     Data->WindowCaptureData.OnMouseChanged(&wholeimgfirst, mousepoint);
                 }
@@ -79,6 +82,9 @@ namespace Screen_Capture {
                 if (Data->ScreenCaptureData.OnMouseChanged) {
                     Data->ScreenCaptureData.OnMouseChanged(nullptr, mousepoint);
                 }
+                if (Data->RegionCaptureData.OnMouseChanged) {
+                    Data->RegionCaptureData.OnMouseChanged(nullptr, mousepoint);
+                }
                 if (Data->WindowCaptureData.OnMouseChanged) {
                     Data->WindowCaptureData.OnMouseChanged(nullptr, mousepoint);
                 }
@@ -1,6 +1,7 @@
 #include "ScreenCapture.h"
 #include "internal/ThreadManager.h"
 #include "CGFrameProcessor.h"
+#include "CGRegionProcessor.h"
 #include "NSMouseProcessor.h"
 #include "NSFrameProcessor.h"
 
@@ -15,6 +16,9 @@ namespace SL{
         void RunCaptureWindow(std::shared_ptr<Thread_Data> data, Window window){
             TryCaptureWindow<CGFrameProcessor>(data, window);
         }
+        void RunCaptureRegions(std::shared_ptr<Thread_Data> data, std::vector<Region> regions){
+            TryCaptureRegions<CGRegionProcessor>(data, regions);
+        }
     }
 }
 
@@ -2,38 +2,162 @@
 #include "internal/SCCommon.h"
 #include <X11/Xlib.h>
 #include <X11/extensions/Xinerama.h>
-#include <dlfcn.h>
+#include <vector>
+#if defined(SCREEN_CAPTURE_LITE_RANDR)
+#include <X11/extensions/Xrandr.h>
+#include <mutex>
+#endif
 
 namespace SL
 {
 namespace Screen_Capture
 {
 
-    std::vector<Monitor> GetMonitors()
-    {
-      std::vector<Monitor> ret;
+#if defined(SCREEN_CAPTURE_LITE_RANDR)
+    namespace {
+        // Xinerama only knows the rects of the screens, the crtc showing the same rect knows the mode and with it the refresh rate
+        float GetRefreshRate(XRRScreenResources* resources, Display* display, const XineramaScreenInfo& screen)
+        {
+            for(auto c = 0; c < resources->ncrtc; c++) {
+                auto crtc = XRRGetCrtcInfo(display, resources, resources->crtcs[c]);
+                if(!crtc) {
+                    continue;
+                }
+                const auto match = crtc->mode != None && crtc->x == screen.x_org && crtc->y == screen.y_org &&
+                                   static_cast<int>(crtc->width) == screen.width && static_cast<int>(crtc->height) == screen.height;
+                const auto mode = crtc->mode;
+                XRRFreeCrtcInfo(crtc);
+                if(!match) {
+                    continue;
+                }
+                for(auto m = 0; m < resources->nmode; m++) {
+                    auto& info = resources->modes[m];
+                    if(info.id != mode || !info.hTotal || !info.vTotal) {
+                        continue;
+                    }
+                    // the same way xrandr works it out
+                    auto vtotal = static_cast<double>(info.vTotal);
+                    if(info.modeFlags & RR_DoubleScan) {
+                        vtotal *= 2;
+                    }
+                    if(info.modeFlags & RR_Interlace) {
+                        vtotal /= 2;
+                    }
+                    return static_cast<float>(info.dotClock / (info.hTotal * vtotal));
+                }
+            }
+            return 0.0f;
+        }
+
+        // the refresh rates of the screens, by their rect. GetMonitors runs over and over while capturing and every crtc info is a round
+        // trip, so RandR is only asked again after it reported a change on a connection of its own
+        class RefreshRateCache {
+            struct ScreenRate {
+                XineramaScreenInfo Screen;
+                float RefreshRate;
+            };
+            std::mutex Mutex;
+            Display* Events = nullptr;
+            bool Opened = false;
+            bool Stale = true;
+            std::vector<ScreenRate> Rates;
+
+            const ScreenRate* find(const XineramaScreenInfo& screen) const
+            {
+                for(auto& r : Rates) {
+                    if(r.Screen.x_org == screen.x_org && r.Screen.y_org == screen.y_org && r.Screen.width == screen.width &&
+                       r.Screen.height == screen.height) {
+                        return &r;
+                    }
+                }
+                return nullptr;
+            }
 
+          public:
+            ~RefreshRateCache()
+            {
+                if(Events) {
+                    XCloseDisplay(Events);
+                }
+            }
+            // the RefreshRate of monitors, which were read from screens. Unknown rates stay 0
+            void get(const XineramaScreenInfo* screens, int count, std::vector<Monitor>& monitors)
+            {
+                std::lock_guard<std::mutex> lock(Mutex);
+                if(!Opened) {
+                    Opened = true;
+                    int eventbase = 0, errorbase = 0, major = 0, minor = 0;
+                    Events = XOpenDisplay(NULL);
+                    if(Events && (!XRRQueryExtension(Events, &eventbase, &errorbase) || !XRRQueryVersion(Events, &major, &minor) ||
+                                  major < 1 || (major == 1 && minor < 3))) {
+                        // without the extension the refresh rates stay unknown, the current resources came with 1.3
+                        XCloseDisplay(Events);
+                        Events = nullptr;
+                    }
+                    if(Events) {
+                        XRRSelectInput(Events, DefaultRootWindow(Events), RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask);
+                    }
+                }
+                if(!Events) {
+                    return;
+                }
+                // any of them can mean another mode, the events themselves do not matter
+                while(XPending(Events)) {
+                    XEvent ev;
+                    XNextEvent(Events, &ev);
+                    Stale = true;
+                }
+                for(auto i = 0; i < count && !Stale; i++) {
+                    // Xinerama can be ahead of the events
+                    Stale = !find(screens[i]);
+                }
+                if(Stale) {
+                    Rates.clear();
+                    // the current resources do not make the server probe the outputs
+                    auto resources = XRRGetScreenResourcesCurrent(Events, DefaultRootWindow(Events));
+                    for(auto i = 0; i < count; i++) {
+                        Rates.push_back(ScreenRate{screens[i], resources ? GetRefreshRate(resources, Events, screens[i]) : 0.0f});
+                    }
+                    if(resources) {
+                        XRRFreeScreenResources(resources);
+                    }
+                    Stale = false;
+                }
+                for(auto i = 0; i < count; i++) {
+                    monitors[i].RefreshRate = find(screens[i])->RefreshRate;
+                }
+            }
+        };
+        RefreshRateCache RefreshRates;
+    } // namespace
+#endif
+
+    void GetMonitors(std::vector<Monitor>& ret)
+    {
+        ret.clear();
         Display* display = XOpenDisplay(NULL);
         if(display==NULL){
-            return ret;
+            return;
         }
         int nmonitors = 0;
         XineramaScreenInfo* screen = XineramaQueryScreens(display, &nmonitors);
-         if(screen==NULL){ 
+         if(screen==NULL){
             XCloseDisplay(display);
-            return ret;
+            return;
         }
         ret.reserve(nmonitors);
-       
+
         for(auto i = 0; i < nmonitors; i++) {
 
             auto name = std::string("Display ") + std::to_string(i);
             ret.push_back(CreateMonitor(
                 i, screen[i].screen_number, screen[i].height, screen[i].width, screen[i].x_org, screen[i].y_org, name, 1.0f));
         }
+#if defined(SCREEN_CAPTURE_LITE_RANDR)
+        RefreshRates.get(screen, nmonitors, ret);
+#endif
         XFree(screen);
         XCloseDisplay(display);
-        return ret;
     }
 }
 }
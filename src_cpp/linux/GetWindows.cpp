@@ -1,152 +1,224 @@
 #include "ScreenCapture.h"
 #include "internal/SCCommon.h"
-#include <X11/Xlib.h>
-#include <X11/Xutil.h>
+#include <xcb/xcb.h>
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
-#include <iostream>
-
 
 namespace {
-    class UniqueTextProperty {
-    public:
-        UniqueTextProperty()
+    // Keeps the client list and what is known about each client. Instead of asking the server again on every call it listens to the
+    // PropertyNotify and ConfigureNotify events of the root and the clients, and only asks for what changed, all requests of a call in one batch
+    class WindowCache {
+        struct CachedWindow {
+            SL::Screen_Capture::Window Window = {};
+            bool NameChanged = true;
+            bool GeometryChanged = true;
+        };
+
+        xcb_connection_t *Connection = nullptr;
+        xcb_window_t Root = XCB_NONE;
+        xcb_atom_t ClientListAtom = XCB_NONE;
+        xcb_atom_t NetWMNameAtom = XCB_NONE;
+        bool ClientListChanged = true;
+        std::vector<xcb_window_t> ClientList;
+        std::unordered_map<xcb_window_t, CachedWindow> Windows;
+        std::mutex Lock;
+
+        void Disconnect()
         {
-            p.value = nullptr;
+            if (Connection) {
+                xcb_disconnect(Connection);
+            }
+            Connection = nullptr;
+            ClientList.clear();
+            Windows.clear();
+            ClientListChanged = true;
         }
 
-        UniqueTextProperty(const UniqueTextProperty&) = delete;
-        UniqueTextProperty& operator=(const UniqueTextProperty&) = delete;
-
-        UniqueTextProperty(UniqueTextProperty&& other):
-            p{other.p}
+        xcb_atom_t InternAtom(const char *name)
         {
-            other.p = XTextProperty{};
+            auto reply = xcb_intern_atom_reply(Connection, xcb_intern_atom(Connection, 1, static_cast<uint16_t>(strlen(name)), name), nullptr);
+            auto atom = reply ? reply->atom : XCB_NONE;
+            free(reply);
+            return atom;
         }
 
-        UniqueTextProperty& operator=(UniqueTextProperty&& other)
+        bool Connect()
         {
-            swap(*this, other);
-            return *this;
+            Connection = xcb_connect(nullptr, nullptr);
+            if (xcb_connection_has_error(Connection)) {
+                Disconnect();
+                return false;
+            }
+            Root = xcb_setup_roots_iterator(xcb_get_setup(Connection)).data->root;
+            ClientListAtom = InternAtom("_NET_CLIENT_LIST");
+            NetWMNameAtom = InternAtom("_NET_WM_NAME");
+            const uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+            xcb_change_window_attributes(Connection, Root, XCB_CW_EVENT_MASK, &mask);
+            return true;
         }
 
-        friend void swap(UniqueTextProperty& lhs, UniqueTextProperty& rhs) {
-            using std::swap;
-            swap(lhs.p, rhs.p);
+        void ProcessEvents()
+        {
+            while (auto event = xcb_poll_for_event(Connection)) {
+                switch (event->response_type & ~0x80) {
+                case XCB_PROPERTY_NOTIFY: {
+                    auto e = reinterpret_cast<xcb_property_notify_event_t *>(event);
+                    if (e->window == Root) {
+                        ClientListChanged |= e->atom == ClientListAtom;
+                    }
+                    else if (e->atom == XCB_ATOM_WM_NAME || e->atom == NetWMNameAtom) {
+                        auto w = Windows.find(e->window);
+                        if (w != Windows.end()) {
+                            w->second.NameChanged = true;
+                        }
+                    }
+                    break;
+                }
+                case XCB_CONFIGURE_NOTIFY: {
+                    // synthetic events from the window manager carry root coordinates, ask for the geometry instead of guessing
+                    auto e = reinterpret_cast<xcb_configure_notify_event_t *>(event);
+                    auto w = Windows.find(e->window);
+                    if (w != Windows.end()) {
+                        w->second.GeometryChanged = true;
+                    }
+                    break;
+                }
+                default:
+                    // errors for windows that went away before they were asked about, the next client list drops them
+                    break;
+                }
+                free(event);
+            }
         }
 
-        ~UniqueTextProperty()
+        void UpdateClientList()
         {
-            if (p.value) {
-                XFree(p.value);
+            auto reply = xcb_get_property_reply(Connection, xcb_get_property(Connection, 0, Root, ClientListAtom, XCB_ATOM_WINDOW, 0, UINT32_MAX),
+                                                nullptr);
+            ClientList.clear();
+            if (reply && reply->format == 32) {
+                auto data = static_cast<const xcb_window_t *>(xcb_get_property_value(reply));
+                ClientList.assign(data, data + xcb_get_property_value_length(reply) / sizeof(xcb_window_t));
+            }
+            free(reply);
+            ClientListChanged = false;
+
+            std::unordered_map<xcb_window_t, CachedWindow> windows;
+            windows.reserve(ClientList.size());
+            for (auto window : ClientList) {
+                auto w = Windows.find(window);
+                if (w != Windows.end()) {
+                    windows.emplace(window, w->second);
+                }
+                else {
+                    // listen before asking so nothing that happens in between is missed
+                    const uint32_t mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE;
+                    xcb_change_window_attributes(Connection, window, XCB_CW_EVENT_MASK, &mask);
+                    windows[window].Window.Handle = static_cast<size_t>(window);
+                }
             }
+            Windows.swap(windows);
         }
 
-        auto& get() {
-            return p;
+        void UpdateWindows()
+        {
+            struct Request {
+                CachedWindow *Window;
+                xcb_get_geometry_cookie_t Geometry;
+                xcb_get_property_cookie_t NetWMName;
+                xcb_get_property_cookie_t WMName;
+            };
+            // send everything first and only then wait for the answers, that is one round trip for all windows
+            std::vector<Request> requests;
+            for (auto &w : Windows) {
+                if (!w.second.GeometryChanged && !w.second.NameChanged) {
+                    continue;
+                }
+                Request r = {&w.second, {0}, {0}, {0}};
+                auto window = static_cast<xcb_window_t>(w.second.Window.Handle);
+                if (w.second.GeometryChanged) {
+                    r.Geometry = xcb_get_geometry(Connection, window);
+                }
+                if (w.second.NameChanged) {
+                    r.NetWMName = xcb_get_property(Connection, 0, window, NetWMNameAtom, XCB_GET_PROPERTY_TYPE_ANY, 0,
+                                                   sizeof(w.second.Window.Name) / 4);
+                    r.WMName = xcb_get_property(Connection, 0, window, XCB_ATOM_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0,
+                                                   sizeof(w.second.Window.Name) / 4);
+                }
+                requests.push_back(r);
+            }
+            for (auto &r : requests) {
+                auto &w = *r.Window;
+                if (w.GeometryChanged) {
+                    if (auto geometry = xcb_get_geometry_reply(Connection, r.Geometry, nullptr)) {
+                        w.Window.Position = SL::Screen_Capture::Point{geometry->x, geometry->y};
+                        w.Window.Size = SL::Screen_Capture::Point{geometry->width, geometry->height};
+                        free(geometry);
+                    }
+                    w.GeometryChanged = false;
+                }
+                if (w.NameChanged) {
+                    // _NET_WM_NAME is utf8, WM_NAME is what older clients set
+                    std::string name;
+                    for (auto cookie : {r.NetWMName, r.WMName}) {
+                        auto reply = xcb_get_property_reply(Connection, cookie, nullptr);
+                        if (reply && name.empty() && reply->format == 8) {
+                            name.assign(static_cast<const char *>(xcb_get_property_value(reply)), xcb_get_property_value_length(reply));
+                        }
+                        free(reply);
+                    }
+                    if (name.size() > sizeof(w.Window.Name) - 1) {
+                        name.resize(sizeof(w.Window.Name) - 1);
+                    }
+                    memset(w.Window.Name, 0, sizeof(w.Window.Name));
+                    // _NET_WM_NAME is utf-8, bytes above 0x7f are negative as char and must not reach tolower
+                    std::transform(name.begin(), name.end(), std::begin(w.Window.Name),
+                                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                    w.NameChanged = false;
+                }
+            }
         }
 
-    private:
-        XTextProperty p;
-    };
-
-    auto GetWMName(Display* display, Window window)
-    {
-        auto x = UniqueTextProperty{};
-        XGetWMName(display, window, &x.get());
-        return x;
-    }
-
-    auto TextPropertyToStrings(
-        Display* dpy,
-        const XTextProperty& prop
-    )
-    {
-        char **list;
-        auto n_strings = 0;
-        auto result = std::vector<std::string>{};
-
-        auto status = XmbTextPropertyToTextList(
-            dpy,
-            &prop,
-            &list,
-            &n_strings
-        );
-
-        if (status < Success or not n_strings or not *list) {
-            return result;
-        }
+      public:
+        ~WindowCache() { Disconnect(); }
 
-        for (auto i = 0; i < n_strings; ++i) {
-            result.emplace_back(list[i]);
+        std::vector<SL::Screen_Capture::Window> GetWindows()
+        {
+            std::lock_guard<std::mutex> lock(Lock);
+            if (Connection && xcb_connection_has_error(Connection)) {
+                Disconnect();
+            }
+            std::vector<SL::Screen_Capture::Window> ret;
+            if (!Connection && !Connect()) {
+                return ret;
+            }
+            ProcessEvents();
+            if (ClientListChanged) {
+                UpdateClientList();
+            }
+            UpdateWindows();
+            ret.reserve(ClientList.size());
+            for (auto window : ClientList) {
+                ret.push_back(Windows[window].Window);
+            }
+            return ret;
         }
+    };
+} // namespace
 
-        XFreeStringList(list);
-
-        return result;
-    }
-}
-
-namespace SL
-{
-namespace Screen_Capture
-{
-
-    void AddWindow(Display* display, XID& window, std::vector<Window>& wnd)
-    {
-        using namespace std::string_literals;
-
-        auto wm_name = GetWMName(display, window);
-        auto candidates = TextPropertyToStrings(display, wm_name.get());
-        Window w = {};
-        w.Handle = static_cast<size_t>( (size_t) window);
-
-        XWindowAttributes wndattr;
-        XGetWindowAttributes(display, window, &wndattr);
-
-        w.Position = Point{ wndattr.x, wndattr.y };
-        w.Size = Point{ wndattr.width, wndattr.height };
-		
-        auto name = candidates.empty() ? std::string() : std::move(candidates.front());
-        if (name.size() > sizeof(w.Name) - 1) {
-            name.resize(sizeof(w.Name) - 1);
-        }
-        std::transform(name.begin(), name.end(), std::begin(w.Name), ::tolower);
-        wnd.push_back(w);
-    }
+namespace SL {
+namespace Screen_Capture {
 
     std::vector<Window> GetWindows()
     {
-        auto* display = XOpenDisplay(NULL);
-        Atom a = XInternAtom(display, "_NET_CLIENT_LIST", true);
-        Atom actualType;
-        int format;
-        unsigned long numItems, bytesAfter;
-        unsigned char* data = 0;
-        int status = XGetWindowProperty(display,
-                                        XDefaultRootWindow(display),
-                                        a,
-                                        0L,
-                                        (~0L),
-                                        false,
-                                        AnyPropertyType,
-                                        &actualType,
-                                        &format,
-                                        &numItems,
-                                        &bytesAfter,
-                                        &data);
-        std::vector<Window> ret;
-        if(status >= Success && numItems) {
-            auto array = (XID*)data;
-            for(decltype(numItems) k = 0; k < numItems; k++) {
-                auto w = array[k];
-                AddWindow(display, w, ret);
-            }
-            XFree(data);
-        }
-        XCloseDisplay(display);
-        return ret;
+        static WindowCache cache;
+        return cache.GetWindows();
     }
-}
-}
+} // namespace Screen_Capture
+} // namespace SL
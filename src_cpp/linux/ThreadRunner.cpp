@@ -1,13 +1,29 @@
 #include "ScreenCapture.h"
+#include "X11RegionProcessor.h"
+#include "internal/ThreadManager.h"
+#if defined(SCREEN_CAPTURE_LITE_XCB)
+#include "XCBFrameProcessor.h"
+#include "XCBMouseProcessor.h"
+#else
 #include "X11FrameProcessor.h"
 #include "X11MouseProcessor.h"
-#include "internal/ThreadManager.h"
+#endif
 
 namespace SL {
 namespace Screen_Capture {
+#if defined(SCREEN_CAPTURE_LITE_XCB)
+    void RunCaptureMouse(std::shared_ptr<Thread_Data> data) { TryCaptureMouse<XCBMouseProcessor>(data); }
+    void RunCaptureMonitor(std::shared_ptr<Thread_Data> data, Monitor monitor) { TryCaptureMonitor<XCBFrameProcessor>(data, monitor); }
+    void RunCaptureWindow(std::shared_ptr<Thread_Data> data, Window window) { TryCaptureWindow<XCBFrameProcessor>(data, window); }
+#else
     void RunCaptureMouse(std::shared_ptr<Thread_Data> data) { TryCaptureMouse<X11MouseProcessor>(data); }
     void RunCaptureMonitor(std::shared_ptr<Thread_Data> data, Monitor monitor) { TryCaptureMonitor<X11FrameProcessor>(data, monitor); }
     void RunCaptureWindow(std::shared_ptr<Thread_Data> data, Window window) { TryCaptureWindow<X11FrameProcessor>(data, window); }
+#endif
+    void RunCaptureRegions(std::shared_ptr<Thread_Data> data, std::vector<Region> regions)
+    {
+        TryCaptureRegions<X11RegionProcessor>(data, regions);
+    }
     bool IsScreenCaptureEnabled() { return true; }/// need someone to implement this 
     void RequestScreenCapture() {}
     bool CanRequestScreenCapture() { return false; }
@@ -1,5 +1,5 @@
 #include "X11FrameProcessor.h"
-#include <X11/Xutil.h> 
+#include <X11/Xutil.h>
 #include <assert.h>
 #include <vector>
 
@@ -13,47 +13,130 @@ namespace Screen_Capture
 
     X11FrameProcessor::~X11FrameProcessor()
     {
-        if(ShmInfo) {
-            shmdt(ShmInfo->shmaddr);
-            shmctl(ShmInfo->shmid, IPC_RMID, 0);
-            XShmDetach(SelectedDisplay, ShmInfo.get());
+        FreeImage();
+        if(SelectedDisplay) {
+            // the redirection and the window pixmap belong to this connection, the server drops them when it closes
+            XCloseDisplay(SelectedDisplay);
         }
+    }
+
+    X11FrameBuffer::~X11FrameBuffer()
+    {
         if(XImage_) {
             XDestroyImage(XImage_);
         }
-        if(SelectedDisplay) {
-            XCloseDisplay(SelectedDisplay);
+        if(ShmInfo.shmaddr) {
+            shmdt(ShmInfo.shmaddr);
+        }
+    }
+
+    bool X11FrameProcessor::AllocateImage(Visual* visual, int depth, int width, int height, int count)
+    {
+        auto allocated = true;
+        for(auto i = 0; i < count; i++) {
+            auto buffer = std::make_shared<X11FrameBuffer>();
+            buffer->XImage_ = XShmCreateImage(SelectedDisplay,
+                                    visual,
+                                    depth,
+                                    ZPixmap,
+                                    NULL,
+                                    &buffer->ShmInfo,
+                                    width,
+                                    height);
+            if(!buffer->XImage_) {
+                allocated = false;
+                break;
+            }
+            buffer->ShmInfo.shmid = shmget(IPC_PRIVATE, buffer->XImage_->bytes_per_line * buffer->XImage_->height, IPC_CREAT | 0777);
+            auto shmaddr = buffer->ShmInfo.shmid < 0 ? reinterpret_cast<void*>(-1) : shmat(buffer->ShmInfo.shmid, 0, 0);
+            if(shmaddr == reinterpret_cast<void*>(-1)) {
+                // never attached, the buffer only has its image to destroy and the segment to remove
+                if(buffer->ShmInfo.shmid >= 0) {
+                    shmctl(buffer->ShmInfo.shmid, IPC_RMID, 0);
+                }
+                allocated = false;
+                break;
+            }
+            buffer->ShmInfo.readOnly = False;
+            buffer->ShmInfo.shmaddr = buffer->XImage_->data = static_cast<char*>(shmaddr);
+
+            XShmAttach(SelectedDisplay, &buffer->ShmInfo);
+            Buffers.push_back(buffer);
+        }
+        // once the server is attached the segments can be marked for removal, they go away with the last detach
+        XSync(SelectedDisplay, False);
+        for(auto& buffer : Buffers) {
+            shmctl(buffer->ShmInfo.shmid, IPC_RMID, 0);
+        }
+        NextBuffer = 0;
+        XImage_ = Buffers.empty() ? nullptr : Buffers.front()->XImage_;
+        return allocated;
+    }
+
+    void X11FrameProcessor::FreeImage()
+    {
+        for(auto& buffer : Buffers) {
+            XShmDetach(SelectedDisplay, &buffer->ShmInfo);
         }
+        if(!Buffers.empty()) {
+            // the server has to let go of the segments before they go away
+            XSync(SelectedDisplay, False);
+        }
+        // buffers consumers still hold stay mapped until they are released
+        Buffers.clear();
+        XImage_ = nullptr;
+        CurrentBuffer = nullptr;
+    }
+
+    bool X11FrameProcessor::NextImage()
+    {
+        for(size_t i = 0; i < Buffers.size(); i++) {
+            auto index = (NextBuffer + i) % Buffers.size();
+            if(!Buffers[index]->isHeld()) {
+                NextBuffer = (index + 1) % Buffers.size();
+                XImage_ = Buffers[index]->XImage_;
+                // with a single buffer the next frame overwrites this one right away, nothing can be held
+                CurrentBuffer = Buffers.size() > 1 ? Buffers[index].get() : nullptr;
+                return true;
+            }
+        }
+        return false;
     }
-    
+
     DUPL_RETURN X11FrameProcessor::Init(std::shared_ptr<Thread_Data> data, const Window& selectedwindow){
-        
+
         auto ret = DUPL_RETURN::DUPL_RETURN_SUCCESS;
-        Data = data; 
+        Data = data;
         SelectedDisplay = XOpenDisplay(NULL);
         SelectedWindow = selectedwindow.Handle;
         if(!SelectedDisplay) {
             return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
         }
-        int scr = XDefaultScreen(SelectedDisplay);
-
-        ShmInfo = std::make_unique<XShmSegmentInfo>();
-
-        XImage_ = XShmCreateImage(SelectedDisplay,
-                                DefaultVisual(SelectedDisplay, scr),
-                                DefaultDepth(SelectedDisplay, scr),
-                                ZPixmap,
-                                NULL,
-                                ShmInfo.get(),
-                                selectedwindow.Size.x,
-                                selectedwindow.Size.y);
-        ShmInfo->shmid = shmget(IPC_PRIVATE, XImage_->bytes_per_line * XImage_->height, IPC_CREAT | 0777);
-
-        ShmInfo->readOnly = False;
-        ShmInfo->shmaddr = XImage_->data = (char*)shmat(ShmInfo->shmid, 0, 0);
-
-        XShmAttach(SelectedDisplay, ShmInfo.get());
+        XWindowAttributes wndattr;
+        if(XGetWindowAttributes(SelectedDisplay, SelectedWindow, &wndattr) == 0) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;//window might not be valid any more
+        }
+        // resizes, unmaps and the end of the window arrive as events, so no round trip per frame is needed to notice them
+        XSelectInput(SelectedDisplay, SelectedWindow, StructureNotifyMask);
+        WindowVisual = wndattr.visual;
+        WindowDepth = wndattr.depth;
+        Mapped = wndattr.map_state == IsViewable;
 
+#if defined(SCREEN_CAPTURE_LITE_XCOMPOSITE)
+        int eventbase = 0, errorbase = 0, major = 0, minor = 2;
+        if(XCompositeQueryExtension(SelectedDisplay, &eventbase, &errorbase) && XCompositeQueryVersion(SelectedDisplay, &major, &minor) &&
+           (major > 0 || minor >= 2)) {
+            // the server keeps an offscreen copy of the window, the parts covered by other windows or off screen included
+            XCompositeRedirectWindow(SelectedDisplay, SelectedWindow, CompositeRedirectAutomatic);
+            Redirected = true;
+        }
+#endif
+        // the window may have changed size since it was enumerated, the first frame catches up
+        if(!AllocateImage(WindowVisual, WindowDepth, wndattr.width, wndattr.height, Data->WindowCaptureData.FrameBufferCount)) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+        }
+        int fixesevent = 0, fixeserror = 0;
+        HasXFixes = XFixesQueryExtension(SelectedDisplay, &fixesevent, &fixeserror);
         return ret;
     }
     DUPL_RETURN X11FrameProcessor::Init(std::shared_ptr<Thread_Data> data, Monitor& monitor)
@@ -66,30 +149,38 @@ namespace Screen_Capture
             return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
         }
         int scr = XDefaultScreen(SelectedDisplay);
-
-        ShmInfo = std::make_unique<XShmSegmentInfo>();
-
-        XImage_ = XShmCreateImage(SelectedDisplay,
-                                DefaultVisual(SelectedDisplay, scr),
-                                DefaultDepth(SelectedDisplay, scr),
-                                ZPixmap,
-                                NULL,
-                                ShmInfo.get(),
-                                Width(SelectedMonitor),
-                                Height(SelectedMonitor));
-        ShmInfo->shmid = shmget(IPC_PRIVATE, XImage_->bytes_per_line * XImage_->height, IPC_CREAT | 0777);
-
-        ShmInfo->readOnly = False;
-        ShmInfo->shmaddr = XImage_->data = (char*)shmat(ShmInfo->shmid, 0, 0);
-
-        XShmAttach(SelectedDisplay, ShmInfo.get());
-
+        if(!AllocateImage(DefaultVisual(SelectedDisplay, scr), DefaultDepth(SelectedDisplay, scr), Width(SelectedMonitor), Height(SelectedMonitor),
+                          Data->ScreenCaptureData.FrameBufferCount)) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+        }
+        int fixesevent = 0, fixeserror = 0;
+        HasXFixes = XFixesQueryExtension(SelectedDisplay, &fixesevent, &fixeserror);
         return ret;
     }
- 
+
+    void X11FrameProcessor::ReadCursor(int x, int y)
+    {
+        auto img = HasXFixes ? XFixesGetCursorImage(SelectedDisplay) : nullptr;
+        Cursor.Visible = img != nullptr;
+        if(!img) {
+            return;
+        }
+        // the image only comes over again when the cursor changed, converting it is left for then
+        if(img->cursor_serial != Cursor.Serial || Cursor.Pixels.empty()) {
+            Cursor.Serial = img->cursor_serial;
+            SetCursorImage(Cursor, img->width, img->height, img->pixels);
+        }
+        Cursor.HotSpot = Point{img->xhot, img->yhot};
+        Cursor.Position = Point{img->x - x, img->y - y};
+        XFree(img);
+    }
+
     DUPL_RETURN X11FrameProcessor::ProcessFrame(const Monitor& curentmonitorinfo)
-    {        
+    {
         auto Ret = DUPL_RETURN_SUCCESS;
+        if(!NextImage()) {
+            return Ret;// consumers hold every buffer, skip this frame
+        }
         if(!XShmGetImage(SelectedDisplay,
                          RootWindow(SelectedDisplay, DefaultScreen(SelectedDisplay)),
                          XImage_,
@@ -98,29 +189,116 @@ namespace Screen_Capture
                          AllPlanes)) {
             return DUPL_RETURN_ERROR_EXPECTED;
         }
+        CaptureTime = MonotonicTime();
+        if(Data->ScreenCaptureData.CompositeCursor) {
+            // every frame is read again, so the cursor never has to be taken out of the image
+            ReadCursor(OffsetX(SelectedMonitor), OffsetY(SelectedMonitor));
+            DrawCursor((unsigned char*)XImage_->data, XImage_->bytes_per_line, XImage_->width, XImage_->height, Cursor);
+        }
         ProcessCapture(Data->ScreenCaptureData, *this, SelectedMonitor, (unsigned char*)XImage_->data, XImage_->bytes_per_line);
         return Ret;
     }
+
+    DUPL_RETURN X11FrameProcessor::ResizeWindowImage(Window& selectedwindow, int width, int height)
+    {
+#if defined(SCREEN_CAPTURE_LITE_XCOMPOSITE)
+        if(Redirected) {
+            // every resize or map gives the window a new backing pixmap, the old one keeps the old contents
+            if(WindowPixmap) {
+                XFreePixmap(SelectedDisplay, WindowPixmap);
+            }
+            WindowPixmap = XCompositeNameWindowPixmap(SelectedDisplay, SelectedWindow);
+            // the window can change again before the pixmap is named, the pixmap is what is read
+            ::Window root;
+            int x, y;
+            unsigned int w, h, border, depth;
+            if(!XGetGeometry(SelectedDisplay, WindowPixmap, &root, &x, &y, &w, &h, &border, &depth)) {
+                return DUPL_RETURN_ERROR_EXPECTED;
+            }
+            width = static_cast<int>(w);
+            height = static_cast<int>(h);
+        }
+#endif
+        if(width != XImage_->width || height != XImage_->height) {
+            FreeImage();
+            if(!AllocateImage(WindowVisual, WindowDepth, width, height, Data->WindowCaptureData.FrameBufferCount)) {
+                return DUPL_RETURN_ERROR_EXPECTED;
+            }
+        }
+        if(width != selectedwindow.Size.x || height != selectedwindow.Size.y) {
+            selectedwindow.Size.x = width;
+            selectedwindow.Size.y = height;
+            // the difs start over at the new size
+            ImageBufferSize = width * height * static_cast<int>(sizeof(ImageBGRA));
+            if(ImageBuffer) {
+                ImageBuffer = std::make_unique<unsigned char[]>(ImageBufferSize);
+            }
+            FirstRun = true;
+        }
+        return DUPL_RETURN_SUCCESS;
+    }
+
     DUPL_RETURN X11FrameProcessor::ProcessFrame(Window& selectedwindow){
-        
-        auto Ret = DUPL_RETURN_SUCCESS; 
-        XWindowAttributes wndattr;
-        if(XGetWindowAttributes(SelectedDisplay, SelectedWindow, &wndattr) ==0){
-            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;//window might not be valid any more
+
+        auto Ret = DUPL_RETURN_SUCCESS;
+        auto width = XImage_->width;
+        auto height = XImage_->height;
+        auto changed = (Redirected && !WindowPixmap) || width != selectedwindow.Size.x || height != selectedwindow.Size.y;
+        while(XPending(SelectedDisplay)) {
+            XEvent ev;
+            XNextEvent(SelectedDisplay, &ev);
+            if(ev.xany.window != SelectedWindow) {
+                continue;
+            }
+            switch(ev.type) {
+            case ConfigureNotify:
+                changed |= ev.xconfigure.width != XImage_->width || ev.xconfigure.height != XImage_->height;
+                width = ev.xconfigure.width;
+                height = ev.xconfigure.height;
+                break;
+            case MapNotify:
+                Mapped = changed = true;
+                break;
+            case UnmapNotify:
+                Mapped = false;
+                break;
+            case DestroyNotify:
+                return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;//window is gone
+            default:
+                break;
+            }
         }
-        if(wndattr.width != Width(selectedwindow) || wndattr.height != Height(selectedwindow)){
-            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;//window size changed. This will rebuild everything
+        if(!Mapped) {
+            return Ret;// nothing to read until it is shown again
+        }
+        if(changed) {
+            // the image is reallocated in place, no need to rebuild everything
+            Ret = ResizeWindowImage(selectedwindow, width, height);
+            if(Ret != DUPL_RETURN_SUCCESS) {
+                return Ret;
+            }
+        }
+        if(!NextImage()) {
+            return Ret;// consumers hold every buffer, skip this frame
         }
         if(!XShmGetImage(SelectedDisplay,
-                         selectedwindow.Handle,
+                         Redirected ? WindowPixmap : SelectedWindow,
                          XImage_,
                          0,
                          0,
                          AllPlanes)) {
             return DUPL_RETURN_ERROR_EXPECTED;
         }
+        CaptureTime = MonotonicTime();
+        if(Data->WindowCaptureData.CompositeCursor) {
+            int x = 0, y = 0;
+            ::Window child;
+            XTranslateCoordinates(SelectedDisplay, SelectedWindow, DefaultRootWindow(SelectedDisplay), 0, 0, &x, &y, &child);
+            ReadCursor(x, y);
+            DrawCursor((unsigned char*)XImage_->data, XImage_->bytes_per_line, XImage_->width, XImage_->height, Cursor);
+        }
         ProcessCapture(Data->WindowCaptureData, *this, selectedwindow, (unsigned char*)XImage_->data, XImage_->bytes_per_line);
         return Ret;
     }
 }
-}
\ No newline at end of file
+}
@@ -34,7 +34,7 @@ namespace Screen_Capture {
     DUPL_RETURN X11MouseProcessor::ProcessFrame()
     {
         auto Ret = DUPL_RETURN_SUCCESS;
-        if (Data->ScreenCaptureData.OnMouseChanged || Data->WindowCaptureData.OnMouseChanged) {
+        if (Data->ScreenCaptureData.OnMouseChanged || Data->WindowCaptureData.OnMouseChanged || Data->RegionCaptureData.OnMouseChanged) {
             auto img = XFixesGetCursorImage(SelectedDisplay);
 
             if (sizeof(img->pixels[0]) == 8) { // if the pixelstride is 64 bits.. scale down to 32bits
@@ -74,6 +74,9 @@ namespace Screen_Capture {
                 if (Data->ScreenCaptureData.OnMouseChanged) {
                     Data->ScreenCaptureData.OnMouseChanged(&wholeimg, mousepoint);
                 }
+                if (Data->RegionCaptureData.OnMouseChanged) {
+                    Data->RegionCaptureData.OnMouseChanged(&wholeimg, mousepoint);
+                }
                 if (Data->WindowCaptureData.OnMouseChanged) {
                     Data->WindowCaptureData.OnMouseChanged(&wholeimg, mousepoint);
                 }
@@ -83,6 +86,9 @@ namespace Screen_Capture {
                 if (Data->ScreenCaptureData.OnMouseChanged) {
                     Data->ScreenCaptureData.OnMouseChanged(nullptr, mousepoint);
                 }
+                if (Data->RegionCaptureData.OnMouseChanged) {
+                    Data->RegionCaptureData.OnMouseChanged(nullptr, mousepoint);
+                }
                 if (Data->WindowCaptureData.OnMouseChanged) {
                     Data->WindowCaptureData.OnMouseChanged(nullptr, mousepoint);
                 }
@@ -0,0 +1,81 @@
+#include "X11RegionProcessor.h"
+#include <X11/Xutil.h>
+
+namespace SL
+{
+namespace Screen_Capture
+{
+    X11RegionProcessor::~X11RegionProcessor()
+    {
+        for(auto& c : Clusters) {
+            if(c.ShmInfo.shmaddr) {
+                XShmDetach(SelectedDisplay, &c.ShmInfo);
+                shmdt(c.ShmInfo.shmaddr);
+                shmctl(c.ShmInfo.shmid, IPC_RMID, 0);
+            }
+            if(c.XImage_) {
+                c.XImage_->data = nullptr; // the shared memory is not owned by the image
+                XDestroyImage(c.XImage_);
+            }
+        }
+        if(SelectedDisplay) {
+            XCloseDisplay(SelectedDisplay);
+        }
+    }
+
+    DUPL_RETURN X11RegionProcessor::Init(std::shared_ptr<Thread_Data>, const std::vector<RegionCluster>& clusters)
+    {
+        SelectedDisplay = XOpenDisplay(NULL);
+        if(!SelectedDisplay) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+        }
+        int scr = XDefaultScreen(SelectedDisplay);
+        Clusters.resize(clusters.size());
+        for(size_t i = 0; i < clusters.size(); i++) {
+            auto& c = Clusters[i];
+            c.Bounds = clusters[i].Bounds;
+            c.XImage_ = XShmCreateImage(SelectedDisplay,
+                                        DefaultVisual(SelectedDisplay, scr),
+                                        DefaultDepth(SelectedDisplay, scr),
+                                        ZPixmap,
+                                        NULL,
+                                        &c.ShmInfo,
+                                        Width(c.Bounds),
+                                        Height(c.Bounds));
+            if(!c.XImage_) {
+                return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+            }
+            c.ShmInfo.shmid = shmget(IPC_PRIVATE, c.XImage_->bytes_per_line * c.XImage_->height, IPC_CREAT | 0777);
+            if(c.ShmInfo.shmid < 0) {
+                return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+            }
+            c.ShmInfo.readOnly = False;
+            auto shmaddr = shmat(c.ShmInfo.shmid, 0, 0);
+            if(shmaddr == reinterpret_cast<void*>(-1)) {
+                // nothing to detach in the destructor, only the segment to remove
+                shmctl(c.ShmInfo.shmid, IPC_RMID, 0);
+                return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+            }
+            c.ShmInfo.shmaddr = c.XImage_->data = static_cast<char*>(shmaddr);
+            XShmAttach(SelectedDisplay, &c.ShmInfo);
+        }
+        return DUPL_RETURN::DUPL_RETURN_SUCCESS;
+    }
+
+    DUPL_RETURN X11RegionProcessor::ProcessFrame(size_t index, const unsigned char*& data, int& rowstride)
+    {
+        auto& c = Clusters[index];
+        if(!XShmGetImage(SelectedDisplay,
+                         RootWindow(SelectedDisplay, DefaultScreen(SelectedDisplay)),
+                         c.XImage_,
+                         c.Bounds.left,
+                         c.Bounds.top,
+                         AllPlanes)) {
+            return DUPL_RETURN_ERROR_EXPECTED;
+        }
+        data = reinterpret_cast<const unsigned char*>(c.XImage_->data);
+        rowstride = c.XImage_->bytes_per_line;
+        return DUPL_RETURN_SUCCESS;
+    }
+}
+}
@@ -0,0 +1,378 @@
+#include "XCBFrameProcessor.h"
+#include <cstdlib>
+#include <sys/shm.h>
+#include <vector>
+
+namespace SL {
+namespace Screen_Capture {
+
+    namespace {
+        bool Intersects(const xcb_rectangle_t &a, const xcb_rectangle_t &b)
+        {
+            return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+        }
+    } // namespace
+
+    XCBFrameBuffer::~XCBFrameBuffer()
+    {
+        if (ShmData) {
+            shmdt(ShmData);
+        }
+    }
+
+    XCBFrameProcessor::~XCBFrameProcessor()
+    {
+        if (Connection) {
+            FreeImage();
+            // the damage object, the redirection and the window pixmap go away with the connection
+            xcb_disconnect(Connection);
+        }
+    }
+
+    DUPL_RETURN XCBFrameProcessor::Connect()
+    {
+        Connection = xcb_connect(nullptr, nullptr);
+        if (xcb_connection_has_error(Connection)) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+        }
+        Root = xcb_setup_roots_iterator(xcb_get_setup(Connection)).data->root;
+        // the extensions have to be asked for their version before they can be used, all of them in one round trip
+        auto shmcookie = xcb_shm_query_version(Connection);
+        auto damagecookie = xcb_damage_query_version(Connection, XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION);
+        auto compositecookie = xcb_composite_query_version(Connection, 0, 2);
+        auto xfixescookie = xcb_xfixes_query_version(Connection, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION);
+        auto shm = xcb_shm_query_version_reply(Connection, shmcookie, nullptr);
+        auto damage = xcb_damage_query_version_reply(Connection, damagecookie, nullptr);
+        auto composite = xcb_composite_query_version_reply(Connection, compositecookie, nullptr);
+        auto xfixes = xcb_xfixes_query_version_reply(Connection, xfixescookie, nullptr);
+        if (damage) {
+            DamageNotify = xcb_get_extension_data(Connection, &xcb_damage_id)->first_event + XCB_DAMAGE_NOTIFY;
+            Damage = xcb_generate_id(Connection);
+        }
+        Redirected = composite && (composite->major_version > 0 || composite->minor_version >= 2);
+        HasXFixes = xfixes != nullptr;
+        auto ret = shm ? DUPL_RETURN::DUPL_RETURN_SUCCESS : DUPL_RETURN::DUPL_RETURN_ERROR_UNEXPECTED;
+        free(shm);
+        free(damage);
+        free(composite);
+        free(xfixes);
+        return ret;
+    }
+
+    bool XCBFrameProcessor::AllocateImage(int width, int height, int count)
+    {
+        std::vector<int> shmids;
+        auto allocated = true;
+        for (auto i = 0; i < count; i++) {
+            auto shmid = shmget(IPC_PRIVATE, static_cast<size_t>(width) * height * sizeof(ImageBGRA), IPC_CREAT | 0777);
+            auto shmdata = shmid < 0 ? reinterpret_cast<void *>(-1) : shmat(shmid, 0, 0);
+            if (shmdata == reinterpret_cast<void *>(-1)) {
+                if (shmid >= 0) {
+                    shmctl(shmid, IPC_RMID, 0);
+                }
+                allocated = false;
+                break;
+            }
+            auto buffer = std::make_shared<XCBFrameBuffer>();
+            buffer->ShmData = static_cast<unsigned char *>(shmdata);
+            buffer->ShmSeg = xcb_generate_id(Connection);
+            xcb_shm_attach(Connection, buffer->ShmSeg, shmid, 0);
+            Buffers.push_back(buffer);
+            shmids.push_back(shmid);
+        }
+        // once the server is attached the segments can be marked for removal, they go away with the last detach
+        free(xcb_get_input_focus_reply(Connection, xcb_get_input_focus(Connection), nullptr));
+        for (auto shmid : shmids) {
+            shmctl(shmid, IPC_RMID, 0);
+        }
+        ImageWidth = width;
+        ImageHeight = height;
+        NextBuffer = 0;
+        return allocated;
+    }
+
+    void XCBFrameProcessor::FreeImage()
+    {
+        for (auto &buffer : Buffers) {
+            xcb_shm_detach(Connection, buffer->ShmSeg);
+        }
+        if (!Buffers.empty()) {
+            // the server has to let go of the segments before they go away
+            free(xcb_get_input_focus_reply(Connection, xcb_get_input_focus(Connection), nullptr));
+        }
+        // buffers consumers still hold stay mapped until they are released
+        Buffers.clear();
+        Buffer = nullptr;
+        CurrentBuffer = nullptr;
+        CursorInImage = false;
+    }
+
+    bool XCBFrameProcessor::NextImage()
+    {
+        for (size_t i = 0; i < Buffers.size(); i++) {
+            auto index = (NextBuffer + i) % Buffers.size();
+            if (!Buffers[index]->isHeld()) {
+                NextBuffer = (index + 1) % Buffers.size();
+                Buffer = Buffers[index].get();
+                // with a single buffer the next read overwrites this one right away, nothing can be held
+                CurrentBuffer = Buffers.size() > 1 ? Buffer : nullptr;
+                CursorInImage = false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void XCBFrameProcessor::ProcessEvents(const xcb_rectangle_t &bounds)
+    {
+        while (auto event = xcb_poll_for_event(Connection)) {
+            auto type = event->response_type & ~0x80;
+            if (Damage && type == DamageNotify) {
+                auto e = reinterpret_cast<xcb_damage_notify_event_t *>(event);
+                Damaged |= e->damage == Damage && Intersects(e->area, bounds);
+            }
+            else if (type == XCB_CONFIGURE_NOTIFY) {
+                auto e = reinterpret_cast<xcb_configure_notify_event_t *>(event);
+                Resized |= e->window == SelectedWindow && (e->width != ImageWidth || e->height != ImageHeight);
+            }
+            else if (type == XCB_MAP_NOTIFY) {
+                // a mapped window gets a new composite pixmap
+                Mapped = Resized = true;
+            }
+            else if (type == XCB_UNMAP_NOTIFY) {
+                Mapped = false;
+            }
+            else if (type == XCB_DESTROY_NOTIFY) {
+                Destroyed = true;
+            }
+            free(event);
+        }
+    }
+
+    void XCBFrameProcessor::DrawCursor()
+    {
+        // the cursor and where the window is go out together, a monitor starts at its offset
+        auto imagecookie = xcb_xfixes_get_cursor_image(Connection);
+        xcb_translate_coordinates_cookie_t origincookie = {0};
+        if (SelectedWindow) {
+            origincookie = xcb_translate_coordinates(Connection, SelectedWindow, Root, 0, 0);
+        }
+        auto img = xcb_xfixes_get_cursor_image_reply(Connection, imagecookie, nullptr);
+        auto origin = SelectedWindow ? xcb_translate_coordinates_reply(Connection, origincookie, nullptr) : nullptr;
+        Cursor.Visible = img && (origin || !SelectedWindow);
+        if (Cursor.Visible) {
+            // the image only comes over again when the cursor changed, converting it is left for then
+            if (img->cursor_serial != Cursor.Serial || Cursor.Pixels.empty()) {
+                Cursor.Serial = img->cursor_serial;
+                SetCursorImage(Cursor, img->width, img->height, xcb_xfixes_get_cursor_image_cursor_image(img));
+            }
+            Cursor.HotSpot = Point{img->xhot, img->yhot};
+            Cursor.Position = origin ? Point{img->x - origin->dst_x, img->y - origin->dst_y}
+                                     : Point{img->x - OffsetX(SelectedMonitor), img->y - OffsetY(SelectedMonitor)};
+        }
+        free(img);
+        free(origin);
+        Screen_Capture::DrawCursor(Buffer->ShmData, RowStride(), ImageWidth, ImageHeight, Cursor);
+    }
+
+    DUPL_RETURN XCBFrameProcessor::Init(std::shared_ptr<Thread_Data> data, Monitor &monitor)
+    {
+        Data = data;
+        SelectedMonitor = monitor;
+        auto ret = Connect();
+        if (ret != DUPL_RETURN_SUCCESS) {
+            return ret;
+        }
+        Source = Root;
+        if (Damage) {
+            // the root reports damage anywhere on the desktop, ProcessEvents only keeps what hits this monitor
+            xcb_damage_create(Connection, Damage, Root, XCB_DAMAGE_REPORT_LEVEL_BOUNDING_BOX);
+        }
+        if (!AllocateImage(Width(SelectedMonitor), Height(SelectedMonitor), Data->ScreenCaptureData.FrameBufferCount)) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+        }
+        return ret;
+    }
+
+    DUPL_RETURN XCBFrameProcessor::ProcessFrame(const Monitor &)
+    {
+        const xcb_rectangle_t bounds = {static_cast<int16_t>(OffsetX(SelectedMonitor)), static_cast<int16_t>(OffsetY(SelectedMonitor)),
+                                        static_cast<uint16_t>(ImageWidth), static_cast<uint16_t>(ImageHeight)};
+        ProcessEvents(bounds);
+        const auto cursor = HasXFixes && Data->ScreenCaptureData.CompositeCursor;
+        if (NeedsRead(cursor)) {
+            if (!NextImage()) {
+                return DUPL_RETURN_SUCCESS; // consumers hold every buffer, skip this frame
+            }
+            // repaired before the read, so whatever changes while it runs shows up for the next frame
+            if (Damage) {
+                xcb_damage_subtract(Connection, Damage, XCB_NONE, XCB_NONE);
+            }
+            auto image = xcb_shm_get_image_reply(Connection,
+                                                 xcb_shm_get_image(Connection, Source, bounds.x, bounds.y, bounds.width, bounds.height, ~0u,
+                                                                   XCB_IMAGE_FORMAT_Z_PIXMAP, Buffer->ShmSeg, 0),
+                                                 nullptr);
+            if (!image) {
+                return DUPL_RETURN_ERROR_EXPECTED;
+            }
+            CaptureTime = MonotonicTime();
+            free(image);
+            Damaged = !Damage;
+        }
+        // without damage the image from the last read is still what is on screen
+        if (cursor) {
+            DrawCursor();
+        }
+        ProcessCapture(Data->ScreenCaptureData, *this, SelectedMonitor, Buffer->ShmData, RowStride());
+        if (cursor) {
+            // the image is handed out again as long as nothing is damaged, it has to be without the cursor then. A held frame keeps it
+            if (Buffer->isHeld()) {
+                CursorInImage = true;
+            }
+            else {
+                EraseCursor(Buffer->ShmData, RowStride(), Cursor);
+            }
+        }
+        return DUPL_RETURN_SUCCESS;
+    }
+
+    DUPL_RETURN XCBFrameProcessor::Init(std::shared_ptr<Thread_Data> data, const Window &selectedwindow)
+    {
+        Data = data;
+        SelectedWindow = static_cast<xcb_window_t>(selectedwindow.Handle);
+        auto ret = Connect();
+        if (ret != DUPL_RETURN_SUCCESS) {
+            return ret;
+        }
+        // resizes, unmaps and the end of the window arrive as events
+        const uint32_t mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+        auto attributescookie = xcb_get_window_attributes(Connection, SelectedWindow);
+        auto geometrycookie = xcb_get_geometry(Connection, SelectedWindow);
+        xcb_change_window_attributes(Connection, SelectedWindow, XCB_CW_EVENT_MASK, &mask);
+        if (Redirected) {
+            // the server keeps an offscreen copy of the window, the parts covered by other windows or off screen included
+            xcb_composite_redirect_window(Connection, SelectedWindow, XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+        }
+        if (Damage) {
+            xcb_damage_create(Connection, Damage, SelectedWindow, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+        }
+        auto attributes = xcb_get_window_attributes_reply(Connection, attributescookie, nullptr);
+        auto geometry = xcb_get_geometry_reply(Connection, geometrycookie, nullptr);
+        if (!attributes || !geometry) {
+            free(attributes);
+            free(geometry);
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED; // window might not be valid any more
+        }
+        Mapped = attributes->map_state == XCB_MAP_STATE_VIEWABLE;
+        // the first frame names the pixmap and catches up if the window changed size since it was enumerated
+        Resized = true;
+        Source = SelectedWindow;
+        auto allocated = AllocateImage(geometry->width, geometry->height, Data->WindowCaptureData.FrameBufferCount);
+        free(attributes);
+        free(geometry);
+        return allocated ? ret : DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+    }
+
+    DUPL_RETURN XCBFrameProcessor::ResizeWindowImage(Window &selectedwindow)
+    {
+        if (Redirected) {
+            // every resize or map gives the window a new backing pixmap, the old one keeps the old contents
+            if (WindowPixmap) {
+                xcb_free_pixmap(Connection, WindowPixmap);
+            }
+            WindowPixmap = xcb_generate_id(Connection);
+            xcb_composite_name_window_pixmap(Connection, SelectedWindow, WindowPixmap);
+            Source = WindowPixmap;
+        }
+        // the window can change again before the pixmap is named, the size of what is read counts
+        auto geometry = xcb_get_geometry_reply(Connection, xcb_get_geometry(Connection, Source), nullptr);
+        if (!geometry) {
+            return DUPL_RETURN_ERROR_EXPECTED;
+        }
+        int width = geometry->width;
+        int height = geometry->height;
+        free(geometry);
+        if (width != ImageWidth || height != ImageHeight) {
+            FreeImage();
+            if (!AllocateImage(width, height, Data->WindowCaptureData.FrameBufferCount)) {
+                return DUPL_RETURN_ERROR_EXPECTED;
+            }
+        }
+        if (width != selectedwindow.Size.x || height != selectedwindow.Size.y) {
+            selectedwindow.Size.x = width;
+            selectedwindow.Size.y = height;
+            // the difs start over at the new size
+            ImageBufferSize = width * height * static_cast<int>(sizeof(ImageBGRA));
+            if (ImageBuffer) {
+                ImageBuffer = std::make_unique<unsigned char[]>(ImageBufferSize);
+            }
+            FirstRun = true;
+        }
+        Resized = false;
+        Damaged = true;
+        return DUPL_RETURN_SUCCESS;
+    }
+
+    DUPL_RETURN XCBFrameProcessor::ProcessFrame(Window &selectedwindow)
+    {
+        const xcb_rectangle_t bounds = {0, 0, static_cast<uint16_t>(ImageWidth), static_cast<uint16_t>(ImageHeight)};
+        ProcessEvents(bounds);
+        if (Destroyed) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED; // window is gone
+        }
+        if (!Mapped) {
+            return DUPL_RETURN_SUCCESS; // nothing to read until it is shown again
+        }
+        if (Resized || selectedwindow.Size.x != ImageWidth || selectedwindow.Size.y != ImageHeight) {
+            // the image is reallocated in place, no need to rebuild everything
+            auto ret = ResizeWindowImage(selectedwindow);
+            if (ret != DUPL_RETURN_SUCCESS) {
+                return ret;
+            }
+        }
+        const auto cursor = HasXFixes && Data->WindowCaptureData.CompositeCursor;
+        if (NeedsRead(cursor)) {
+            if (!NextImage()) {
+                return DUPL_RETURN_SUCCESS; // consumers hold every buffer, skip this frame
+            }
+            if (Damage) {
+                xcb_damage_subtract(Connection, Damage, XCB_NONE, XCB_NONE);
+            }
+            // the size check and the read go out together, a size that changed in between only throws this read away
+            auto geometrycookie = xcb_get_geometry(Connection, SelectedWindow);
+            auto imagecookie = xcb_shm_get_image(Connection, Source, 0, 0, static_cast<uint16_t>(ImageWidth), static_cast<uint16_t>(ImageHeight),
+                                                 ~0u, XCB_IMAGE_FORMAT_Z_PIXMAP, Buffer->ShmSeg, 0);
+            auto geometry = xcb_get_geometry_reply(Connection, geometrycookie, nullptr);
+            auto image = xcb_shm_get_image_reply(Connection, imagecookie, nullptr);
+            if (!geometry) {
+                free(image);
+                return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED; // window might not be valid any more
+            }
+            Resized = geometry->width != ImageWidth || geometry->height != ImageHeight;
+            free(geometry);
+            if (!image || Resized) {
+                free(image);
+                Damaged = true;
+                return DUPL_RETURN_SUCCESS;
+            }
+            CaptureTime = MonotonicTime();
+            free(image);
+            Damaged = !Damage;
+        }
+        if (cursor) {
+            DrawCursor();
+        }
+        ProcessCapture(Data->WindowCaptureData, *this, selectedwindow, Buffer->ShmData, RowStride());
+        if (cursor) {
+            if (Buffer->isHeld()) {
+                CursorInImage = true;
+            }
+            else {
+                EraseCursor(Buffer->ShmData, RowStride(), Cursor);
+            }
+        }
+        return DUPL_RETURN_SUCCESS;
+    }
+
+} // namespace Screen_Capture
+} // namespace SL
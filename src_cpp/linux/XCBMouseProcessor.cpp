@@ -0,0 +1,108 @@
+#include "XCBMouseProcessor.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace SL {
+namespace Screen_Capture {
+
+    XCBMouseProcessor::~XCBMouseProcessor()
+    {
+        if (Connection) {
+            xcb_disconnect(Connection);
+        }
+    }
+
+    DUPL_RETURN XCBMouseProcessor::Init(std::shared_ptr<Thread_Data> data)
+    {
+        Data = data;
+        Connection = xcb_connect(nullptr, nullptr);
+        if (xcb_connection_has_error(Connection)) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+        }
+        Root = xcb_setup_roots_iterator(xcb_get_setup(Connection)).data->root;
+        auto version = xcb_xfixes_query_version_reply(
+            Connection, xcb_xfixes_query_version(Connection, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION), nullptr);
+        if (!version) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_UNEXPECTED;
+        }
+        free(version);
+        CursorNotify = xcb_get_extension_data(Connection, &xcb_xfixes_id)->first_event + XCB_XFIXES_CURSOR_NOTIFY;
+        xcb_xfixes_select_cursor_input(Connection, Root, XCB_XFIXES_CURSOR_NOTIFY_MASK_DISPLAY_CURSOR);
+        return DUPL_RETURN::DUPL_RETURN_SUCCESS;
+    }
+
+    DUPL_RETURN XCBMouseProcessor::ProcessFrame()
+    {
+        if (!Data->ScreenCaptureData.OnMouseChanged && !Data->WindowCaptureData.OnMouseChanged && !Data->RegionCaptureData.OnMouseChanged) {
+            return DUPL_RETURN_SUCCESS;
+        }
+        while (auto event = xcb_poll_for_event(Connection)) {
+            CursorChanged |= (event->response_type & ~0x80) == CursorNotify;
+            free(event);
+        }
+        // the position and, if the cursor changed, its image go out together
+        auto pointercookie = xcb_query_pointer(Connection, Root);
+        xcb_xfixes_get_cursor_image_cookie_t imagecookie = {0};
+        const auto cursorchanged = CursorChanged;
+        if (cursorchanged) {
+            imagecookie = xcb_xfixes_get_cursor_image(Connection);
+        }
+        auto pointer = xcb_query_pointer_reply(Connection, pointercookie, nullptr);
+        auto img = cursorchanged ? xcb_xfixes_get_cursor_image_reply(Connection, imagecookie, nullptr) : nullptr;
+        if (!pointer || (cursorchanged && !img)) {
+            free(pointer);
+            free(img);
+            return DUPL_RETURN_ERROR_EXPECTED;
+        }
+        MousePoint mousepoint = {};
+        mousepoint.Position = Point{pointer->root_x, pointer->root_y};
+        free(pointer);
+
+        if (img) {
+            CursorChanged = false;
+            HotSpot = Point{img->xhot, img->yhot};
+            mousepoint.HotSpot = HotSpot;
+            ImageRect imgrect;
+            imgrect.left = imgrect.top = 0;
+            imgrect.right = img->width;
+            imgrect.bottom = img->height;
+            auto newsize = static_cast<int>(sizeof(ImageBGRA)) * imgrect.right * imgrect.bottom;
+            if (newsize > ImageBufferSize || !ImageBuffer) {
+                ImageBuffer = std::make_unique<unsigned char[]>(newsize);
+                ImageBufferSize = newsize;
+            }
+            // xcb hands out 32 bit pixels, no need to narrow them like with Xlib
+            memcpy(ImageBuffer.get(), xcb_xfixes_get_cursor_image_cursor_image(img), newsize);
+            free(img);
+
+            auto wholeimg = CreateImage(imgrect, imgrect.right * sizeof(ImageBGRA), reinterpret_cast<const ImageBGRA *>(ImageBuffer.get()));
+            if (Data->ScreenCaptureData.OnMouseChanged) {
+                Data->ScreenCaptureData.OnMouseChanged(&wholeimg, mousepoint);
+            }
+            if (Data->RegionCaptureData.OnMouseChanged) {
+                Data->RegionCaptureData.OnMouseChanged(&wholeimg, mousepoint);
+            }
+            if (Data->WindowCaptureData.OnMouseChanged) {
+                Data->WindowCaptureData.OnMouseChanged(&wholeimg, mousepoint);
+            }
+        }
+        else if (Last_x != mousepoint.Position.x || Last_y != mousepoint.Position.y) {
+            mousepoint.HotSpot = HotSpot;
+            if (Data->ScreenCaptureData.OnMouseChanged) {
+                Data->ScreenCaptureData.OnMouseChanged(nullptr, mousepoint);
+            }
+            if (Data->RegionCaptureData.OnMouseChanged) {
+                Data->RegionCaptureData.OnMouseChanged(nullptr, mousepoint);
+            }
+            if (Data->WindowCaptureData.OnMouseChanged) {
+                Data->WindowCaptureData.OnMouseChanged(nullptr, mousepoint);
+            }
+        }
+        Last_x = mousepoint.Position.x;
+        Last_y = mousepoint.Position.y;
+        return DUPL_RETURN_SUCCESS;
+    }
+
+} // namespace Screen_Capture
+} // namespace SL
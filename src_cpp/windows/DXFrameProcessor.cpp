@@ -363,6 +363,7 @@ namespace Screen_Capture {
                                   hr, SystemTransitionsExpectedErrors);
         } 
        
+        CaptureTime = MonotonicTime();
         auto startsrc = reinterpret_cast<unsigned char *>(MappingDesc.pData); 
         ProcessCapture(Data->ScreenCaptureData, *this, SelectedMonitor, startsrc, MappingDesc.RowPitch);
         return DUPL_RETURN_SUCCESS;
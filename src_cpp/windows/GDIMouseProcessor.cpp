@@ -21,7 +21,7 @@ namespace Screen_Capture {
     DUPL_RETURN GDIMouseProcessor::ProcessFrame()
     {
         auto Ret = DUPL_RETURN_SUCCESS;
-        if (Data->ScreenCaptureData.OnMouseChanged || Data->WindowCaptureData.OnMouseChanged) {
+        if (Data->ScreenCaptureData.OnMouseChanged || Data->WindowCaptureData.OnMouseChanged || Data->RegionCaptureData.OnMouseChanged) {
             CURSORINFO cursorInfo;
             memset(&cursorInfo, 0, sizeof(cursorInfo));
             cursorInfo.cbSize = sizeof(cursorInfo);
@@ -114,6 +114,9 @@ namespace Screen_Capture {
                 if (Data->ScreenCaptureData.OnMouseChanged) {
                     Data->ScreenCaptureData.OnMouseChanged(&wholeimg, mousepoint);
                 }
+                if (Data->RegionCaptureData.OnMouseChanged) {
+                    Data->RegionCaptureData.OnMouseChanged(&wholeimg, mousepoint);
+                }
                 std::swap(NewImageBuffer, ImageBuffer);
             }
             else if (Last_x != lastx || Last_y != lasty) {
@@ -123,6 +126,9 @@ namespace Screen_Capture {
                 if (Data->ScreenCaptureData.OnMouseChanged) {
                     Data->ScreenCaptureData.OnMouseChanged(nullptr, mousepoint);
                 }
+                if (Data->RegionCaptureData.OnMouseChanged) {
+                    Data->RegionCaptureData.OnMouseChanged(nullptr, mousepoint);
+                }
             }
 
             Last_x = lastx;
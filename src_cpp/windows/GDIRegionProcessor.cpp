@@ -0,0 +1,57 @@
+#include "GDIRegionProcessor.h"
+
+namespace SL {
+namespace Screen_Capture {
+
+    DUPL_RETURN GDIRegionProcessor::Init(std::shared_ptr<Thread_Data>, const std::vector<RegionCluster> &clusters)
+    {
+        // the DISPLAY dc spans all monitors using the same coordinates as the monitor offsets
+        DesktopDC.DC = CreateDCA("DISPLAY", NULL, NULL, NULL);
+        CaptureDC.DC = CreateCompatibleDC(DesktopDC.DC);
+        if (!DesktopDC.DC || !CaptureDC.DC) {
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+        }
+        CaptureBMPs = std::make_unique<HBITMAPWrapper[]>(clusters.size());
+        for (size_t i = 0; i < clusters.size(); i++) {
+            auto &bounds = clusters[i].Bounds;
+            CaptureBMPs[i].Bitmap = CreateCompatibleBitmap(DesktopDC.DC, Width(bounds), Height(bounds));
+            if (!CaptureBMPs[i].Bitmap) {
+                return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED;
+            }
+            Bounds.push_back(bounds);
+            ImageBuffers.push_back(std::make_unique<unsigned char[]>(Width(bounds) * Height(bounds) * sizeof(ImageBGRA)));
+        }
+        return DUPL_RETURN_SUCCESS;
+    }
+
+    DUPL_RETURN GDIRegionProcessor::ProcessFrame(size_t index, const unsigned char *&data, int &rowstride)
+    {
+        auto &bounds = Bounds[index];
+        auto width = Width(bounds);
+        auto height = Height(bounds);
+
+        auto originalBmp = SelectObject(CaptureDC.DC, CaptureBMPs[index].Bitmap);
+        if (BitBlt(CaptureDC.DC, 0, 0, width, height, DesktopDC.DC, bounds.left, bounds.top, SRCCOPY | CAPTUREBLT) == FALSE) {
+            // if the screen cannot be captured, return
+            SelectObject(CaptureDC.DC, originalBmp);
+            return DUPL_RETURN::DUPL_RETURN_ERROR_EXPECTED; // likely a permission issue
+        }
+
+        BITMAPINFOHEADER bi;
+        memset(&bi, 0, sizeof(bi));
+        bi.biSize = sizeof(BITMAPINFOHEADER);
+        bi.biWidth = width;
+        bi.biHeight = -height;
+        bi.biPlanes = 1;
+        bi.biBitCount = sizeof(ImageBGRA) * 8;
+        bi.biCompression = BI_RGB;
+        bi.biSizeImage = width * height * sizeof(ImageBGRA);
+        GetDIBits(DesktopDC.DC, CaptureBMPs[index].Bitmap, 0, (UINT)height, ImageBuffers[index].get(), (BITMAPINFO *)&bi, DIB_RGB_COLORS);
+        SelectObject(CaptureDC.DC, originalBmp);
+
+        data = ImageBuffers[index].get();
+        rowstride = width * sizeof(ImageBGRA);
+        return DUPL_RETURN_SUCCESS;
+    }
+} // namespace Screen_Capture
+} // namespace SL
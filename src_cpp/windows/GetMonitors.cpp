@@ -25,9 +25,9 @@ namespace Screen_Capture {
         return 1.0f;
     }
 
-    std::vector<Monitor> GetMonitors()
+    void GetMonitors(std::vector<Monitor> &ret)
     {
-        std::vector<Monitor> ret;
+        ret.clear();
 
         IDXGIAdapter *pAdapter = nullptr;
         IDXGIFactory *pFactory = nullptr;
@@ -60,12 +60,13 @@ namespace Screen_Capture {
                     ret.push_back(CreateMonitor(static_cast<int>(ret.size()), j, i, flipSides ? devMode.dmPelsWidth : devMode.dmPelsHeight,
                                                 flipSides ? devMode.dmPelsHeight : devMode.dmPelsWidth, devMode.dmPosition.x, devMode.dmPosition.y,
                                                 name, scale));
+                    // 0 and 1 mean the hardware default
+                    ret.back().RefreshRate = devMode.dmDisplayFrequency > 1 ? static_cast<float>(devMode.dmDisplayFrequency) : 0.0f;
                 }
                 pAdapter->Release();
             }
             pFactory->Release();
         }
-        return ret;
     }
 } // namespace Screen_Capture
 } // namespace SL
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "DXFrameProcessor.h"
 #include "GDIFrameProcessor.h"
 #include "GDIMouseProcessor.h"
+#include "GDIRegionProcessor.h"
 #include "ScreenCapture.h"
 #include "internal/ThreadManager.h"
 #include "WGCFrameProcessor.h"
@@ -109,5 +110,13 @@ namespace Screen_Capture {
             return;
         TryCaptureWindow<GDIFrameProcessor>(data, wnd);
     }
+
+    void RunCaptureRegions(std::shared_ptr<Thread_Data> data, std::vector<Region> regions)
+    {
+        // need to switch to the input desktop for capturing...
+        if (!SwitchToInputDesktop(data))
+            return;
+        TryCaptureRegions<GDIRegionProcessor>(data, regions);
+    }
 } // namespace Screen_Capture
 } // namespace SL
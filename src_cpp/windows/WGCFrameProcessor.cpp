@@ -409,6 +409,7 @@ namespace Screen_Capture {
                                       L"Error", hr, SystemTransitionsExpectedErrors);
             }
 
+            CaptureTime = MonotonicTime();
             auto startsrc = reinterpret_cast<unsigned char *>(MappingDesc.pData);
             ProcessCapture(Data->ScreenCaptureData, *this, SelectedMonitor, startsrc, MappingDesc.RowPitch);
 
@@ -1,11 +1,12 @@
 using System;
+using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 using System.Threading;
 
 namespace SCL
 {
     [StructLayout(LayoutKind.Sequential)]
-    public class MonitorCaptureConfiguration : IDisposable
+    public unsafe class MonitorCaptureConfiguration : IDisposable
     {
         public IntPtr Config { get; private set; }
 
@@ -17,15 +18,16 @@ public class MonitorCaptureConfiguration : IDisposable
 
         private Action<Image, Monitor> _onFrameChanged;
 
-        private Action<Image, MousePoint> _onMouseChanged;
+        private Action<Image?, MousePoint> _onMouseChanged;
+
+        private Action<ImageMove, Monitor> _onFrameMoved;
+
+        private Action<Image, Monitor> _onNewThumbnail;
+
+        private MonitorTilesCallback _onCachedTiles;
         private bool disposedValue = false;
         private static int MonitorSizeHint = 8;
 
-        private static MonitorWindowCallbackWithContext _onCaptureWithContext = OnCapture;
-        private static ScreenCaptureCallbackWithContext _onNewFrameWithContext = OnNewFrame;
-        private static ScreenCaptureCallbackWithContext _onFrameChangedWithContext = OnFrameChanged;
-        private static MouseCaptureCallbackWithContext _onMouseChangedWithContext = OnMouseChanged;
-
         private static readonly UnmanagedHandles<MonitorCaptureConfiguration> UnmanagedHandles = new();
 
         public static Monitor[] GetMonitors()
@@ -33,51 +35,84 @@ public static Monitor[] GetMonitors()
             return Utility.CopyUnmanagedWithHint<Monitor>(ref MonitorSizeHint, NativeFunctions.SCL_GetMonitors);
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
         private static int OnCapture(IntPtr buffer, int buffersize, IntPtr context)
         {
             if (context == IntPtr.Zero) throw new InvalidOperationException("Got null config.");
             var conf = UnmanagedHandles.Get(context);
             var monitors = conf._monitorCallback();
             var count = Math.Min(buffersize, monitors.Length);
-            var output = new UnmanagedArray<Monitor>(buffer, buffersize);
-            for (var i = 0; i < count; i++) output[i] = monitors[i];
+            monitors.AsSpan(0, count).CopyTo(new UnmanagedArray<Monitor>(buffer, buffersize).AsSpan());
             return count;
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
         private static void OnNewFrame(IntPtr imagePtr, IntPtr windowPtr, IntPtr context)
         {
             if (context == IntPtr.Zero) throw new InvalidOperationException("Got null config.");
             var conf = UnmanagedHandles.Get(context);
-            var image = Marshal.PtrToStructure<Image>(imagePtr);
-            var window = Marshal.PtrToStructure<Monitor>(windowPtr);
+            var image = *(Image*)imagePtr;
+            var window = *(Monitor*)windowPtr;
             conf._onNewFrame(image, window);
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
         private static void OnFrameChanged(IntPtr imagePtr, IntPtr windowPtr, IntPtr context)
         {
             if (context == IntPtr.Zero) throw new InvalidOperationException("Got null config.");
             var conf = UnmanagedHandles.Get(context);
-            var image = Marshal.PtrToStructure<Image>(imagePtr);
-            var monitor = Marshal.PtrToStructure<Monitor>(windowPtr);
+            var image = *(Image*)imagePtr;
+            var monitor = *(Monitor*)windowPtr;
             conf._onFrameChanged(image, monitor);
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
         private static void OnMouseChanged(IntPtr imagePtr, IntPtr mousePointPtr, IntPtr context)
         {
             if (context == IntPtr.Zero) throw new InvalidOperationException("Got null config.");
-            var image = Marshal.PtrToStructure<Image>(imagePtr);
-            var mousePoint = Marshal.PtrToStructure<MousePoint>(mousePointPtr);
+            // no image if only the position changed
+            var image = imagePtr == IntPtr.Zero ? (Image?)null : *(Image*)imagePtr;
+            var mousePoint = *(MousePoint*)mousePointPtr;
             var conf = UnmanagedHandles.Get(context);
             conf._onMouseChanged(image, mousePoint);
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+        private static void OnFrameMoved(IntPtr movePtr, IntPtr monitorPtr, IntPtr context)
+        {
+            var conf = UnmanagedHandles.Get(context);
+            if (conf == null) throw new InvalidOperationException("Invalid Handle.");
+            var move = *(ImageMove*)movePtr;
+            var monitor = *(Monitor*)monitorPtr;
+            conf._onFrameMoved(move, monitor);
+        }
+
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+        private static void OnCachedTiles(IntPtr tilesPtr, int count, IntPtr monitorPtr, IntPtr context)
+        {
+            var conf = UnmanagedHandles.Get(context);
+            if (conf == null) throw new InvalidOperationException("Invalid Handle.");
+            var monitor = *(Monitor*)monitorPtr;
+            conf._onCachedTiles(new ReadOnlySpan<CachedTile>((void*)tilesPtr, count), monitor);
+        }
+
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+        private static void OnNewThumbnail(IntPtr imagePtr, IntPtr monitorPtr, IntPtr context)
+        {
+            var conf = UnmanagedHandles.Get(context);
+            if (conf == null) throw new InvalidOperationException("Invalid Handle.");
+            var image = *(Image*)imagePtr;
+            var monitor = *(Monitor*)monitorPtr;
+            conf._onNewThumbnail(image, monitor);
+        }
+
         public MonitorCaptureConfiguration(MonitorCallback callback)
         {
             try
             {
                 _monitorCallback = callback;
                 UnmanagedHandles.Add(this, out _handle);
-                Config = NativeFunctions.SCL_CreateMonitorCaptureConfigurationWithContext(_onCaptureWithContext, _handle);
+                Config = NativeFunctions.SCL_CreateMonitorCaptureConfigurationWithContext(&OnCapture, _handle);
             }
             catch
             {
@@ -92,7 +127,7 @@ public MonitorCaptureConfiguration OnNewFrame(Action<Image, Monitor> onNewFrame)
             if (_onNewFrame == null)
             {
                 _onNewFrame = onNewFrame;
-                NativeFunctions.SCL_MonitorOnNewFrameWithContext(Config, _onNewFrameWithContext);
+                NativeFunctions.SCL_MonitorOnNewFrameWithContext(Config, &OnNewFrame);
             }
             else
             {
@@ -109,7 +144,7 @@ public MonitorCaptureConfiguration OnFrameChanged(Action<Image, Monitor> onFrame
             if (_onFrameChanged == null)
             {
                 _onFrameChanged = onFrameChanged;
-                NativeFunctions.SCL_MonitorOnFrameChangedWithContext(Config, _onFrameChangedWithContext);
+                NativeFunctions.SCL_MonitorOnFrameChangedWithContext(Config, &OnFrameChanged);
             }
             else
             {
@@ -120,13 +155,13 @@ public MonitorCaptureConfiguration OnFrameChanged(Action<Image, Monitor> onFrame
 
         }
 
-        public MonitorCaptureConfiguration OnMouseChanged(Action<Image, MousePoint> onMouseChanged)
+        public MonitorCaptureConfiguration OnMouseChanged(Action<Image?, MousePoint> onMouseChanged)
         {
 
             if (_onMouseChanged == null)
             {
                 _onMouseChanged = onMouseChanged;
-                NativeFunctions.SCL_MonitorOnMouseChangedWithContext(Config, _onMouseChangedWithContext);
+                NativeFunctions.SCL_MonitorOnMouseChangedWithContext(Config, &OnMouseChanged);
             }
             else
             {
@@ -136,6 +171,107 @@ public MonitorCaptureConfiguration OnMouseChanged(Action<Image, MousePoint> onMo
             return this;
 
         }
+        // Blocks that scrolled or moved since the last frame, reported before the OnFrameChanged calls for what is left over
+        public MonitorCaptureConfiguration OnFrameMoved(Action<ImageMove, Monitor> onFrameMoved)
+        {
+
+            if (_onFrameMoved == null)
+            {
+                _onFrameMoved = onFrameMoved;
+                NativeFunctions.SCL_MonitorOnFrameMovedWithContext(Config, &OnFrameMoved);
+            }
+            else
+            {
+                _onFrameMoved += onFrameMoved;
+            }
+
+            return this;
+
+        }
+
+        // Frames are downscaled by divisor (1, 2, 4 or 8) before they are passed to OnNewFrame, OnFrameChanged and OnFrameMoved
+        public MonitorCaptureConfiguration OutputScale(int divisor, ScaleFilter filter = ScaleFilter.Box)
+        {
+            NativeFunctions.SCL_MonitorSetOutputScale(Config, divisor, filter);
+            return this;
+        }
+
+        // The number of buffers frames are captured into. Above 1 frames can be kept past the callback with Frame.TryAcquire, the capture
+        // skips frames while every buffer is held
+        public MonitorCaptureConfiguration FrameBufferCount(int count)
+        {
+            NativeFunctions.SCL_MonitorSetFrameBufferCount(Config, count);
+            return this;
+        }
+
+        // A pixel only counts as changed if one of its channels differs by more than the threshold of that channel, and a tile is only
+        // reported to OnFrameChanged once minChangedPixels of its pixels changed. Small differences still add up over several frames
+        public MonitorCaptureConfiguration DiffTolerance(byte b, byte g, byte r, byte a = 0, bool ignoreAlpha = true, int minChangedPixels = 1)
+        {
+            NativeFunctions.SCL_MonitorSetDiffTolerance(Config, b, g, r, a, ignoreAlpha ? 1 : 0, minChangedPixels);
+            return this;
+        }
+
+        // Changed tiles are narrowed down to blocks of size x size pixels (8 - 256, a power of two) before they go to OnFrameChanged
+        public MonitorCaptureConfiguration DiffBlockSize(int size)
+        {
+            NativeFunctions.SCL_MonitorSetDiffBlockSize(Config, size);
+            return this;
+        }
+
+        // Hashes keeps only a hash of every block instead of a copy of the last frame. Alpha is not compared, Image.Reference is not set
+        // and it can not be used with OnFrameMoved or DiffTolerance
+        public MonitorCaptureConfiguration DiffReference(DiffReference reference)
+        {
+            NativeFunctions.SCL_MonitorSetDiffReference(Config, reference);
+            return this;
+        }
+
+        // Blends the cursor into the frames, the blocks it left and entered go to OnFrameChanged. Only X11 and xcb draw it so far
+        public MonitorCaptureConfiguration CompositeCursor(bool composite)
+        {
+            NativeFunctions.SCL_MonitorSetCompositeCursor(Config, composite ? 1 : 0);
+            return this;
+        }
+
+        // Changed blocks are looked up by content in a cache of the capacity blocks used last. Before the OnFrameChanged calls of a frame
+        // onCachedTiles gets its blocks in order, the hits are left out of OnFrameChanged. To resolve them keep the pixels by hash, count
+        // every block as a use and drop the least recently used past capacity
+        public MonitorCaptureConfiguration OnCachedTiles(MonitorTilesCallback onCachedTiles, int capacity)
+        {
+
+            if (_onCachedTiles == null)
+            {
+                _onCachedTiles = onCachedTiles;
+                NativeFunctions.SCL_MonitorOnCachedTilesWithContext(Config, &OnCachedTiles, capacity);
+            }
+            else
+            {
+                _onCachedTiles += onCachedTiles;
+            }
+
+            return this;
+
+        }
+
+        // Every frame downscaled by divisor (2, 4 or 8), independent of OutputScale
+        public MonitorCaptureConfiguration OnNewThumbnail(Action<Image, Monitor> onNewThumbnail, int divisor, ScaleFilter filter = ScaleFilter.Box)
+        {
+
+            if (_onNewThumbnail == null)
+            {
+                _onNewThumbnail = onNewThumbnail;
+                NativeFunctions.SCL_MonitorOnNewThumbnailWithContext(Config, &OnNewThumbnail, divisor, filter);
+            }
+            else
+            {
+                _onNewThumbnail += onNewThumbnail;
+            }
+
+            return this;
+
+        }
+
         protected virtual void Dispose(bool disposing)
         {
             if (!disposedValue)
@@ -155,6 +291,9 @@ protected virtual void Dispose(bool disposing)
                 {
                     this._onFrameChanged = null;
                     this._onMouseChanged = null;
+                    this._onFrameMoved = null;
+                    this._onNewThumbnail = null;
+                    this._onCachedTiles = null;
                     this._onNewFrame = null;
                     this._monitorCallback = null;
                 }
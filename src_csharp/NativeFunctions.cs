@@ -4,7 +4,7 @@
 namespace SCL
 {
 
-    public static class NativeFunctions
+    public static unsafe class NativeFunctions
     {
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
@@ -17,13 +17,13 @@ public static class NativeFunctions
         public static extern IntPtr SCL_CreateWindowCaptureConfiguration(BufferCallback callback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
-        public static extern IntPtr SCL_CreateWindowCaptureConfigurationWithContext(MonitorWindowCallbackWithContext callback, IntPtr context);
+        public static extern IntPtr SCL_CreateWindowCaptureConfigurationWithContext(delegate* unmanaged[Cdecl]<IntPtr, int, IntPtr, int> callback, IntPtr context);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern IntPtr SCL_CreateMonitorCaptureConfiguration(BufferCallback callback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
-        public static extern IntPtr SCL_CreateMonitorCaptureConfigurationWithContext(MonitorWindowCallbackWithContext callback, IntPtr context);
+        public static extern IntPtr SCL_CreateMonitorCaptureConfigurationWithContext(delegate* unmanaged[Cdecl]<IntPtr, int, IntPtr, int> callback, IntPtr context);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern void SCL_FreeMonitorCaptureConfiguration(IntPtr ptr);
@@ -37,32 +37,59 @@ public static class NativeFunctions
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern int SCL_IsPaused(IntPtr ptr);
 
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_GetCaptureStatistics(IntPtr ptr, CaptureStatistics* statistics);
+
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern bool SCL_Resume(IntPtr ptr);
 
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorSetIgnoreRects(IntPtr ptr, Monitor* monitor, ImageRect* rects, int count);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowSetIgnoreRects(IntPtr ptr, Window* window, ImageRect* rects, int count);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SCL_MonitorGetChangesSince(IntPtr ptr, Monitor* monitor, ulong sequence, ImageRect* rects, int rects_size);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SCL_WindowGetChangesSince(IntPtr ptr, Window* window, ulong sequence, ImageRect* rects, int rects_size);
+
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern void SCL_SetFrameChangeInterval(IntPtr ptr, int milliseconds);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern void SCL_SetMouseChangeInterval(IntPtr ptr, int milliseconds);
 
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_SetFrameRefreshDivisor(IntPtr ptr, int divisor);
+
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern void SCL_MonitorOnNewFrame(IntPtr ptr, ScreenCaptureCallback monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void SCL_MonitorOnNewFrameWithContext(IntPtr ptr, ScreenCaptureCallbackWithContext monitorCallback);
+        public static extern void SCL_MonitorOnNewFrameWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern void SCL_MonitorOnFrameChanged(IntPtr ptr, ScreenCaptureCallback monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void SCL_MonitorOnFrameChangedWithContext(IntPtr ptr, ScreenCaptureCallbackWithContext monitorCallback);
+        public static extern void SCL_MonitorOnFrameChangedWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern void SCL_MonitorOnMouseChanged(IntPtr ptr, MouseCaptureCallback monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void SCL_MonitorOnMouseChangedWithContext(IntPtr ptr, MouseCaptureCallbackWithContext monitorCallback);
+        public static extern void SCL_MonitorOnMouseChangedWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> monitorCallback);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorOnFrameMovedWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> moveCallback);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorSetOutputScale(IntPtr ptr, int divisor, ScaleFilter filter);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorOnNewThumbnailWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> thumbnailCallback, int divisor, ScaleFilter filter);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern IntPtr SCL_MonitorStartCapturing(IntPtr ptr);
@@ -71,19 +98,28 @@ public static class NativeFunctions
         public static extern void SCL_WindowOnNewFrame(IntPtr ptr, WindowCaptureCallback monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void SCL_WindowOnNewFrameWithContext(IntPtr ptr, WindowCaptureCallbackWithContext monitorCallback);
+        public static extern void SCL_WindowOnNewFrameWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern void SCL_WindowOnFrameChanged(IntPtr ptr, WindowCaptureCallback monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void SCL_WindowOnFrameChangedWithContext(IntPtr ptr, WindowCaptureCallbackWithContext monitorCallback);
+        public static extern void SCL_WindowOnFrameChangedWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern void SCL_WindowOnMouseChanged(IntPtr ptr, MouseCaptureCallback monitorCallback);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void SCL_WindowOnMouseChangedWithContext(IntPtr ptr, MouseCaptureCallbackWithContext monitorCallback);
+        public static extern void SCL_WindowOnMouseChangedWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> monitorCallback);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowOnFrameMovedWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> moveCallback);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowSetOutputScale(IntPtr ptr, int divisor, ScaleFilter filter);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowOnNewThumbnailWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void> thumbnailCallback, int divisor, ScaleFilter filter);
 
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern IntPtr SCL_WindowStartCapturing(IntPtr ptr);
@@ -91,6 +127,51 @@ public static class NativeFunctions
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern void SCL_FreeIScreenCaptureManagerWrapper(IntPtr ptr);
 
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorSetFrameBufferCount(IntPtr ptr, int count);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowSetFrameBufferCount(IntPtr ptr, int count);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorSetDiffTolerance(IntPtr ptr, int b, int g, int r, int a, int ignorealpha, int minchangedpixels);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowSetDiffTolerance(IntPtr ptr, int b, int g, int r, int a, int ignorealpha, int minchangedpixels);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorSetDiffBlockSize(IntPtr ptr, int size);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorSetDiffReference(IntPtr ptr, DiffReference reference);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorSetCompositeCursor(IntPtr ptr, int composite);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_MonitorOnCachedTilesWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, int, IntPtr, IntPtr, void> tilesCallback, int capacity);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowSetDiffBlockSize(IntPtr ptr, int size);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowSetDiffReference(IntPtr ptr, DiffReference reference);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowSetCompositeCursor(IntPtr ptr, int composite);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_WindowOnCachedTilesWithContext(IntPtr ptr, delegate* unmanaged[Cdecl]<IntPtr, int, IntPtr, IntPtr, void> tilesCallback, int capacity);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SCL_AcquireFrame(Image* image, Frame* frame);
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern long SCL_MonotonicTime();
+
+        [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SCL_ReleaseFrame(Frame* frame);
+
         [DllImport("screen_capture_lite_shared", CallingConvention = CallingConvention.Cdecl)]
         public static extern IntPtr SCL_Utility_CopyToContiguous(IntPtr destination, IntPtr image);
 
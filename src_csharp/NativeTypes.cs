@@ -1,35 +1,43 @@
 using System;
 using System.Runtime.InteropServices;
+using System.Text;
 
 namespace SCL
 {
-    
+    // All of these are blittable and laid out like their native counterparts, callbacks read them straight from native memory
+
     [StructLayout(LayoutKind.Sequential)]
-    public class Point
+    public struct Point
     {
         public int x;
         public int y;
     }
     
     [StructLayout(LayoutKind.Sequential)]
-    public class MousePoint
+    public struct MousePoint
     {
         public Point Position;
         public Point HotSpot;
     };
 
     [StructLayout(LayoutKind.Sequential)]
-    public class Window
+    public unsafe struct Window
     {
         public IntPtr Handle;
         public Point Position;
         public Point Size;
-        [MarshalAs(UnmanagedType.ByValTStr, SizeConst = 128)]
-        public string Name;
+        private fixed byte _name[128];
+
+        // only turned into a string when asked for
+        public string Name
+        {
+            get => NativeString.Get(ref _name[0], 128);
+            set => NativeString.Set(ref _name[0], 128, value);
+        }
     }
 
     [StructLayout(LayoutKind.Sequential)]
-    public class Monitor
+    public unsafe struct Monitor
     {
         public int Id;
         public int Index;
@@ -44,13 +52,21 @@ public class Monitor
         public int OffsetY;
         public int OriginalOffsetX;
         public int OriginalOffsetY;
-        [MarshalAs(UnmanagedType.ByValTStr, SizeConst = 128)]
-        public string Name;
+        private fixed byte _name[128];
         public float Scaling;
+        // of the mode the monitor runs at, in Hz. 0 if the platform does not tell
+        public float RefreshRate;
+
+        // only turned into a string when asked for
+        public string Name
+        {
+            get => NativeString.Get(ref _name[0], 128);
+            set => NativeString.Set(ref _name[0], 128, value);
+        }
     }
     
     [StructLayout(LayoutKind.Sequential)]
-    public class ImageRect
+    public struct ImageRect
     {
         public int left;
         public int top;
@@ -58,15 +74,164 @@ public class ImageRect
         public int bottom;
     }
     
+    public enum ScaleFilter
+    {
+        Box = 0,
+        Bilinear = 1
+    }
+
+    public enum DiffReference
+    {
+        Frame = 0,
+        Hashes = 1
+    }
+
     [StructLayout(LayoutKind.Sequential)]
-    public class Image
+    public struct ImageMove
+    {
+        // in the coordinates of the previous frame
+        public ImageRect Source;
+        // where the top left corner of Source is in the new frame
+        public Point Destination;
+    }
+
+    // counters of all sources of a capture since it started
+    [StructLayout(LayoutKind.Sequential)]
+    public struct CaptureStatistics
+    {
+        public ulong Frames;
+        // frames the diffing had to allocate memory for, it stops going up once the capture runs steadily
+        public ulong FramesWithAllocations;
+        // changed blocks looked up in the tile cache and how many were found, see OnCachedTiles
+        public ulong TileLookups;
+        public ulong TileHits;
+    }
+
+    // a block of the changes of a frame looked up in the tile cache
+    [StructLayout(LayoutKind.Sequential)]
+    public struct CachedTile
+    {
+        public ImageRect Rect;
+        // the pixels of the block without alpha, blocks with the same hash look the same
+        public ulong Hash;
+        private byte _hit;
+
+        // the block was in the cache before this frame and is not passed to OnFrameChanged
+        public bool Hit => _hit != 0;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct ImageBGRA
+    {
+        public byte B;
+        public byte G;
+        public byte R;
+        // alpha is always unused and might contain garbage
+        public byte A;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public unsafe struct Image
     {
         public ImageRect Bounds;
         public int BytesToNextRow;
-        [MarshalAs(UnmanagedType.I1)]
-        public bool isContiguous;
+        private byte _isContiguous;
         // alpha is always unused and might contain garbage
         public IntPtr Data;
+        // only set on the difs of OnFrameChanged, points at the Image of the same rect in the previous frame
+        public IntPtr Reference;
+        // the capture buffer Data points into, set when the frame can be kept beyond the callback
+        public IntPtr Owner;
+        // counts the frames of one monitor or window from 1, see ScreenCaptureManager.GetChangesSince
+        public ulong Sequence;
+        // when the frame was grabbed, in nanoseconds of NativeFunctions.SCL_MonotonicTime
+        public long Timestamp;
+        // the frame change interval the frame was grabbed in, in nanoseconds. Timestamps further apart mean frames were skipped
+        public long Interval;
+
+        public bool isContiguous => _isContiguous != 0;
+        public int Width => Bounds.right - Bounds.left;
+        public int Height => Bounds.bottom - Bounds.top;
+
+        // The spans point into the capture buffer and are only valid during the callback, see Frame to keep them longer
+        public ReadOnlySpan<byte> Row(int y)
+        {
+            if ((uint)y >= (uint)Height) throw new ArgumentOutOfRangeException(nameof(y));
+            return new ReadOnlySpan<byte>((byte*)Data + (long)y * BytesToNextRow, Width * sizeof(ImageBGRA));
+        }
+
+        public ReadOnlySpan<ImageBGRA> Pixels(int y) => MemoryMarshal.Cast<byte, ImageBGRA>(Row(y));
+
+        // every row including the padding between them, so row y starts at y * BytesToNextRow
+        public ReadOnlySpan<byte> Bytes =>
+            Height <= 0 ? ReadOnlySpan<byte>.Empty : new ReadOnlySpan<byte>((void*)Data, (Height - 1) * BytesToNextRow + Width * sizeof(ImageBGRA));
+    }
+
+    // A frame held past the callback that delivered it, the capture does not reuse its buffer until it is disposed. Disposing can happen on
+    // any thread, but only once for all copies of a Frame
+    [StructLayout(LayoutKind.Sequential)]
+    public unsafe struct Frame : IDisposable
+    {
+        // counts the frames of one monitor or window, starting at 1
+        public ulong Sequence;
+        // see Image.Timestamp
+        public long Timestamp;
+        public ImageRect Bounds;
+        public int BytesToNextRow;
+        public IntPtr Data;
+        private IntPtr _handle;
+
+        public int Width => Bounds.right - Bounds.left;
+        public int Height => Bounds.bottom - Bounds.top;
+        public bool IsHeld => _handle != IntPtr.Zero;
+
+        // Only works from inside a frame callback and needs a configuration with FrameBufferCount above 1. Returns false if the frame
+        // can not be kept, copy it then
+        public static bool TryAcquire(in Image image, out Frame frame)
+        {
+            frame = default;
+            var copy = image;
+            fixed (Frame* f = &frame)
+            {
+                return NativeFunctions.SCL_AcquireFrame(&copy, f) != 0;
+            }
+        }
+
+        public ReadOnlySpan<byte> Row(int y)
+        {
+            if (!IsHeld) throw new ObjectDisposedException(nameof(Frame));
+            if ((uint)y >= (uint)Height) throw new ArgumentOutOfRangeException(nameof(y));
+            return new ReadOnlySpan<byte>((byte*)Data + (long)y * BytesToNextRow, Width * sizeof(ImageBGRA));
+        }
+
+        public ReadOnlySpan<ImageBGRA> Pixels(int y) => MemoryMarshal.Cast<byte, ImageBGRA>(Row(y));
+
+        public void Dispose()
+        {
+            fixed (Frame* f = &this)
+            {
+                NativeFunctions.SCL_ReleaseFrame(f);
+            }
+        }
+    }
+
+    static class NativeString
+    {
+        public static string Get(ref byte start, int size)
+        {
+            var bytes = MemoryMarshal.CreateReadOnlySpan(ref start, size);
+            var length = bytes.IndexOf((byte)0);
+            return Encoding.UTF8.GetString(length < 0 ? bytes : bytes.Slice(0, length));
+        }
+
+        public static void Set(ref byte start, int size, string value)
+        {
+            var bytes = MemoryMarshal.CreateSpan(ref start, size);
+            bytes.Clear();
+            // the last byte stays 0
+            var encoded = Encoding.UTF8.GetBytes(value ?? string.Empty);
+            encoded.AsSpan(0, Math.Min(encoded.Length, size - 1)).CopyTo(bytes);
+        }
     }
         
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
@@ -77,27 +242,20 @@ public class Image
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     public delegate void MouseCaptureCallback(IntPtr img, IntPtr mousePoint);
-        
-    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    public delegate void MouseCaptureCallbackWithContext(IntPtr intPtr, IntPtr mousePoint, IntPtr context);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     public delegate void ScreenCaptureCallback(IntPtr img, IntPtr monitor);
 
-    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    public delegate void ScreenCaptureCallbackWithContext(IntPtr img, IntPtr monitor, IntPtr context);
-
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     public delegate void WindowCaptureCallback(IntPtr img, IntPtr window);
-        
-    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    public delegate void WindowCaptureCallbackWithContext(IntPtr img, IntPtr window, IntPtr context);
-    
+
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     public delegate int BufferCallback(IntPtr buffer, int buffersize);
 
-    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    public delegate int MonitorWindowCallbackWithContext(IntPtr buffer, int buffersize, IntPtr context);
+    // the tiles point into native memory and are only valid during the call
+    public delegate void MonitorTilesCallback(ReadOnlySpan<CachedTile> tiles, Monitor monitor);
+
+    public delegate void WindowTilesCallback(ReadOnlySpan<CachedTile> tiles, Window window);
 
 
 }
\ No newline at end of file
@@ -27,6 +27,16 @@ public bool IsPaused
             }
         }
 
+        public unsafe CaptureStatistics Statistics
+        {
+            get
+            {
+                CaptureStatistics statistics;
+                NativeFunctions.SCL_GetCaptureStatistics(Session, &statistics);
+                return statistics;
+            }
+        }
+
         public ScreenCaptureManager(WindowCaptureConfiguration config)
         {
             _configuration = config;
@@ -46,12 +56,58 @@ public ScreenCaptureManager SetFrameChangeInterval(int milliseconds)
             return this;
         }
 
+        // Captures monitors on every divisor-th refresh instead of the frame change interval, so frames are evenly spaced. Monitors
+        // without a RefreshRate keep the interval, 0 turns it off
+        public ScreenCaptureManager SetFrameRefreshDivisor(int divisor)
+        {
+            NativeFunctions.SCL_SetFrameRefreshDivisor(Session, divisor);
+            return this;
+        }
+
         public ScreenCaptureManager SetMouseChangeInterval(int milliseconds)
         {
             NativeFunctions.SCL_SetMouseChangeInterval(Session, milliseconds);
             return this;
         }
 
+        // Changes inside rects are not looked for, so they never cause OnFrameChanged calls. The rects are relative to the top left of the
+        // frames of monitor, at full resolution. Replaces the rects set before for it, an empty span removes them
+        public unsafe ScreenCaptureManager SetIgnoreRects(Monitor monitor, ReadOnlySpan<ImageRect> rects)
+        {
+            fixed (ImageRect* r = rects)
+            {
+                NativeFunctions.SCL_MonitorSetIgnoreRects(Session, &monitor, r, rects.Length);
+            }
+            return this;
+        }
+
+        public unsafe ScreenCaptureManager SetIgnoreRects(Window window, ReadOnlySpan<ImageRect> rects)
+        {
+            fixed (ImageRect* r = rects)
+            {
+                NativeFunctions.SCL_WindowSetIgnoreRects(Session, &window, r, rects.Length);
+            }
+            return this;
+        }
+
+        // Fills rects with what changed in the frames of monitor after the frame with Image.Sequence sequence and returns how many rects there
+        // are, which can be more than fit. -1 if that is not known and the whole frame is needed
+        public unsafe int GetChangesSince(Monitor monitor, ulong sequence, Span<ImageRect> rects)
+        {
+            fixed (ImageRect* r = rects)
+            {
+                return NativeFunctions.SCL_MonitorGetChangesSince(Session, &monitor, sequence, r, rects.Length);
+            }
+        }
+
+        public unsafe int GetChangesSince(Window window, ulong sequence, Span<ImageRect> rects)
+        {
+            fixed (ImageRect* r = rects)
+            {
+                return NativeFunctions.SCL_WindowGetChangesSince(Session, &window, sequence, r, rects.Length);
+            }
+        }
+
         public ScreenCaptureManager PauseCapturing()
         {
             NativeFunctions.SCL_PauseCapturing(Session);
@@ -12,7 +12,7 @@ namespace SCL
     /// provides boundaries checks, however it neither allocates nor frees the array.
     /// </summary>
     /// <typeparam name="T">the type to wrap</typeparam>
-    public struct UnmanagedArray<T>
+    public unsafe struct UnmanagedArray<T> where T : unmanaged
     {
 
         public int Size { get; }
@@ -28,21 +28,15 @@ public UnmanagedArray(IntPtr ptr, int size)
         public IntPtr AddressOf(int index)
         {
             if (index < 0 || index >= Size) throw new IndexOutOfRangeException();
-            return IntPtr.Add(Ptr, index * Marshal.SizeOf<T>());
+            return IntPtr.Add(Ptr, index * sizeof(T));
         }
 
+        public Span<T> AsSpan() => new Span<T>((void*)Ptr, Size);
+
         public T this[int index]
         {
-            get
-            {
-                var addr = AddressOf(index);
-                return Marshal.PtrToStructure<T>(addr);
-            }
-            set
-            {
-                var addr = AddressOf(index);
-                Marshal.StructureToPtr(value, addr, false);
-            }
+            get => AsSpan()[index];
+            set => AsSpan()[index] = value;
         }
 
     }
@@ -51,7 +45,7 @@ public IntPtr AddressOf(int index)
     /// Allocates native memory and maps to an array. Upon disposing, this releases the unmanaged memory.
     /// </summary>
     /// <typeparam name="T">the type to wrap</typeparam>
-    public struct AutomaticUnmanagedArray<T> : IDisposable
+    public unsafe struct AutomaticUnmanagedArray<T> : IDisposable where T : unmanaged
     {
 
         /// <summary>
@@ -66,7 +60,7 @@ public struct AutomaticUnmanagedArray<T> : IDisposable
         /// <param name="size"></param>
         public AutomaticUnmanagedArray(int size)
         {
-            var ptr = Marshal.AllocHGlobal(size * Marshal.SizeOf<T>());
+            var ptr = Marshal.AllocHGlobal(size * sizeof(T));
             Array = new UnmanagedArray<T>(ptr, size);
         }
 
@@ -86,7 +80,7 @@ public void Dispose()
         /// <param name="size"></param>
         public void Realloc(int size)
         {
-            var ptr = Marshal.ReAllocHGlobal(Array.Ptr, new IntPtr(size));
+            var ptr = Marshal.ReAllocHGlobal(Array.Ptr, new IntPtr(size * sizeof(T)));
             Array = new UnmanagedArray<T>(ptr, size);
         }
 
@@ -116,11 +110,13 @@ public static class Utility
         /// <param name="callback"></param>
         /// <typeparam name="T"></typeparam>
         /// <returns></returns>
-        public static T[] CopyUnmanagedWithHint<T>(ref int hint, BufferCallback callback)
+        public static T[] CopyUnmanagedWithHint<T>(ref int hint, BufferCallback callback) where T : unmanaged
         {
             var newarraysize = hint; 
             var oldhintvalue = newarraysize;
-            using (var unmanaged = new AutomaticUnmanagedArray<T>(newarraysize))
+            // not a using variable, Realloc has to change this copy and not a readonly one
+            var unmanaged = new AutomaticUnmanagedArray<T>(newarraysize);
+            try
             {
                 do
                 {
@@ -129,11 +125,12 @@ public static T[] CopyUnmanagedWithHint<T>(ref int hint, BufferCallback callback
                 } while (unmanaged.Array.Size < newarraysize);
 
                 Interlocked.CompareExchange(ref hint, newarraysize, oldhintvalue);
-                
-                var managed = new T[newarraysize];
-                for (var i = 0; i < newarraysize; i++) managed[i] = unmanaged[i]; 
-                return managed;
 
+                return unmanaged.Array.AsSpan().Slice(0, newarraysize).ToArray();
+            }
+            finally
+            {
+                unmanaged.Dispose();
             }
         } 
     }
@@ -1,4 +1,5 @@
 using System;
+using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 using System.Threading;
 
@@ -6,7 +7,7 @@ namespace SCL
 {
 
     [StructLayout(LayoutKind.Sequential)]
-    public class WindowCaptureConfiguration : IDisposable
+    public unsafe class WindowCaptureConfiguration : IDisposable
     {
         public IntPtr Config { get; private set; }
 
@@ -18,7 +19,13 @@ public class WindowCaptureConfiguration : IDisposable
 
         private Action<Image, Window> _onFrameChanged;
 
-        private Action<Image, MousePoint> _onMouseChanged;
+        private Action<Image?, MousePoint> _onMouseChanged;
+
+        private Action<ImageMove, Window> _onFrameMoved;
+
+        private Action<Image, Window> _onNewThumbnail;
+
+        private WindowTilesCallback _onCachedTiles;
 
         private bool disposedValue = false;
 
@@ -26,59 +33,87 @@ public class WindowCaptureConfiguration : IDisposable
 
         private static readonly UnmanagedHandles<WindowCaptureConfiguration> UnmanagedHandles = new();
 
-        private static MonitorWindowCallbackWithContext _onCaptureWithContext = OnCapture;
-        private static WindowCaptureCallbackWithContext _onNewFrameWithContext = OnNewFrame;
-        private static WindowCaptureCallbackWithContext _onFrameChangedWithContext = OnFrameChanged;
-        private static MouseCaptureCallbackWithContext _onMouseChangedWithContext = OnMouseChanged;
-
         public static Window[] GetWindows()
         {
             return Utility.CopyUnmanagedWithHint<Window>(ref WindowSizeHint, NativeFunctions.SCL_GetWindows);
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
         private static int OnCapture(IntPtr buffer, int buffersize, IntPtr context)
         {
             var conf = UnmanagedHandles.Get(context);
             if (conf == null) throw new InvalidOperationException("Invalid Handle.");
             var windows = conf._windowCallback();
             var count = Math.Min(buffersize, windows.Length);
-            var output = new UnmanagedArray<Window>(buffer, buffersize);
-            for (var i = 0; i < count; i++) output[i] = windows[i];
+            windows.AsSpan(0, count).CopyTo(new UnmanagedArray<Window>(buffer, buffersize).AsSpan());
             return count;
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
         private static void OnNewFrame(IntPtr imagePtr, IntPtr windowPtr, IntPtr context)
         {
             var conf = UnmanagedHandles.Get(context);
             if (conf == null) throw new InvalidOperationException("Invalid Handle.");
-            var image = Marshal.PtrToStructure<Image>(imagePtr);
-            var window = Marshal.PtrToStructure<Window>(windowPtr);
+            var image = *(Image*)imagePtr;
+            var window = *(Window*)windowPtr;
             conf._onNewFrame(image, window);
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
         private static void OnFrameChanged(IntPtr imagePtr, IntPtr windowPtr, IntPtr context)
         {
             var conf = UnmanagedHandles.Get(context);
-            var image = Marshal.PtrToStructure<Image>(imagePtr);
-            var window = Marshal.PtrToStructure<Window>(windowPtr);
+            var image = *(Image*)imagePtr;
+            var window = *(Window*)windowPtr;
             conf._onFrameChanged(image, window);
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
         private static void OnMouseChanged(IntPtr imagePtr, IntPtr mousePointPtr, IntPtr context)
         {
             var conf = UnmanagedHandles.Get(context);
-            var image = Marshal.PtrToStructure<Image>(imagePtr);
-            var mousePoint = Marshal.PtrToStructure<MousePoint>(mousePointPtr);
+            // no image if only the position changed
+            var image = imagePtr == IntPtr.Zero ? (Image?)null : *(Image*)imagePtr;
+            var mousePoint = *(MousePoint*)mousePointPtr;
             conf._onMouseChanged(image, mousePoint);
         }
 
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+        private static void OnFrameMoved(IntPtr movePtr, IntPtr windowPtr, IntPtr context)
+        {
+            var conf = UnmanagedHandles.Get(context);
+            if (conf == null) throw new InvalidOperationException("Invalid Handle.");
+            var move = *(ImageMove*)movePtr;
+            var window = *(Window*)windowPtr;
+            conf._onFrameMoved(move, window);
+        }
+
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+        private static void OnCachedTiles(IntPtr tilesPtr, int count, IntPtr windowPtr, IntPtr context)
+        {
+            var conf = UnmanagedHandles.Get(context);
+            if (conf == null) throw new InvalidOperationException("Invalid Handle.");
+            var window = *(Window*)windowPtr;
+            conf._onCachedTiles(new ReadOnlySpan<CachedTile>((void*)tilesPtr, count), window);
+        }
+
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+        private static void OnNewThumbnail(IntPtr imagePtr, IntPtr windowPtr, IntPtr context)
+        {
+            var conf = UnmanagedHandles.Get(context);
+            if (conf == null) throw new InvalidOperationException("Invalid Handle.");
+            var image = *(Image*)imagePtr;
+            var window = *(Window*)windowPtr;
+            conf._onNewThumbnail(image, window);
+        }
+
         public WindowCaptureConfiguration(WindowCallback callback)
         {
             try
             {
                 _windowCallback = callback;
                 UnmanagedHandles.Add(this, out _handle);
-                Config = NativeFunctions.SCL_CreateWindowCaptureConfigurationWithContext(_onCaptureWithContext, _handle);
+                Config = NativeFunctions.SCL_CreateWindowCaptureConfigurationWithContext(&OnCapture, _handle);
             }
             catch
             {
@@ -93,7 +128,7 @@ public WindowCaptureConfiguration OnNewFrame(Action<Image, Window> onNewFrame)
             if (_onNewFrame == null)
             {
                 _onNewFrame = onNewFrame;
-                NativeFunctions.SCL_WindowOnNewFrameWithContext(Config, _onNewFrameWithContext);
+                NativeFunctions.SCL_WindowOnNewFrameWithContext(Config, &OnNewFrame);
             }
             else
             {
@@ -110,7 +145,7 @@ public WindowCaptureConfiguration OnFrameChanged(Action<Image, Window> onFrameCh
             if (_onFrameChanged == null)
             {
                 _onFrameChanged = onFrameChanged;
-                NativeFunctions.SCL_WindowOnFrameChangedWithContext(Config, _onFrameChangedWithContext);
+                NativeFunctions.SCL_WindowOnFrameChangedWithContext(Config, &OnFrameChanged);
             }
             else
             {
@@ -121,13 +156,13 @@ public WindowCaptureConfiguration OnFrameChanged(Action<Image, Window> onFrameCh
 
         }
 
-        public WindowCaptureConfiguration OnMouseChanged(Action<Image, MousePoint> onMouseChanged)
+        public WindowCaptureConfiguration OnMouseChanged(Action<Image?, MousePoint> onMouseChanged)
         {
 
             if (_onMouseChanged == null)
             {
                 _onMouseChanged = onMouseChanged;
-                NativeFunctions.SCL_WindowOnMouseChangedWithContext(Config, _onMouseChangedWithContext);
+                NativeFunctions.SCL_WindowOnMouseChangedWithContext(Config, &OnMouseChanged);
             }
             else
             {
@@ -138,6 +173,107 @@ public WindowCaptureConfiguration OnMouseChanged(Action<Image, MousePoint> onMou
 
         }
 
+        // Blocks that scrolled or moved since the last frame, reported before the OnFrameChanged calls for what is left over
+        public WindowCaptureConfiguration OnFrameMoved(Action<ImageMove, Window> onFrameMoved)
+        {
+
+            if (_onFrameMoved == null)
+            {
+                _onFrameMoved = onFrameMoved;
+                NativeFunctions.SCL_WindowOnFrameMovedWithContext(Config, &OnFrameMoved);
+            }
+            else
+            {
+                _onFrameMoved += onFrameMoved;
+            }
+
+            return this;
+
+        }
+
+        // Frames are downscaled by divisor (1, 2, 4 or 8) before they are passed to OnNewFrame, OnFrameChanged and OnFrameMoved
+        public WindowCaptureConfiguration OutputScale(int divisor, ScaleFilter filter = ScaleFilter.Box)
+        {
+            NativeFunctions.SCL_WindowSetOutputScale(Config, divisor, filter);
+            return this;
+        }
+
+        // The number of buffers frames are captured into. Above 1 frames can be kept past the callback with Frame.TryAcquire, the capture
+        // skips frames while every buffer is held
+        public WindowCaptureConfiguration FrameBufferCount(int count)
+        {
+            NativeFunctions.SCL_WindowSetFrameBufferCount(Config, count);
+            return this;
+        }
+
+        // A pixel only counts as changed if one of its channels differs by more than the threshold of that channel, and a tile is only
+        // reported to OnFrameChanged once minChangedPixels of its pixels changed. Small differences still add up over several frames
+        public WindowCaptureConfiguration DiffTolerance(byte b, byte g, byte r, byte a = 0, bool ignoreAlpha = true, int minChangedPixels = 1)
+        {
+            NativeFunctions.SCL_WindowSetDiffTolerance(Config, b, g, r, a, ignoreAlpha ? 1 : 0, minChangedPixels);
+            return this;
+        }
+
+        // Changed tiles are narrowed down to blocks of size x size pixels (8 - 256, a power of two) before they go to OnFrameChanged
+        public WindowCaptureConfiguration DiffBlockSize(int size)
+        {
+            NativeFunctions.SCL_WindowSetDiffBlockSize(Config, size);
+            return this;
+        }
+
+        // Hashes keeps only a hash of every block instead of a copy of the last frame. Alpha is not compared, Image.Reference is not set
+        // and it can not be used with OnFrameMoved or DiffTolerance
+        public WindowCaptureConfiguration DiffReference(DiffReference reference)
+        {
+            NativeFunctions.SCL_WindowSetDiffReference(Config, reference);
+            return this;
+        }
+
+        // Blends the cursor into the frames, the blocks it left and entered go to OnFrameChanged. Only X11 and xcb draw it so far
+        public WindowCaptureConfiguration CompositeCursor(bool composite)
+        {
+            NativeFunctions.SCL_WindowSetCompositeCursor(Config, composite ? 1 : 0);
+            return this;
+        }
+
+        // Changed blocks are looked up by content in a cache of the capacity blocks used last. Before the OnFrameChanged calls of a frame
+        // onCachedTiles gets its blocks in order, the hits are left out of OnFrameChanged. To resolve them keep the pixels by hash, count
+        // every block as a use and drop the least recently used past capacity
+        public WindowCaptureConfiguration OnCachedTiles(WindowTilesCallback onCachedTiles, int capacity)
+        {
+
+            if (_onCachedTiles == null)
+            {
+                _onCachedTiles = onCachedTiles;
+                NativeFunctions.SCL_WindowOnCachedTilesWithContext(Config, &OnCachedTiles, capacity);
+            }
+            else
+            {
+                _onCachedTiles += onCachedTiles;
+            }
+
+            return this;
+
+        }
+
+        // Every frame downscaled by divisor (2, 4 or 8), independent of OutputScale
+        public WindowCaptureConfiguration OnNewThumbnail(Action<Image, Window> onNewThumbnail, int divisor, ScaleFilter filter = ScaleFilter.Box)
+        {
+
+            if (_onNewThumbnail == null)
+            {
+                _onNewThumbnail = onNewThumbnail;
+                NativeFunctions.SCL_WindowOnNewThumbnailWithContext(Config, &OnNewThumbnail, divisor, filter);
+            }
+            else
+            {
+                _onNewThumbnail += onNewThumbnail;
+            }
+
+            return this;
+
+        }
+
         protected virtual void Dispose(bool disposing)
         {
             if (!disposedValue)
@@ -158,6 +294,9 @@ protected virtual void Dispose(bool disposing)
                 {
                     this._onFrameChanged = null;
                     this._onMouseChanged = null;
+                    this._onFrameMoved = null;
+                    this._onNewThumbnail = null;
+                    this._onCachedTiles = null;
                     this._onNewFrame = null;
                     this._windowCallback = null;
                 }